@@ -28,6 +28,7 @@ TODO: add copyright and license in source code files.
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <opencv/highgui.h>
 #include <set>
 #include <iostream>
@@ -38,25 +39,122 @@ using namespace std;
 #include "post_process.h"
 
 
+/** Fills a binary image with a test pattern.
+ *
+ * @param image 1 channel, 8bit image.
+ *
+ * @param pattern 0 random noise, 1 checkers, 2 rings.
+ *
+ * @param density percentage of blob pixels of random noise.
+ */
+static void fill_pattern(IplImage *image, int pattern, int density)
+{
+	for (int y = 0; y < image->height; ++y)
+		for (int x = 0; x < image->width; ++x) {
+			bool blob;
+			if (pattern == 0)
+				blob = (rand() % 100 < density);
+			else if (pattern == 1)
+				blob = ((x / 5 + y / 7) % 2);
+			else
+				blob = ((x * x + y * y) / 37 % 3 == 0);
+			image->imageData[y * image->widthStep + x] =
+				blob ? (char)255 : 0;
+		}
+}
+
+/** Compares serial and parallel blob analysis on a thresholded image
+ * and on test patterns of sizes that split in several strips.
+ *
+ * @param sample_image image to threshold (can be NULL).
+ *
+ * @param threshold threshold of sample image.
+ *
+ * @return 0 if results are the same for every thread count, 1 otherwise.
+ */
+static int check_mode(IplImage *sample_image, int threshold)
+{
+	const int sizes[][2] = { { 1, 1 }, { 90, 127 }, { 257, 130 },
+				 { 333, 517 }, { 1021, 700 } };
+	const int min_areas[] = { 0, 1, 5, 500 };
+	const int threads = 16;
+	IplImage *gray_image, *binary;
+	int mismatches = 0, runs = 0;
+
+	if (sample_image) {
+		gray_image = cvCreateImage(cvGetSize(sample_image),
+					   IPL_DEPTH_8U, 1);
+		binary = cvCreateImage(cvGetSize(sample_image),
+				       IPL_DEPTH_8U, 1);
+		if (sample_image->nChannels == 3)
+			cvCvtColor(sample_image, gray_image, CV_BGR2GRAY);
+		else
+			cvCopy(sample_image, gray_image);
+		cvThreshold(gray_image, binary, threshold, 255,
+			    CV_THRESH_BINARY);
+		for (int i = 0; i < 4; ++i, ++runs)
+			mismatches += check_blob_analysis(binary, min_areas[i],
+							  threads);
+		cvReleaseImage(&binary);
+		cvReleaseImage(&gray_image);
+	}
+
+	srand(1);
+	for (int s = 0; s < 5; ++s) {
+		binary = cvCreateImage(cvSize(sizes[s][0], sizes[s][1]),
+				       IPL_DEPTH_8U, 1);
+		for (int pattern = 0; pattern < 3; ++pattern)
+			for (int i = 0; i < 4; ++i, ++runs) {
+				fill_pattern(binary, pattern, 10 + 25 * i);
+				mismatches += check_blob_analysis(binary,
+								  min_areas[i],
+								  threads);
+			}
+		cvReleaseImage(&binary);
+	}
+
+	cout << runs << " images checked with 1 to " << threads <<
+		" threads, " << mismatches << " mismatches" << endl;
+	return mismatches ? 1 : 0;
+}
+
+
 int main(int argc, char** argv)
 {
 	IplImage* sample_image = 0;
+	//Blob tables of this stream, reused between frames
+	BlobRegions *regions = create_regions();
 	blob_result result;
 	float distance;
 	char plate_name[100], *file_name = "plate_", *tmp;
 
+	// '--check [image]' compares serial and parallel blob analysis
+	bool check = (argc >= 2) && !strcmp(argv[1], "--check");
+	if (check) {
+		--argc;
+		++argv;
+	}
+
 	// Input the sample picture.
 	const char *filename = (argc >= 2 ? argv[1] : "data/Circles.jpg");
 	sample_image = cvLoadImage(filename, -1);
-	show_img("Original", sample_image);
 
 	int threshold, minarea, maxarea, opencount;
 	bool grayit = true, morpho_operator = true;
 	threshold = 100;
+
+	if (check) {
+		int status = check_mode(sample_image, threshold);
+		release_regions(&regions);
+		cvReleaseImage(&sample_image);
+		return status;
+	}
+	show_img("Original", sample_image);
+
 	minarea = 500;
 	maxarea = 2000;
 	opencount = 1;
-	result = process_image(sample_image, threshold, minarea,
+	result = process_image(sample_image, *regions, threshold, minarea,
 			       maxarea, opencount, grayit, morpho_operator);
 
 	cout << " blobs number: " << result.blob_count << endl;
@@ -81,6 +179,7 @@ int main(int argc, char** argv)
 
 	}
 
+	release_regions(&regions);
 	cvReleaseImage(&sample_image);
 	return 0;
 }
@@ -1,5 +1,7 @@
 #include <opencv/highgui.h>
 #include <iostream>
+#include <unistd.h>
+#include <string.h>
 using namespace std;
 /* Blob library (ps: pay attention that blobs.h require previous
    include of std::iostream!) */
@@ -7,12 +9,50 @@ using namespace std;
 #include "blob_filter.h"
 #include "window.h"
 
+BlobRegions *create_regions(void)
+{
+	return new BlobRegions;
+}
+
+void release_regions(BlobRegions **regions)
+{
+	delete *regions;
+	*regions = NULL;
+}
+
+int check_blob_analysis(IplImage* image, int min_area, int max_threads)
+{
+	BlobRegions serial, parallel;
+	int cols = image->width, rows = image->height;
+	int count, mismatches = 0;
+
+	count = BlobAnalysis(image, serial, cols, rows, (uchar)255, min_area);
+	for (int threads = 1; threads <= max_threads; ++threads) {
+		bool same = (BlobAnalysisParallel(image, parallel, cols, rows,
+						  (uchar)255, min_area,
+						  threads) == count) &&
+			(parallel.Size() == serial.Size());
+		for (int i = 0; same && (i < BLOBDATACOUNT); ++i)
+			same = !serial.Size() ||
+				!memcmp(&serial.Field[i][0], &parallel.Field[i][0],
+					serial.Size() * sizeof(float));
+		if (!same) {
+			cout << "blob analysis differs with " << threads <<
+				" threads (" << cols << "x" << rows <<
+				", min area " << min_area << ")" << endl;
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
 /* TODO: remove gratuitous comments
  *       break this enormous function to smaller functions
  *       remove verbosity (messages, windows, etc)
  */
-blob_result process_image(IplImage* image, int threshold,
-			  int min_area, int max_area,
+blob_result process_image(IplImage* image, BlobRegions &regions,
+			  int threshold, int min_area, int max_area,
 			  int open_count, bool grayit,
 			  bool morpho_operator)
 {
@@ -21,9 +61,6 @@ blob_result process_image(IplImage* image, int threshold,
 	IplImage* thresholded_image = 0;
 	IplImage *sample_image = cvCloneImage(image);
 
-	//Holds blob related descriptors
-	float (*region_data)[BLOBDATACOUNT];
-	int* working_storage;
 	int high_region_num;
 	//Helper variables
 	int iMeanx, iMeany;//, max_area = 1000;
@@ -67,23 +104,19 @@ blob_result process_image(IplImage* image, int threshold,
 	// Display Thresholded image
 	show_img("thresholded_image", thresholded_image);
 
-	// Call Blob Analysis routine to analyze image
-	// Working storage. Note +2 +2
-	working_storage = new int[(BLOBROWCOUNT+2)*(BLOBCOLCOUNT+2)];
-
-	// Blob result array
-	region_data = new float[BLOBTOTALCOUNT][BLOBDATACOUNT];
-
-	high_region_num = BlobAnalysis(thresholded_image, working_storage, region_data, cols, rows, (uchar)255, min_area);
+	// Call Blob Analysis routine to analyze image (in strips, one
+	// per processor)
+	high_region_num = BlobAnalysisParallel(thresholded_image, regions, cols, rows, (uchar)255, min_area,
+					       (int) sysconf(_SC_NPROCESSORS_ONLN));
 
 	// Add bounding rectangles to Sample image
 	for (int this_region = 1; this_region <= high_region_num; this_region++)
 	{
-		if (region_data[this_region][BLOBAREA] < max_area) {
-			point1.x = cvRound(region_data[this_region][BLOBMINX]);
-			point1.y = cvRound(region_data[this_region][BLOBMINY]);
-			point2.x = cvRound(region_data[this_region][BLOBMAXX]);
-			point2.y = cvRound(region_data[this_region][BLOBMAXY]);
+		if (regions.Field[BLOBAREA][this_region] < max_area) {
+			point1.x = cvRound(regions.Field[BLOBMINX][this_region]);
+			point1.y = cvRound(regions.Field[BLOBMINY][this_region]);
+			point2.x = cvRound(regions.Field[BLOBMAXX][this_region]);
+			point2.y = cvRound(regions.Field[BLOBMAXY][this_region]);
 
 			// find the average of the blob (i.e. estimate its centre)
 			// and draw a retangle.
@@ -110,20 +143,20 @@ blob_result process_image(IplImage* image, int threshold,
 		/* XXX: move this code to a separated function */
 		for (int this_region = 1, counter = 0; this_region <= high_region_num; this_region++)
 		{
-			if (region_data[this_region][BLOBAREA] < max_area) {
+			if (regions.Field[BLOBAREA][this_region] < max_area) {
 
-				result.blobs[counter].min_x = region_data[this_region][BLOBMINX];
-				result.blobs[counter].min_y = region_data[this_region][BLOBMINY];
+				result.blobs[counter].min_x = regions.Field[BLOBMINX][this_region];
+				result.blobs[counter].min_y = regions.Field[BLOBMINY][this_region];
 
-				result.blobs[counter].max_x = region_data[this_region][BLOBMAXX];
-				result.blobs[counter].max_y = region_data[this_region][BLOBMAXY];
+				result.blobs[counter].max_x = regions.Field[BLOBMAXX][this_region];
+				result.blobs[counter].max_y = regions.Field[BLOBMAXY][this_region];
 
-				result.blobs[counter].max_y = region_data[this_region][BLOBMAXY];
+				result.blobs[counter].max_y = regions.Field[BLOBMAXY][this_region];
 				result.blobs[counter].calc_centroid();
 
-				result.blobs[counter].area = region_data[this_region][BLOBAREA];
+				result.blobs[counter].area = regions.Field[BLOBAREA][this_region];
 
-				result.blobs[counter].perimeter = region_data[this_region][BLOBPERIMETER];
+				result.blobs[counter].perimeter = regions.Field[BLOBPERIMETER][this_region];
 
 
 				result.blobs[counter].calc_rectangularity();
@@ -142,13 +175,11 @@ blob_result process_image(IplImage* image, int threshold,
 	cvSaveImage("sample_image.jpg", sample_image);
 
 	// Print the results
-	PrintRegionDataArray(region_data);
+	PrintRegionDataArray(regions);
 
 	cvReleaseImage(&thresholded_image);
 	cvReleaseImage(&gray_image);
 	cvReleaseImage(&sample_image);
-	delete [] region_data;
-	delete [] working_storage;
 
 	return result;
 }
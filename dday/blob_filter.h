@@ -5,10 +5,29 @@
 
 #include "data_types.h"
 
+/** Blob analysis tables (see blobs.h), opaque to callers. */
+struct BlobRegions;
+
+/** Creates blob analysis tables, kept by caller between frames of
+ * a stream (storage only grows when a frame needs more).
+ *
+ * @return tables, release them with \ref release_regions.
+ */
+BlobRegions *create_regions(void);
+
+/** Releases blob analysis tables.
+ *
+ * @param regions pointer to tables, set to NULL.
+ */
+void release_regions(BlobRegions **regions);
+
 /** The worker, filters image and search for blobs.
  *
  * @param sample_image analysed image.
  *
+ * @param regions blob analysis tables (see \ref create_regions), one
+ * per stream: calls with different tables can run concurrently.
+ *
  * @param threshold param to threshold image (we use OCV cvThreshold).
  *
  * @param min_area minimal area to consider a blob.
@@ -20,10 +39,24 @@
  * @param morpho_operator if we should run morphological operations on image.
  *
  */
-blob_result process_image(IplImage* image, int threshold,
-			  int min_area, int max_area,
+blob_result process_image(IplImage* image, BlobRegions &regions,
+			  int threshold, int min_area, int max_area,
 			  int open_count = 0, bool grayit = true,
 			  bool morpho_operator = true);
 
 
+/** Checks that parallel blob analysis gives the same regions as the
+ * serial one (all BLOBDATACOUNT fields, bit for bit) for 1 up to
+ * max_threads threads.
+ *
+ * @param image binary image (1 channel, 8bit, blobs are 255).
+ *
+ * @param min_area minimal area to consider a blob.
+ *
+ * @param max_threads biggest number of threads tried.
+ *
+ * @return number of thread counts whose results differ (0 if all match).
+ */
+int check_blob_analysis(IplImage* image, int min_area, int max_threads);
+
 #endif
@@ -1,742 +1,1071 @@
-//***********************************************************//
-//* Blob analysis package  Version1.1 28 December 2003      *//
-//* Added:                                                  *//
-//* - BLOBCOLOR                                             *//
-//* History:                                                *//
-//* - Version 1.0 8 August 2003                             *//
-//*                                                         *//
-//* Input: IplImage* binary image                           *//
-//* Output: attributes of each connected region             *//
-//* Author: Dave Grossman                                   *//
-//* Email: dgrossman@cdr.stanford.edu                       *//
-//* Acknowledgement: the algorithm has been around > 20 yrs *//
-//***********************************************************//
-
-// defines for blob array sizes and indices
-#define BLOBTOTALCOUNT 8000
-#define BLOBROWCOUNT 1000
-#define BLOBCOLCOUNT 1000
-
-#define BLOBPARENT 0
-#define BLOBCOLOR 1
-#define BLOBAREA 2
-#define BLOBPERIMETER 3
-#define BLOBSUMX 4
-#define BLOBSUMY 5
-#define BLOBSUMXX 6
-#define BLOBSUMYY 7
-#define BLOBSUMXY 8
-#define BLOBMINX 9
-#define BLOBMAXX 10
-#define BLOBMINY 11
-#define BLOBMAXY 12
-
-#define BLOBDATACOUNT 13
-
-// Subroutine prototypes
-void PrintRegionDataArray(float*[BLOBDATACOUNT]);
-void Subsume(float*[BLOBDATACOUNT], int, int*, int, int);
-int BlobAnalysis(IplImage*, int*, float*[BLOBDATACOUNT], int, int, uchar, int);
-
-// Transfer fields from subsumed region to correct one
-void Subsume(float(*RegionData)[BLOBDATACOUNT],
-			int HighRegionNum,
-			int* SubsumedRegion,
-			int HiNum,
-			int LoNum)
-{
-	// cout << "\nSubsuming " << HiNum << " into " << LoNum << endl; // for debugging
-
-	int i;
-	for(i = BLOBAREA; i < BLOBDATACOUNT; i++)	// Skip over BLOBCOLOR
-	{
-		if(i == BLOBMINX || i == BLOBMINY)
-		{
-			if(RegionData[LoNum][i] > RegionData[HiNum][i]) { RegionData[LoNum][i] = RegionData[HiNum][i]; }
-		}
-		else if(i == BLOBMAXX || i == BLOBMAXY)
-		{
-		 	if(RegionData[LoNum][i] < RegionData[HiNum][i]) { RegionData[LoNum][i] = RegionData[HiNum][i]; }
-		}
-		else // Area, Perimeter, SumX, SumY, SumXX, SumYY, SumXY
-		{
-			RegionData[LoNum][i] += RegionData[HiNum][i];
-		}
-	}
-	
-	// Make sure no region still has subsumed region as parent
-	for(i = HiNum + 1; i <= HighRegionNum; i++)
-	{
-		if(RegionData[i][BLOBPARENT] == (float) HiNum) { RegionData[i][BLOBPARENT] = LoNum; }
-	}
-
-	// Mark dead region number for future compression
-	SubsumedRegion[HiNum] = 1;
-}
-
-// Print region data array
-void PrintRegionDataArray(float (*RegionData)[BLOBDATACOUNT])
-{
-	cout << "RegionData array:" << endl;
-	for(int ThisRegion = 0; ThisRegion < BLOBTOTALCOUNT; ThisRegion++)
-	{
-		if(ThisRegion > 0 && RegionData[ThisRegion][0] < 0) break;
-		if(RegionData[ThisRegion][BLOBAREA] < 0) break;
-		cout << "Region=" << ThisRegion << ": ";
-		for(int ThisData = 0; ThisData < BLOBDATACOUNT; ThisData++)
-		{
-			float Data = RegionData[ThisRegion][ThisData];
-			cout << Data << " " ;
-		}
-		cout << endl;
-	}
-	cout << endl;
-}
-
-int BlobAnalysis(IplImage* ImageHdr,	// input image
-	int* Transition,					// transition array for intermediate result
-	float (*RegionData)[BLOBDATACOUNT],	// region data array to be output
-	int Cols, int Rows,					// size of input image (+2 for Tran array)
-	uchar Border,						// border color
-	int MinArea)						// max trans in any row
-{
-
-	if(Cols > BLOBCOLCOUNT) 
-	{
-		cout << "Error in column count" << endl;
-		return(-1);
-	}
-	if(Rows > BLOBROWCOUNT) 
-	{
-		cout << "Error in row count" << endl;
-		return(-1);
-	}
-	
-	char* Image = ImageHdr->imageData;
-	int WidthStep = ImageHdr->widthStep; 
-
-	// Convert image array into transition array. In each row
-	// the transition array tells which columns have a color change
-	int Trans = Cols;				// max trans in any row
-
-	// row 0 and row Rows+1 represent the border
-	int iTran, Tran;				// Data for a given run
-	uchar ThisCell, LastCell;		// Contents (colors?) within this row
-	int ImageOffset = - WidthStep - 1;	// Performance booster to avoid multiplication
-	int TransitionOffset = 0;		// Performance booster to avoid multiplication
-	int iRow, iCol;
-	int i;
-
-	// Initialize Transition array
-	for(i = 0; i < (Rows + 2) * (Cols + 2); i++) { Transition[i] = 0; };
-	Transition[0] = Transition[(Rows + 1) * (Cols + 2)] = Cols + 2;
-
-	// Fill Transition array
-	for(iRow = 1; iRow < Rows + 1; iRow++)		// Choose a row of Bordered image
-	{
-		ImageOffset += WidthStep;	// Performance booster to avoid multiplication
-		TransitionOffset += Cols + 2;// Performance booster to avoid multiplication
-		iTran = 0;					// Index into Transition array
-		Tran = 0;					// No transitions at row start
-		LastCell = Border;
-		for(iCol = 0; iCol < Cols + 2; iCol++)	// Scan that row of Bordered image
-		{
-			if(iCol == 0 || iCol == Cols + 1) ThisCell = Border;
-			else ThisCell = Image[ImageOffset + iCol];
-
-			if(ThisCell != LastCell)
-			{
-				Transition[TransitionOffset + iTran] = Tran;	// Save completed Tran
-				iTran++;						// Prepare new index
-				LastCell = ThisCell;			// With this color
-			}
-			Tran++;	// Tran continues
-		}
-		Transition[TransitionOffset + iTran] = Tran;	// Save completed run
-		Transition[TransitionOffset + iTran + 1] = -1;
-	}
-
-
-	// Process transition code depending on Last row and This row
-	//
-	// Last ---++++++--+++++++++++++++-----+++++++++++++++++++-----++++++-------+++---
-	// This -----+++-----++++----+++++++++----+++++++---++------------------++++++++--
-	//
-	// There are various possibilities:
-	//
-	// Case     1       2       3       4       5       6       7       8
-	// Last |xxx    |xxxxoo |xxxxxxx|xxxxxxx|ooxxxxx|ooxxx  |ooxxxxx|    xxx|
-	// This |    yyy|    yyy|  yyyy |  yyyyy|yyyyyyy|yyyyyyy|yyyy   |yyyy   |
-	// Here o is optional
-	// 
-	// Here are the primitive tests to distinguish these 6 cases:
-	//   A) Last end < This start - 1 OR NOT		Note: -1
-	//   B) This end < Last start OR NOT
-	//   C) Last start < This start OR NOT
-	//   D) This end < Last end OR NOT
-	//   E) This end = Last end OR NOT
-	//
-	// Here is how to use these tests to determine the case:
-	//   Case 1 = A [=> NOT B AND C AND NOT D AND NOT E]
-	//   Case 2 = C AND NOT D AND NOT E [AND NOT A AND NOT B]
-	//   Case 3 = C AND D [=> NOT E] [AND NOT A AND NOT B]
-	//   Case 4 = C AND NOT D AND E [AND NOT A AND NOT B]
-	//   Case 5 = NOT C AND E [=> NOT D] [AND NOT A AND NOT B]
-	//   Case 6 = NOT C AND NOT D AND NOT E [AND NOT A AND NOT B]
-	//   Case 7 = NOT C AND D [=> NOT E] [AND NOT A AND NOT B]
-	//   Case 8 = B [=> NOT A AND NOT C AND D AND NOT E]
-	//
-	// In cases 2,3,4,5,6,7 the following additional test is needed:
-	//   Match) This color = Last color OR NOT
-	//
-	// In cases 5,6,7 the following additional test is needed:
-	//   Known) This region was already matched OR NOT
-	//
-	// Here are the main tests and actions:
-	//   Case 1: LastIndex++;
-	//   Case 2: if(Match) {y = x;}
-	//           LastIndex++;
-	//   Case 3: if(Match) {y = x;}
-	//           else {y = new}
-	//           ThisIndex++;
-	//   Case 4: if(Match) {y = x;}
-	//           else {y = new}
-	//           LastIndex++;
-	//           ThisIndex++;
-	//   Case 5: if(Match AND NOT Known) {y = x}
-	//           else if(Match AND Known) {Subsume(x,y)}
-	//           LastIndex++;ThisIndex++
-	//   Case 6: if(Match AND NOT Known) {y = x}
-	//           else if(Match AND Known) {Subsume(x,y)}
-	//           LastIndex++;
-	//   Case 7: if(Match AND NOT Known) {y = x}
-	//           else if(Match AND Known) {Subsume(x,y)}
-	//           ThisIndex++;
-	//   Case 8: ThisIndex++;
-
-	// BLOBTOTALCOUNT is max num of regions incl all temps and background
-	// BLOBROWCOUNT is the number of rows in the image
-	// BLOBCOLCOUNT is the number of columns in the image
-	// BLOBDATACOUNT is number of data elements for each region as follows:
-	// BLOBPARENT 0	these are the respective indices for the data elements
-	// BLOBCOLOR 1		0=background; 1=non-background
-	// BLOBAREA 2
-	// BLOBPERIMETER 3
-	// BLOBSUMX 4		means
-	// BLOBSUMY 5
-	// BLOBSUMXX 6		2nd moments
-	// BLOBSUMYY 7
-	// BLOBSUMXY 8
-	// BLOBMINX 9		bounding rectangle
-	// BLOBMAXX 10
-	// BLOBMINY 11
-	// BLOBMAXY 12
-
-	int SubsumedRegion[BLOBTOTALCOUNT];			// Blob result array
-	
-	float ThisParent;	// These data can change when the line is current
-	float ThisArea;
-	float ThisPerimeter;
-	float ThisSumX;
-	float ThisSumY;
-	float ThisSumXX;
-	float ThisSumYY;
-	float ThisSumXY;
-	float ThisMinX;
-	float ThisMaxX;
-	float ThisMinY;
-	float ThisMaxY;
-	float LastPerimeter;	// This is the only data for retroactive change
-	
-	int HighRegionNum = 0;
-	int RegionNum = 0;
-	int ErrorFlag = 0;
-	
-	int LastRow, ThisRow;			// Row number
-	int LastStart, ThisStart;		// Starting column of run
-	int LastEnd, ThisEnd;			// Ending column of run
-	int LastColor, ThisColor;		// Color of run
-	
-	int LastIndex, ThisIndex;		// Which run are we up to?
-	int LastIndexCount, ThisIndexCount;	// Out of these runs
-	int LastRegionNum, ThisRegionNum;	// Which assignment?
-	int LastRegion[BLOBCOLCOUNT+2];	// Row assignment of region number
-	int ThisRegion[BLOBCOLCOUNT+2];	// Row assignment of region number
-	
-	int LastOffset = -(Trans + 2);	// For performance to avoid multiplication
-	int ThisOffset = 0;				// For performance to avoid multiplication
-	int ComputeData;
-
-	for(i = 0; i < BLOBTOTALCOUNT; i++)	// Initialize result arrays
-	{
-		SubsumedRegion[i] = 0;				// Flag indicates region is not subsumed
-		RegionData[i][0] = (float) -1;		// Flag indicates null region
-		for(int j = 1; j < BLOBDATACOUNT; j++)
-		{
-			if(j == BLOBMINX || j == BLOBMINY) RegionData[i][j] = (float) 1000000.0;
-			else RegionData[i][j] = (float) 0.0;
-		}
-	}
-	for(i = 0; i < BLOBROWCOUNT + 2; i++)	// Initialize result arrays
-	{
-		LastRegion[i] = -1;
-		ThisRegion[i] = -1;
-	}
-	RegionData[0][BLOBPARENT] = (float) -1;
-	RegionData[0][BLOBAREA] = (float) Transition[0];
-	RegionData[0][BLOBPERIMETER] = (float) (2 + 2 * Transition[0]);
-
-	ThisIndexCount = 1;
-	ThisRegion[0] = 0;	// Border region
-
-	// Initialize left border column
-	for(i = 1; i < Rows + 2; i++) { ThisRegion[i] = -1; } // Flag as uninit
-	
-	// Loop over all rows
-	for(ThisRow = 1; ThisRow < Rows + 2; ThisRow++)
-	{
-		//cout << "========= THIS ROW = " << ThisRow << endl;	// for debugging
-	
-		ThisOffset += Trans + 2;
-		ThisIndex = 0;
-		
-		LastOffset += Trans + 2;
-		LastRow = ThisRow - 1;
-		LastIndexCount = ThisIndexCount;
-		LastIndex = 0;
-
-		int EndLast = 0;
-		int EndThis = 0;
-		for(int j = 0; j < Trans + 2; j++)
-		{
-			int Index = ThisOffset + j;
-			int TranVal = Transition[Index];
-			if(TranVal > 0) ThisIndexCount = j + 1;	// stop at highest 
-
-			if(ThisRegion[j] == -1)  { EndLast = 1; }
-			if(TranVal < 0) { EndThis = 1; }
-
-			if(EndLast > 0 && EndThis > 0) { break; }
-
-			LastRegion[j] = ThisRegion[j];
-			ThisRegion[j] = -1;		// Flag indicates region is not initialized
-		}
-
-		int MaxIndexCount = LastIndexCount;
-		if(ThisIndexCount > MaxIndexCount) MaxIndexCount = ThisIndexCount;
-
-		// Main loop over runs within Last and This rows
-		while (LastIndex < LastIndexCount && ThisIndex < ThisIndexCount)
-		{
-			ComputeData = 0;
-		
-			if(LastIndex == 0) LastStart = 0;
-			else LastStart = Transition[LastOffset + LastIndex - 1];
-			LastEnd = Transition[LastOffset + LastIndex] - 1;
-			LastColor = LastIndex - 2 * (LastIndex / 2);
-			LastRegionNum = LastRegion[LastIndex];
-			
-			if(ThisIndex == 0) ThisStart = 0;
-			else ThisStart = Transition[ThisOffset + ThisIndex - 1];
-			ThisEnd = Transition[ThisOffset + ThisIndex] - 1;
-			ThisColor = ThisIndex - 2 * (ThisIndex / 2);
-			ThisRegionNum = ThisRegion[ThisIndex];
-
-if((LastColor != 1 && LastColor != 0) || (ThisColor != 1 && ThisColor != 0))
-{
-	cout << "1) LastColor=" << LastColor << "      ThisColor=" << ThisColor << endl;
-}
-
-
-			int TestA = (LastEnd < ThisStart - 1);	// initially false
-			int TestB = (ThisEnd < LastStart);		// initially false
-			int TestC = (LastStart < ThisStart);	// initially false
-			int TestD = (ThisEnd < LastEnd);
-			int TestE = (ThisEnd == LastEnd);
-
-			int TestMatch = (ThisColor == LastColor);		// initially true
-			int TestKnown = (ThisRegion[ThisIndex] >= 0);	// initially false
-
-			int Case = 0;
-			if(TestA) Case = 1;
-			else if(TestB) Case = 8;
-			else if(TestC)
-			{
-				if(TestD) Case = 3;
-				else if(!TestE) Case = 2;
-				else Case = 4;
-			}
-			else
-			{
-				if(TestE) Case = 5;
-				else if(TestD) Case = 7;
-				else Case = 6;
-			}
-
-			// Initialize common variables
-			ThisArea = (float) 0.0;
-			ThisSumX = ThisSumY = (float) 0.0;
-			ThisSumXX = ThisSumYY = ThisSumXY = (float) 0.0;
-			ThisMinX = ThisMinY = (float) 1000000.0;
-			ThisMaxX = ThisMaxY = (float) -1.0;
-			LastPerimeter = ThisPerimeter = (float) 0.0;
-			ThisParent = (float) -1;
-
-			// Determine necessary action and take it
-			switch (Case)
-			{ 
-				case 1: //|xxx    |
-						//|    yyy|
-					
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					LastIndex++;
-					break;
-					
-					
-				case 2: //|xxxxoo |
-						//|    yyy|
-					
-					if(TestMatch)	// Same color
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						LastPerimeter = LastEnd - ThisStart + 1;	// to subtract
-						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
-						ComputeData = 1;
-					}
-					
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					LastIndex++;
-					break;
-					
-					
-				case 3: //|xxxxxxx|
-						//|  yyyy |
-					
-					if(TestMatch)	// Same color
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						LastPerimeter = ThisArea;	// to subtract
-						ThisPerimeter = 2 + ThisArea;
-					}
-					else		// Different color => New region
-					{
-						ThisParent = LastRegionNum;
-						ThisRegionNum = ++HighRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						ThisPerimeter = 2 + 2 * ThisArea;
-					}
-					
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					ComputeData = 1;
-					ThisIndex++;
-					break;
-					
-					
-				case 4:	//|xxxxxxx|
-						//|  yyyyy|
-					
-					if(TestMatch)	// Same color
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						LastPerimeter = ThisArea;	// to subtract
-						ThisPerimeter = 2 + ThisArea;
-					}
-					else		// Different color => New region
-					{
-						ThisParent = LastRegionNum;
-						ThisRegionNum = ++HighRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						ThisPerimeter = 2 + 2 * ThisArea;
-					}
-					
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					ComputeData = 1;
-					LastIndex++;
-					ThisIndex++;
-					break;
-					
-					
-				case 5:	//|ooxxxxx|
-						//|yyyyyyy|
-					
-					if(!TestMatch && !TestKnown)	// Different color and unknown => new region
-					{
-						ThisParent = LastRegionNum;
-						ThisRegionNum = ++HighRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						ThisPerimeter = 2 + 2 * ThisArea;
-					}
-					else if(TestMatch && !TestKnown)	// Same color and unknown
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
-						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
-						ComputeData = 1;
-					}
-					else if(TestMatch && TestKnown)	// Same color and known
-					{
-						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
-						ThisPerimeter = - LastPerimeter;
-						if(ThisRegionNum > LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, ThisRegionNum, LastRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == ThisRegionNum) ThisRegion[iOld] = LastRegionNum;
-								if(LastRegion[iOld] == ThisRegionNum) LastRegion[iOld] = LastRegionNum;
-							}					
-							ThisRegionNum = LastRegionNum;
-						}
-						else if(ThisRegionNum < LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, LastRegionNum, ThisRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == LastRegionNum) ThisRegion[iOld] = ThisRegionNum;
-								if(LastRegion[iOld] == LastRegionNum) LastRegion[iOld] = ThisRegionNum;
-							}					
-							LastRegionNum = ThisRegionNum;
-						}
-					}
-
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					LastIndex++;
-					ThisIndex++;
-					break;
-					
-					
-				case 6:	//|ooxxx  |
-						//|yyyyyyy|
-
-					if(TestMatch && !TestKnown)
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
-						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
-						ComputeData = 1;
-					}
-					else if(TestMatch && TestKnown)
-					{
-						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
-						ThisPerimeter = - LastPerimeter;
-						if(ThisRegionNum > LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, ThisRegionNum, LastRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == ThisRegionNum) ThisRegion[iOld] = LastRegionNum;
-								if(LastRegion[iOld] == ThisRegionNum) LastRegion[iOld] = LastRegionNum;
-							}					
-							ThisRegionNum = LastRegionNum;
-						}
-						else if(ThisRegionNum < LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, LastRegionNum, ThisRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == LastRegionNum) ThisRegion[iOld] = ThisRegionNum;
-								if(LastRegion[iOld] == LastRegionNum) LastRegion[iOld] = ThisRegionNum;
-							}					
-							LastRegionNum = ThisRegionNum;
-						}
-					}
-
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					LastIndex++;
-					break;
-					
-					
-				case 7:	//|ooxxxxx|
-						//|yyyy   |
-					
-					if(!TestMatch && !TestKnown)	// Different color and unknown => new region
-					{
-						ThisParent = LastRegionNum;
-						ThisRegionNum = ++HighRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						ThisPerimeter = 2 + 2 * ThisArea;
-					}
-					else if(TestMatch && !TestKnown)
-					{
-						ThisRegionNum = LastRegionNum;
-						ThisArea = ThisEnd - ThisStart + 1;
-						ThisPerimeter = 2 + ThisArea;
-						LastPerimeter = ThisEnd - LastStart + 1;
-						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
-						ComputeData = 1;
-					}
-					else if(TestMatch && TestKnown)
-					{
-						LastPerimeter = ThisEnd - LastStart + 1;	// to subtract
-						ThisPerimeter = - LastPerimeter;
-						if(ThisRegionNum > LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, ThisRegionNum, LastRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == ThisRegionNum) ThisRegion[iOld] = LastRegionNum;
-								if(LastRegion[iOld] == ThisRegionNum) LastRegion[iOld] = LastRegionNum;
-							}					
-							ThisRegionNum = LastRegionNum;
-						}
-						else if(ThisRegionNum < LastRegionNum)
-						{
-							Subsume(RegionData, HighRegionNum, SubsumedRegion, LastRegionNum, ThisRegionNum);
-							for(int iOld = 0; iOld < MaxIndexCount; iOld++)
-							{
-								if(ThisRegion[iOld] == LastRegionNum) ThisRegion[iOld] = ThisRegionNum;
-								if(LastRegion[iOld] == LastRegionNum) LastRegion[iOld] = ThisRegionNum;
-							}					
-							LastRegionNum = ThisRegionNum;
-						}
-					}
-
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					ThisIndex++;
-					break;
-					
-				case 8:	//|    xxx|
-						//|yyyy   |
-					
-					ThisRegion[ThisIndex] = ThisRegionNum;
-					LastRegion[LastIndex] = LastRegionNum;
-					ThisIndex++;
-					break;
-					
-				default:
-					ErrorFlag = -1;
-			}	// end switch case
-
-			if(ComputeData > 0)
-			{
-				for(int k = ThisStart; k <= ThisEnd; k++)
-				{
-					ThisSumX += (float) (k - 1);
-					ThisSumXX += (float) (k - 1) * (k - 1);
-				}
-				float ImageRow = (float) (ThisRow - 1);
-
-				ThisSumXY = ThisSumX * ImageRow;
-				ThisSumY = ThisArea * ImageRow;
-				ThisSumYY = ThisSumY * ImageRow;
-					
-				if(ThisStart - 1 < (int) ThisMinX) ThisMinX = (float) (ThisStart - 1);
-				if(ThisMinX < (float) 0.0) ThisMinX = (float) 0.0;
-				if(ThisEnd - 1 > (int) ThisMaxX) ThisMaxX = (float) (ThisEnd - 1);
-
-				if(ImageRow < ThisMinY) ThisMinY = ImageRow;
-				if(ThisMinY < (float) 0.0) ThisMinY = (float) 0.0;
-				if(ImageRow > ThisMaxY) ThisMaxY = ImageRow;
-			}
-
-			if(ThisRegionNum >= 0)
-			{
-				if(ThisParent >= 0) { RegionData[ThisRegionNum][BLOBPARENT] = (float) ThisParent; }
-				RegionData[ThisRegionNum][BLOBCOLOR] = (float) ThisColor;	// New code
-				RegionData[ThisRegionNum][BLOBAREA] += ThisArea;
-				RegionData[ThisRegionNum][BLOBPERIMETER] += ThisPerimeter;
-				
-				if(ComputeData > 0)
-				{
-					RegionData[ThisRegionNum][BLOBSUMX] += ThisSumX;
-					RegionData[ThisRegionNum][BLOBSUMY] += ThisSumY;
-					RegionData[ThisRegionNum][BLOBSUMXX] += ThisSumXX;
-					RegionData[ThisRegionNum][BLOBSUMYY] += ThisSumYY;
-					RegionData[ThisRegionNum][BLOBSUMXY] += ThisSumXY;
-					RegionData[ThisRegionNum][BLOBPERIMETER] -= LastPerimeter;
-					if(RegionData[ThisRegionNum][BLOBMINX] > ThisMinX) RegionData[ThisRegionNum][BLOBMINX] = ThisMinX;
-					if(RegionData[ThisRegionNum][BLOBMAXX] < ThisMaxX) RegionData[ThisRegionNum][BLOBMAXX] = ThisMaxX;
-					if(RegionData[ThisRegionNum][BLOBMINY] > ThisMinY) RegionData[ThisRegionNum][BLOBMINY] = ThisMinY;
-					if(RegionData[ThisRegionNum][BLOBMAXY] < ThisMaxY) RegionData[ThisRegionNum][BLOBMAXY] = ThisMaxY;
-				}
-			}
-		}	// end Main loop
-
-		if(ErrorFlag != 0) return(ErrorFlag);
-	}	// end Loop over all rows
-
-	// Subsume regions that have too small area
-	for(int HiNum = HighRegionNum; HiNum > 0; HiNum--)
-	{
-		if(SubsumedRegion[HiNum] < 1 && RegionData[HiNum][BLOBAREA] < (float) MinArea)
-		{
-			Subsume(RegionData, HighRegionNum, SubsumedRegion, HiNum, (int) RegionData[HiNum][BLOBPARENT]);
-		}
-	}
-
-	// Condense the list
-	int iNew = 0;
-	for(int iOld = 0; iOld <= HighRegionNum; iOld++)
-	{
-		if(SubsumedRegion[iOld] < 1)	// This number not subsumed
-		{
-			// Move data from old region number to new region number
-			for(int j = 0; j < BLOBDATACOUNT; j++) { RegionData[iNew][j] = RegionData[iOld][j]; }
-
-			// Update and parent pointer if necessary
-			for(int i = 0; i <= HighRegionNum; i++)
-			{
-				if(RegionData[i][BLOBPARENT] == iOld) { RegionData[i][BLOBPARENT] = iNew; }
-			}
-			iNew++;
-		}	
-	}
-	HighRegionNum = iNew - 1;				// Update where the data ends
-	RegionData[HighRegionNum + 1][0] = -1;	// and set end of array flag
-
-	// Normalize summation fields into moments 
-	for(ThisRegionNum = 0; ThisRegionNum <= HighRegionNum; ThisRegionNum++)
-	{
-		// Extract fields
-		float Area = RegionData[ThisRegionNum][BLOBAREA];
-		float SumX = RegionData[ThisRegionNum][BLOBSUMX];
-		float SumY = RegionData[ThisRegionNum][BLOBSUMY];
-		float SumXX = RegionData[ThisRegionNum][BLOBSUMXX];
-		float SumYY = RegionData[ThisRegionNum][BLOBSUMYY];
-		float SumXY = RegionData[ThisRegionNum][BLOBSUMXY];
-	
-		// Get averages
-		SumX /= Area;
-		SumY /= Area;
-		SumXX /= Area;
-		SumYY /= Area;
-		SumXY /= Area;
-
-		// Create moments
-		SumXX -= SumX * SumX;
-		SumYY -= SumY * SumY;
-		SumXY -= SumX * SumY;
-		if(SumXY > -1.0E-14 && SumXY < 1.0E-14)
-		{
-			SumXY = (float) 0.0; // Eliminate roundoff error
-		}
-		RegionData[ThisRegionNum][BLOBSUMX] = SumX;
-		RegionData[ThisRegionNum][BLOBSUMY] = SumY;
-		RegionData[ThisRegionNum][BLOBSUMXX] = SumXX;
-		RegionData[ThisRegionNum][BLOBSUMYY] = SumYY;
-		RegionData[ThisRegionNum][BLOBSUMXY] = SumXY;
-	}
-
-	for(ThisRegionNum = HighRegionNum; ThisRegionNum > 0 ; ThisRegionNum--)
-	{
-		// Subtract interior perimeters
-		int ParentRegionNum = (int) RegionData[ThisRegionNum][BLOBPARENT];
-		RegionData[ParentRegionNum][BLOBPERIMETER]
-			-= RegionData[ThisRegionNum][BLOBPERIMETER];
-	}
-
-	return(HighRegionNum);
-}
-
+//***********************************************************//
+//* Blob analysis package  Version1.2                       *//
+//* Added:                                                  *//
+//* - BlobRegions: tables sized to the image (no row,       *//
+//*   column or region count limits), reused between calls  *//
+//* - Union-find region merging, linear time condensing     *//
+//* - BlobAnalysisParallel: strips labeled by threads       *//
+//* - BlobRowRuns: run extraction 64 pixels at a time (SSE2)*//
+//* - Exact integer area, perimeter and moment sums         *//
+//* History:                                                *//
+//* - Version 1.1 28 December 2003 (BLOBCOLOR)              *//
+//* - Version 1.0 8 August 2003                             *//
+//*                                                         *//
+//* Input: IplImage* binary image                           *//
+//* Output: attributes of each connected region             *//
+//* Author: Dave Grossman                                   *//
+//* Email: dgrossman@cdr.stanford.edu                       *//
+//* Acknowledgement: the algorithm has been around > 20 yrs *//
+//***********************************************************//
+
+#include <vector>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// defines for blob data indices
+#define BLOBPARENT 0
+#define BLOBCOLOR 1
+#define BLOBAREA 2
+#define BLOBPERIMETER 3
+#define BLOBSUMX 4
+#define BLOBSUMY 5
+#define BLOBSUMXX 6
+#define BLOBSUMYY 7
+#define BLOBSUMXY 8
+#define BLOBMINX 9
+#define BLOBMAXX 10
+#define BLOBMINY 11
+#define BLOBMAXY 12
+
+#define BLOBDATACOUNT 13
+
+// min rows of a strip in BlobAnalysisParallel
+#define BLOBSTRIPROWS 64
+
+// Region table and working storage of BlobAnalysis.
+// Region data is laid out one array per field (Field[BLOBAREA][Region],
+// ...), arrays grow as regions are found. Keep one object between
+// images: storage is only reallocated when an image needs more.
+//
+// While the image is scanned, region numbers that touch are joined in
+// a union-find forest (path compression, union by rank). Area,
+// perimeter, moment sums and bounds of a set are kept at its root and
+// the set is known by its lowest number, BLOBPARENT is the parent
+// number given when a region was created. BlobAnalysis renumbers and
+// condenses the table at the end, so afterwards region r has its
+// data at Field[...][r].
+//
+// Area, perimeter and moment sums (BLOBAREA..BLOBSUMXY) are summed up
+// exactly as integers in Sum[...][r]; BlobAnalysis converts them to
+// Field (moments, in double) at the end and leaves the exact area,
+// perimeter and raw moment sums in Sum.
+struct BlobRegions
+{
+	std::vector<float> Field[BLOBDATACOUNT];	// Region data, by field
+	std::vector<long long> Sum[BLOBDATACOUNT];	// Exact sums (BLOBAREA..BLOBSUMXY)
+	std::vector<int> Root;			// Union-find link (itself at roots)
+	std::vector<int> Rank;			// Union-find rank of roots
+	std::vector<int> Label;			// Lowest region number of a root's set
+	std::vector<int> NewNumber;		// Region number after condensing
+
+	std::vector<int> Transition;	// Run ends of each row, row ends with -1
+	std::vector<int> RowStart;		// Offset of each row in Transition
+	std::vector<int> RowRuns;		// Run ends of one row
+	std::vector<int> LastRegion;	// Row assignment of region number
+	std::vector<int> ThisRegion;	// Row assignment of region number
+
+	std::vector<BlobRegions*> Strips;	// Tables of strips (BlobAnalysisParallel)
+
+	BlobRegions(): Root(), Rank(), Label(), NewNumber(), Transition(),
+		RowStart(), RowRuns(), LastRegion(), ThisRegion(), Strips() {}
+
+	~BlobRegions()
+	{
+		for(unsigned int i = 0; i < Strips.size(); i++) { delete Strips[i]; }
+	}
+
+	// Number of regions, incl background region 0
+	int Size() const { return (int) Field[BLOBPARENT].size(); }
+
+	// Drop all regions (keeps storage)
+	void Clear()
+	{
+		for(int i = 0; i < BLOBDATACOUNT; i++) { Field[i].clear(); Sum[i].clear(); }
+		Root.clear();
+		Rank.clear();
+		Label.clear();
+	}
+
+	// Append a null region, return its number
+	int Add()
+	{
+		for(int i = 0; i < BLOBDATACOUNT; i++)
+		{
+			if(i == BLOBPARENT) Field[i].push_back((float) -1);	// Flag indicates null region
+			else if(i == BLOBMINX || i == BLOBMINY) Field[i].push_back((float) 1000000.0);
+			else Field[i].push_back((float) 0.0);
+			if(i >= BLOBAREA && i <= BLOBSUMXY) Sum[i].push_back(0);
+		}
+		int Num = Size() - 1;
+		Root.push_back(Num);		// Region is a set of its own
+		Rank.push_back(0);
+		Label.push_back(Num);
+		return(Num);
+	}
+
+	// Root of the set of a region number
+	int Find(int Num)
+	{
+		int Top = Num;
+		while(Root[Top] != Top) { Top = Root[Top]; }
+		while(Root[Num] != Top)		// Path compression
+		{
+			int Next = Root[Num];
+			Root[Num] = Top;
+			Num = Next;
+		}
+		return(Top);
+	}
+
+	// Lowest region number of the set of a region number
+	int Region(int Num)
+	{
+		return(Label[Find(Num)]);
+	}
+
+	// Keep only the first Count regions
+	void Resize(int Count)
+	{
+		for(int i = 0; i < BLOBDATACOUNT; i++)
+		{
+			Field[i].resize(Count);
+			if(i >= BLOBAREA && i <= BLOBSUMXY) Sum[i].resize(Count);
+		}
+	}
+
+	// Join sets of two region numbers, data is not moved.
+	// Returns root of joined set
+	int Join(int NumA, int NumB, int* OldRoot = NULL)
+	{
+		int RootA = Find(NumA);
+		int RootB = Find(NumB);
+		if(OldRoot) *OldRoot = -1;
+		if(RootA == RootB) return(RootA);
+
+		// Union by rank
+		if(Rank[RootA] < Rank[RootB]) { int Swap = RootA; RootA = RootB; RootB = Swap; }
+		else if(Rank[RootA] == Rank[RootB]) { Rank[RootA]++; }
+		Root[RootB] = RootA;
+
+		// Set keeps lowest number
+		if(Label[RootB] < Label[RootA]) { Label[RootA] = Label[RootB]; }
+		if(OldRoot) *OldRoot = RootB;
+		return(RootA);
+	}
+
+private:
+	BlobRegions(const BlobRegions&);			// Non copyable (owns strips)
+	BlobRegions& operator=(const BlobRegions&);
+};
+
+// Subroutine prototypes
+void PrintRegionDataArray(const BlobRegions&);
+void Subsume(BlobRegions&, int, int);
+int BlobRowRuns(const uchar*, int, uchar, int*);
+void BlobTransitions(IplImage*, BlobRegions&, int, int, uchar, int, int);
+int BlobLabelRows(BlobRegions&, int, int, int);
+int BlobResults(BlobRegions&, int);
+int BlobAnalysis(IplImage*, BlobRegions&, int, int, uchar, int);
+void* BlobStripWorker(void*);
+int BlobAnalysisParallel(IplImage*, BlobRegions&, int, int, uchar, int, int);
+
+// Join sets of two region numbers, fields are transferred to the
+// root of the joined set (HiNum's set is the one subsumed)
+void Subsume(BlobRegions& Regions,
+			int HiNum,
+			int LoNum)
+{
+	// cout << "\nSubsuming " << HiNum << " into " << LoNum << endl; // for debugging
+
+	int LoRoot = Regions.Find(LoNum);
+	int OldRoot;
+	int NewRoot = Regions.Join(HiNum, LoNum, &OldRoot);
+	if(OldRoot < 0) return;
+
+	int i;
+	for(i = BLOBCOLOR; i < BLOBDATACOUNT; i++)
+	{
+		std::vector<float>& Data = Regions.Field[i];
+		if(i == BLOBCOLOR)	// Same color, lowest number's one wins
+		{
+			Data[NewRoot] = Data[LoRoot];
+		}
+		else if(i == BLOBMINX || i == BLOBMINY)
+		{
+			if(Data[NewRoot] > Data[OldRoot]) { Data[NewRoot] = Data[OldRoot]; }
+		}
+		else if(i == BLOBMAXX || i == BLOBMAXY)
+		{
+		 	if(Data[NewRoot] < Data[OldRoot]) { Data[NewRoot] = Data[OldRoot]; }
+		}
+		else // Area, Perimeter, SumX, SumY, SumXX, SumYY, SumXY
+		{
+			Regions.Sum[i][NewRoot] += Regions.Sum[i][OldRoot];
+		}
+	}
+}
+
+// Print region data array
+void PrintRegionDataArray(const BlobRegions& Regions)
+{
+	cout << "RegionData array:" << endl;
+	for(int ThisRegion = 0; ThisRegion < Regions.Size(); ThisRegion++)
+	{
+		cout << "Region=" << ThisRegion << ": ";
+		for(int ThisData = 0; ThisData < BLOBDATACOUNT; ThisData++)
+		{
+			float Data = Regions.Field[ThisData][ThisRegion];
+			cout << Data << " " ;
+		}
+		cout << endl;
+	}
+	cout << endl;
+}
+
+// Run length encoder of an image row with a pixel of color Border on
+// each side (bordered row of Cols + 2 pixels). Stores the end (last
+// column + 1) of each run of equal pixels in Ends, which needs room for
+// Cols + 2 values. Returns number of runs.
+//
+// Pixels are compared with their left neighbours 64 at a time, changes
+// make a bit mask and run ends are read from it with bit scans, so
+// uniform parts of a row cost one test per 64 pixels
+int BlobRowRuns(const uchar* Row,	// image row
+	int Cols,						// pixels in row
+	uchar Border,					// border color
+	int* Ends)						// run ends, in bordered row columns
+{
+	int Count = 0;
+	int i = 1;						// Pixel compared with pixel i - 1
+
+	if(Row[0] != Border) Ends[Count++] = 1;	// Left border run
+
+#ifdef __SSE2__
+	for(; i + 64 <= Cols; i += 64)
+	{
+		unsigned long long Same = 0;
+		for(int k = 0; k < 64; k += 16)
+		{
+			__m128i This = _mm_loadu_si128((const __m128i*) (Row + i + k));
+			__m128i Last = _mm_loadu_si128((const __m128i*) (Row + i + k - 1));
+			Same |= (unsigned long long) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(This, Last)) << k;
+		}
+		unsigned long long Change = ~Same;
+		while(Change)
+		{
+			Ends[Count++] = i + __builtin_ctzll(Change) + 1;	// Pixel i is column i + 1
+			Change &= Change - 1;
+		}
+	}
+#endif
+	for(; i < Cols; i++)
+	{
+		if(Row[i] != Row[i - 1]) Ends[Count++] = i + 1;
+	}
+
+	if(Row[Cols - 1] != Border) Ends[Count++] = Cols + 1;	// Right border run
+	Ends[Count++] = Cols + 2;		// Save completed run
+	return(Count);
+}
+
+// Fill transition array for rows StartRow..EndRow of the bordered
+// image (row 0 and row Rows+1 represent the border). Row iRow is stored
+// from Transition[RowStart[iRow - StartRow]] and ends with -1
+void BlobTransitions(IplImage* ImageHdr,	// input image
+	BlobRegions& Regions,				// gets Transition and RowStart
+	int Cols, int Rows,					// size of input image
+	uchar Border,						// border color
+	int StartRow, int EndRow)			// rows of bordered image
+{
+	const uchar* Image = (const uchar*) ImageHdr->imageData;
+	int WidthStep = ImageHdr->widthStep; 
+
+	// Convert image array into transition array. In each row
+	// the transition array tells which columns have a color change
+	int ImageOffset = ((StartRow > 0 ? StartRow : 1) - 2) * WidthStep;	// Row before first image row
+	int iRow;
+
+	std::vector<int>& Transition = Regions.Transition;
+	std::vector<int>& RowStart = Regions.RowStart;
+	Regions.RowRuns.resize(Cols + 2);
+	int* Runs = &Regions.RowRuns[0];
+
+	// Initialize Transition array
+	Transition.clear();
+	RowStart.resize(EndRow - StartRow + 1);
+
+	// Fill Transition array
+	for(iRow = StartRow; iRow <= EndRow; iRow++)		// Choose a row of Bordered image
+	{
+		RowStart[iRow - StartRow] = (int) Transition.size();
+		if(iRow == 0 || iRow == Rows + 1)	// Border row is one run
+		{
+			Transition.push_back(Cols + 2);
+			Transition.push_back(-1);
+			continue;
+		}
+
+		ImageOffset += WidthStep;	// Performance booster to avoid multiplication
+		int Count = BlobRowRuns(Image + ImageOffset, Cols, Border, Runs);
+		Transition.insert(Transition.end(), Runs, Runs + Count);
+		Transition.push_back(-1);
+	}
+}
+
+// Assign region numbers to runs of rows StartRow+1..EndRow of the
+// bordered image, from transition array made by BlobTransitions. Runs
+// of row StartRow must have their numbers in Regions.ThisRegion.
+// Returns 0, -1 in error
+int BlobLabelRows(BlobRegions& Regions,	// regions found so far
+	int Cols,							// size of input image
+	int StartRow, int EndRow)			// rows of bordered image
+{
+	const int* Transition = &Regions.Transition[0];
+	const int* RowStart = &Regions.RowStart[0];
+	int Trans = Cols;				// max trans in any row
+
+	// Process transition code depending on Last row and This row
+	//
+	// Last ---++++++--+++++++++++++++-----+++++++++++++++++++-----++++++-------+++---
+	// This -----+++-----++++----+++++++++----+++++++---++------------------++++++++--
+	//
+	// There are various possibilities:
+	//
+	// Case     1       2       3       4       5       6       7       8
+	// Last |xxx    |xxxxoo |xxxxxxx|xxxxxxx|ooxxxxx|ooxxx  |ooxxxxx|    xxx|
+	// This |    yyy|    yyy|  yyyy |  yyyyy|yyyyyyy|yyyyyyy|yyyy   |yyyy   |
+	// Here o is optional
+	// 
+	// Here are the primitive tests to distinguish these 6 cases:
+	//   A) Last end < This start - 1 OR NOT		Note: -1
+	//   B) This end < Last start OR NOT
+	//   C) Last start < This start OR NOT
+	//   D) This end < Last end OR NOT
+	//   E) This end = Last end OR NOT
+	//
+	// Here is how to use these tests to determine the case:
+	//   Case 1 = A [=> NOT B AND C AND NOT D AND NOT E]
+	//   Case 2 = C AND NOT D AND NOT E [AND NOT A AND NOT B]
+	//   Case 3 = C AND D [=> NOT E] [AND NOT A AND NOT B]
+	//   Case 4 = C AND NOT D AND E [AND NOT A AND NOT B]
+	//   Case 5 = NOT C AND E [=> NOT D] [AND NOT A AND NOT B]
+	//   Case 6 = NOT C AND NOT D AND NOT E [AND NOT A AND NOT B]
+	//   Case 7 = NOT C AND D [=> NOT E] [AND NOT A AND NOT B]
+	//   Case 8 = B [=> NOT A AND NOT C AND D AND NOT E]
+	//
+	// In cases 2,3,4,5,6,7 the following additional test is needed:
+	//   Match) This color = Last color OR NOT
+	//
+	// In cases 5,6,7 the following additional test is needed:
+	//   Known) This region was already matched OR NOT
+	//
+	// Here are the main tests and actions:
+	//   Case 1: LastIndex++;
+	//   Case 2: if(Match) {y = x;}
+	//           LastIndex++;
+	//   Case 3: if(Match) {y = x;}
+	//           else {y = new}
+	//           ThisIndex++;
+	//   Case 4: if(Match) {y = x;}
+	//           else {y = new}
+	//           LastIndex++;
+	//           ThisIndex++;
+	//   Case 5: if(Match AND NOT Known) {y = x}
+	//           else if(Match AND Known) {Subsume(x,y)}
+	//           LastIndex++;ThisIndex++
+	//   Case 6: if(Match AND NOT Known) {y = x}
+	//           else if(Match AND Known) {Subsume(x,y)}
+	//           LastIndex++;
+	//   Case 7: if(Match AND NOT Known) {y = x}
+	//           else if(Match AND Known) {Subsume(x,y)}
+	//           ThisIndex++;
+	//   Case 8: ThisIndex++;
+
+	// Regions.Size() is num of regions incl all temps and background
+	// BLOBDATACOUNT is number of data elements for each region as follows:
+	// BLOBPARENT 0	these are the respective indices for the data elements
+	// BLOBCOLOR 1		0=background; 1=non-background
+	// BLOBAREA 2
+	// BLOBPERIMETER 3
+	// BLOBSUMX 4		means
+	// BLOBSUMY 5
+	// BLOBSUMXX 6		2nd moments
+	// BLOBSUMYY 7
+	// BLOBSUMXY 8
+	// BLOBMINX 9		bounding rectangle
+	// BLOBMAXX 10
+	// BLOBMINY 11
+	// BLOBMAXY 12
+
+	float ThisParent;	// These data can change when the line is current
+	int ThisArea;
+	int ThisPerimeter;
+	long long ThisSumX;
+	long long ThisSumY;
+	long long ThisSumXX;
+	long long ThisSumYY;
+	long long ThisSumXY;
+	float ThisMinX;
+	float ThisMaxX;
+	float ThisMinY;
+	float ThisMaxY;
+	int LastPerimeter;	// This is the only data for retroactive change
+	
+	int HighRegionNum;
+	int RegionNum = 0;
+	int ErrorFlag = 0;
+	
+	int LastRow, ThisRow;			// Row number
+	int LastStart, ThisStart;		// Starting column of run
+	int LastEnd, ThisEnd;			// Ending column of run
+	int LastColor, ThisColor;		// Color of run
+	
+	int LastIndex, ThisIndex;		// Which run are we up to?
+	int LastIndexCount, ThisIndexCount;	// Out of these runs
+	int LastRegionNum, ThisRegionNum;	// Which assignment?
+	int LastOffset, ThisOffset;		// Start of row in Transition array
+	int ComputeData;
+
+	int* LastRegion = &Regions.LastRegion[0];
+	int* ThisRegion = &Regions.ThisRegion[0];
+
+	// Runs of first row
+	for(ThisIndexCount = 0; Transition[ThisIndexCount] >= 0; ThisIndexCount++) {}
+
+	// Loop over all rows
+	for(ThisRow = StartRow + 1; ThisRow <= EndRow; ThisRow++)
+	{
+		//cout << "========= THIS ROW = " << ThisRow << endl;	// for debugging
+	
+		ThisOffset = RowStart[ThisRow - StartRow];
+		ThisIndex = 0;
+		
+		LastOffset = RowStart[ThisRow - StartRow - 1];
+		LastRow = ThisRow - 1;
+		LastIndexCount = ThisIndexCount;
+		LastIndex = 0;
+
+		int EndLast = 0;
+		int EndThis = 0;
+		for(int j = 0; j < Trans + 3; j++)
+		{
+			if(EndThis == 0)	// Row is packed, nothing to read after its -1
+			{
+				int TranVal = Transition[ThisOffset + j];
+				if(TranVal > 0) ThisIndexCount = j + 1;	// stop at highest 
+				if(TranVal < 0) { EndThis = 1; }
+			}
+
+			if(ThisRegion[j] == -1)  { EndLast = 1; }
+
+			if(EndLast > 0 && EndThis > 0) { break; }
+
+			LastRegion[j] = ThisRegion[j];
+			ThisRegion[j] = -1;		// Flag indicates region is not initialized
+		}
+
+		// Main loop over runs within Last and This rows
+		while (LastIndex < LastIndexCount && ThisIndex < ThisIndexCount)
+		{
+			ComputeData = 0;
+		
+			if(LastIndex == 0) LastStart = 0;
+			else LastStart = Transition[LastOffset + LastIndex - 1];
+			LastEnd = Transition[LastOffset + LastIndex] - 1;
+			LastColor = LastIndex - 2 * (LastIndex / 2);
+			LastRegionNum = LastRegion[LastIndex];
+			if(LastRegionNum >= 0) LastRegionNum = Regions.Region(LastRegionNum);	// May be subsumed
+			
+			if(ThisIndex == 0) ThisStart = 0;
+			else ThisStart = Transition[ThisOffset + ThisIndex - 1];
+			ThisEnd = Transition[ThisOffset + ThisIndex] - 1;
+			ThisColor = ThisIndex - 2 * (ThisIndex / 2);
+			ThisRegionNum = ThisRegion[ThisIndex];
+			if(ThisRegionNum >= 0) ThisRegionNum = Regions.Region(ThisRegionNum);
+
+if((LastColor != 1 && LastColor != 0) || (ThisColor != 1 && ThisColor != 0))
+{
+	cout << "1) LastColor=" << LastColor << "      ThisColor=" << ThisColor << endl;
+}
+
+
+			int TestA = (LastEnd < ThisStart - 1);	// initially false
+			int TestB = (ThisEnd < LastStart);		// initially false
+			int TestC = (LastStart < ThisStart);	// initially false
+			int TestD = (ThisEnd < LastEnd);
+			int TestE = (ThisEnd == LastEnd);
+
+			int TestMatch = (ThisColor == LastColor);		// initially true
+			int TestKnown = (ThisRegion[ThisIndex] >= 0);	// initially false
+
+			int Case = 0;
+			if(TestA) Case = 1;
+			else if(TestB) Case = 8;
+			else if(TestC)
+			{
+				if(TestD) Case = 3;
+				else if(!TestE) Case = 2;
+				else Case = 4;
+			}
+			else
+			{
+				if(TestE) Case = 5;
+				else if(TestD) Case = 7;
+				else Case = 6;
+			}
+
+			// Initialize common variables
+			ThisArea = 0;
+			ThisSumX = ThisSumY = 0;
+			ThisSumXX = ThisSumYY = ThisSumXY = 0;
+			ThisMinX = ThisMinY = (float) 1000000.0;
+			ThisMaxX = ThisMaxY = (float) -1.0;
+			LastPerimeter = ThisPerimeter = 0;
+			ThisParent = (float) -1;
+
+			// Determine necessary action and take it
+			switch (Case)
+			{ 
+				case 1: //|xxx    |
+						//|    yyy|
+					
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					LastIndex++;
+					break;
+					
+					
+				case 2: //|xxxxoo |
+						//|    yyy|
+					
+					if(TestMatch)	// Same color
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						LastPerimeter = LastEnd - ThisStart + 1;	// to subtract
+						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
+						ComputeData = 1;
+					}
+					
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					LastIndex++;
+					break;
+					
+					
+				case 3: //|xxxxxxx|
+						//|  yyyy |
+					
+					if(TestMatch)	// Same color
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						LastPerimeter = ThisArea;	// to subtract
+						ThisPerimeter = 2 + ThisArea;
+					}
+					else		// Different color => New region
+					{
+						ThisParent = LastRegionNum;
+						ThisRegionNum = HighRegionNum = Regions.Add();
+						ThisArea = ThisEnd - ThisStart + 1;
+						ThisPerimeter = 2 + 2 * ThisArea;
+					}
+					
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					ComputeData = 1;
+					ThisIndex++;
+					break;
+					
+					
+				case 4:	//|xxxxxxx|
+						//|  yyyyy|
+					
+					if(TestMatch)	// Same color
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						LastPerimeter = ThisArea;	// to subtract
+						ThisPerimeter = 2 + ThisArea;
+					}
+					else		// Different color => New region
+					{
+						ThisParent = LastRegionNum;
+						ThisRegionNum = HighRegionNum = Regions.Add();
+						ThisArea = ThisEnd - ThisStart + 1;
+						ThisPerimeter = 2 + 2 * ThisArea;
+					}
+					
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					ComputeData = 1;
+					LastIndex++;
+					ThisIndex++;
+					break;
+					
+					
+				case 5:	//|ooxxxxx|
+						//|yyyyyyy|
+					
+					if(!TestMatch && !TestKnown)	// Different color and unknown => new region
+					{
+						ThisParent = LastRegionNum;
+						ThisRegionNum = HighRegionNum = Regions.Add();
+						ThisArea = ThisEnd - ThisStart + 1;
+						ThisPerimeter = 2 + 2 * ThisArea;
+					}
+					else if(TestMatch && !TestKnown)	// Same color and unknown
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
+						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
+						ComputeData = 1;
+					}
+					else if(TestMatch && TestKnown)	// Same color and known
+					{
+						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
+						ThisPerimeter = - LastPerimeter;
+						if(ThisRegionNum != LastRegionNum)
+						{
+							Subsume(Regions, ThisRegionNum, LastRegionNum);
+							if(ThisRegionNum > LastRegionNum) ThisRegionNum = LastRegionNum;
+							else LastRegionNum = ThisRegionNum;
+						}
+					}
+
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					LastIndex++;
+					ThisIndex++;
+					break;
+					
+					
+				case 6:	//|ooxxx  |
+						//|yyyyyyy|
+
+					if(TestMatch && !TestKnown)
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
+						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
+						ComputeData = 1;
+					}
+					else if(TestMatch && TestKnown)
+					{
+						LastPerimeter = LastEnd - LastStart + 1;	// to subtract
+						ThisPerimeter = - LastPerimeter;
+						if(ThisRegionNum != LastRegionNum)
+						{
+							Subsume(Regions, ThisRegionNum, LastRegionNum);
+							if(ThisRegionNum > LastRegionNum) ThisRegionNum = LastRegionNum;
+							else LastRegionNum = ThisRegionNum;
+						}
+					}
+
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					LastIndex++;
+					break;
+					
+					
+				case 7:	//|ooxxxxx|
+						//|yyyy   |
+					
+					if(!TestMatch && !TestKnown)	// Different color and unknown => new region
+					{
+						ThisParent = LastRegionNum;
+						ThisRegionNum = HighRegionNum = Regions.Add();
+						ThisArea = ThisEnd - ThisStart + 1;
+						ThisPerimeter = 2 + 2 * ThisArea;
+					}
+					else if(TestMatch && !TestKnown)
+					{
+						ThisRegionNum = LastRegionNum;
+						ThisArea = ThisEnd - ThisStart + 1;
+						ThisPerimeter = 2 + ThisArea;
+						LastPerimeter = ThisEnd - LastStart + 1;
+						ThisPerimeter = 2 + 2 * ThisArea - LastPerimeter;
+						ComputeData = 1;
+					}
+					else if(TestMatch && TestKnown)
+					{
+						LastPerimeter = ThisEnd - LastStart + 1;	// to subtract
+						ThisPerimeter = - LastPerimeter;
+						if(ThisRegionNum != LastRegionNum)
+						{
+							Subsume(Regions, ThisRegionNum, LastRegionNum);
+							if(ThisRegionNum > LastRegionNum) ThisRegionNum = LastRegionNum;
+							else LastRegionNum = ThisRegionNum;
+						}
+					}
+
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					ThisIndex++;
+					break;
+					
+				case 8:	//|    xxx|
+						//|yyyy   |
+					
+					ThisRegion[ThisIndex] = ThisRegionNum;
+					LastRegion[LastIndex] = LastRegionNum;
+					ThisIndex++;
+					break;
+					
+				default:
+					ErrorFlag = -1;
+			}	// end switch case
+
+			if(ComputeData > 0)
+			{
+				// Sums of x = k - 1 and x * x over the run
+				// (arithmetic series), x from First to Last
+				long long First = ThisStart - 1;
+				long long Last = ThisEnd - 1;
+				ThisSumX = (First + Last) * (Last - First + 1) / 2;
+				ThisSumXX = (Last * (Last + 1) * (2 * Last + 1)
+					- (First - 1) * First * (2 * First - 1)) / 6;
+				long long ImageRow = ThisRow - 1;
+
+				ThisSumXY = ThisSumX * ImageRow;
+				ThisSumY = ThisArea * ImageRow;
+				ThisSumYY = ThisSumY * ImageRow;
+					
+				if(ThisStart - 1 < (int) ThisMinX) ThisMinX = (float) (ThisStart - 1);
+				if(ThisMinX < (float) 0.0) ThisMinX = (float) 0.0;
+				if(ThisEnd - 1 > (int) ThisMaxX) ThisMaxX = (float) (ThisEnd - 1);
+
+				if(ImageRow < ThisMinY) ThisMinY = (float) ImageRow;
+				if(ThisMinY < (float) 0.0) ThisMinY = (float) 0.0;
+				if(ImageRow > ThisMaxY) ThisMaxY = (float) ImageRow;
+			}
+
+			if(ThisRegionNum >= 0)
+			{
+				if(ThisParent >= 0) { Regions.Field[BLOBPARENT][ThisRegionNum] = (float) ThisParent; }
+				int Root = Regions.Find(ThisRegionNum);	// Set data is kept at root
+				Regions.Field[BLOBCOLOR][Root] = (float) ThisColor;	// New code
+				Regions.Sum[BLOBAREA][Root] += ThisArea;
+				Regions.Sum[BLOBPERIMETER][Root] += ThisPerimeter;
+				
+				if(ComputeData > 0)
+				{
+					Regions.Sum[BLOBSUMX][Root] += ThisSumX;
+					Regions.Sum[BLOBSUMY][Root] += ThisSumY;
+					Regions.Sum[BLOBSUMXX][Root] += ThisSumXX;
+					Regions.Sum[BLOBSUMYY][Root] += ThisSumYY;
+					Regions.Sum[BLOBSUMXY][Root] += ThisSumXY;
+					Regions.Sum[BLOBPERIMETER][Root] -= LastPerimeter;
+					if(Regions.Field[BLOBMINX][Root] > ThisMinX) Regions.Field[BLOBMINX][Root] = ThisMinX;
+					if(Regions.Field[BLOBMAXX][Root] < ThisMaxX) Regions.Field[BLOBMAXX][Root] = ThisMaxX;
+					if(Regions.Field[BLOBMINY][Root] > ThisMinY) Regions.Field[BLOBMINY][Root] = ThisMinY;
+					if(Regions.Field[BLOBMAXY][Root] < ThisMaxY) Regions.Field[BLOBMAXY][Root] = ThisMaxY;
+				}
+			}
+		}	// end Main loop
+
+		if(ErrorFlag != 0) return(ErrorFlag);
+	}	// end Loop over all rows
+
+	return(0);
+}
+
+// Subsume regions smaller than MinArea into their parents, condense
+// the region table and turn sums into moments. Returns number of
+// highest region
+int BlobResults(BlobRegions& Regions,	// labeled regions
+	int MinArea)						// min area of a region
+{
+	int HighRegionNum = Regions.Size() - 1;
+	int ThisRegionNum;
+
+	// Subsume regions that have too small area
+	for(int HiNum = HighRegionNum; HiNum > 0; HiNum--)
+	{
+		if(Regions.Region(HiNum) == HiNum && Regions.Sum[BLOBAREA][Regions.Find(HiNum)] < MinArea)
+		{
+			Subsume(Regions, HiNum, (int) Regions.Field[BLOBPARENT][HiNum]);
+		}
+	}
+
+	// Condense the list: number the sets by their lowest number, in order
+	std::vector<int>& NewNumber = Regions.NewNumber;
+	NewNumber.resize(HighRegionNum + 1);
+	int iNew = 0;
+	for(int iOld = 0; iOld <= HighRegionNum; iOld++)
+	{
+		if(Regions.Region(iOld) == iOld) { NewNumber[iOld] = iNew++; }	// This number not subsumed
+	}
+	int RegionCount = iNew;
+	for(int iOld = 0; iOld <= HighRegionNum; iOld++)
+	{
+		if(Regions.Region(iOld) != iOld) continue;
+
+		// Move data from set root to new region number, slots
+		// below iNew are done and no root or number left is below it
+		iNew = NewNumber[iOld];
+		int Root = Regions.Find(iOld);
+		int Parent = (int) Regions.Field[BLOBPARENT][iOld];
+		for(int j = BLOBCOLOR; j < BLOBDATACOUNT; j++)
+		{
+			Regions.Field[j][iNew] = Regions.Field[j][Root];
+			if(j >= BLOBAREA && j <= BLOBSUMXY) Regions.Sum[j][iNew] = Regions.Sum[j][Root];
+		}
+
+		// Update parent pointer: lowest number of parent's set, renumbered
+		if(Parent >= 0) Parent = NewNumber[Regions.Region(Parent)];
+		Regions.Field[BLOBPARENT][iNew] = (float) Parent;
+	}
+	HighRegionNum = RegionCount - 1;		// Update where the data ends
+	Regions.Resize(RegionCount);			// and drop the rest
+
+	// Normalize summation fields into moments 
+	for(ThisRegionNum = 0; ThisRegionNum <= HighRegionNum; ThisRegionNum++)
+	{
+		// Extract fields
+		double Area = (double) Regions.Sum[BLOBAREA][ThisRegionNum];
+		double SumX = (double) Regions.Sum[BLOBSUMX][ThisRegionNum];
+		double SumY = (double) Regions.Sum[BLOBSUMY][ThisRegionNum];
+		double SumXX = (double) Regions.Sum[BLOBSUMXX][ThisRegionNum];
+		double SumYY = (double) Regions.Sum[BLOBSUMYY][ThisRegionNum];
+		double SumXY = (double) Regions.Sum[BLOBSUMXY][ThisRegionNum];
+	
+		// Get averages
+		SumX /= Area;
+		SumY /= Area;
+		SumXX /= Area;
+		SumYY /= Area;
+		SumXY /= Area;
+
+		// Create moments
+		SumXX -= SumX * SumX;
+		SumYY -= SumY * SumY;
+		SumXY -= SumX * SumY;
+		if(SumXY > -1.0E-14 && SumXY < 1.0E-14)
+		{
+			SumXY = 0.0; // Eliminate roundoff error
+		}
+		Regions.Field[BLOBAREA][ThisRegionNum] = (float) Area;
+		Regions.Field[BLOBSUMX][ThisRegionNum] = (float) SumX;
+		Regions.Field[BLOBSUMY][ThisRegionNum] = (float) SumY;
+		Regions.Field[BLOBSUMXX][ThisRegionNum] = (float) SumXX;
+		Regions.Field[BLOBSUMYY][ThisRegionNum] = (float) SumYY;
+		Regions.Field[BLOBSUMXY][ThisRegionNum] = (float) SumXY;
+	}
+
+	for(ThisRegionNum = HighRegionNum; ThisRegionNum > 0 ; ThisRegionNum--)
+	{
+		// Subtract interior perimeters
+		int ParentRegionNum = (int) Regions.Field[BLOBPARENT][ThisRegionNum];
+		Regions.Sum[BLOBPERIMETER][ParentRegionNum]
+			-= Regions.Sum[BLOBPERIMETER][ThisRegionNum];
+	}
+	for(ThisRegionNum = 0; ThisRegionNum <= HighRegionNum; ThisRegionNum++)
+	{
+		Regions.Field[BLOBPERIMETER][ThisRegionNum] = (float) Regions.Sum[BLOBPERIMETER][ThisRegionNum];
+	}
+
+	return(HighRegionNum);
+}
+
+int BlobAnalysis(IplImage* ImageHdr,	// input image
+	BlobRegions& Regions,				// region data to be output (and working storage)
+	int Cols, int Rows,					// size of input image
+	uchar Border,						// border color
+	int MinArea)						// min area of a region
+{
+
+	if(Cols < 1 || Rows < 1) 
+	{
+		cout << "Error in image size" << endl;
+		return(-1);
+	}
+
+	BlobTransitions(ImageHdr, Regions, Cols, Rows, Border, 0, Rows + 1);
+
+	Regions.Clear();				// Initialize result arrays
+	Regions.LastRegion.assign(Cols + 3, -1);	// a row has up to Cols + 2 runs
+	Regions.ThisRegion.assign(Cols + 3, -1);
+
+	Regions.Add();					// Border region
+	Regions.Field[BLOBPARENT][0] = (float) -1;
+	Regions.Sum[BLOBAREA][0] = Cols + 2;
+	Regions.Sum[BLOBPERIMETER][0] = 2 + 2 * (Cols + 2);
+	Regions.ThisRegion[0] = 0;
+
+	if(BlobLabelRows(Regions, Cols, 0, Rows + 1) != 0) return(-1);
+
+	return(BlobResults(Regions, MinArea));
+}
+
+// Strip of BlobAnalysisParallel, labeled by a thread of its own
+struct BlobStrip
+{
+	IplImage* ImageHdr;		// input image
+	BlobRegions* Regions;	// region table of the strip
+	int Cols, Rows;			// size of input image
+	uchar Border;			// border color
+	int StartRow, EndRow;	// strip labels rows StartRow+1..EndRow
+	int Result;				// 0, -1 in error
+};
+
+// Label a strip. Runs of its first row belong to the strip above, here
+// they get the first numbers (and no data) and are joined to the
+// numbers of the strip above afterwards. Strip at top starts with the
+// border region instead
+void* BlobStripWorker(void* Param)
+{
+	BlobStrip* Strip = (BlobStrip*) Param;
+	BlobRegions& Regions = *Strip->Regions;
+
+	BlobTransitions(Strip->ImageHdr, Regions, Strip->Cols, Strip->Rows,
+		Strip->Border, Strip->StartRow, Strip->EndRow);
+
+	Regions.Clear();
+	Regions.LastRegion.assign(Strip->Cols + 3, -1);
+	Regions.ThisRegion.assign(Strip->Cols + 3, -1);
+	for(int j = 0; Regions.Transition[j] >= 0; j++) { Regions.ThisRegion[j] = Regions.Add(); }
+
+	if(Strip->StartRow == 0)		// Border region
+	{
+		Regions.Sum[BLOBAREA][0] = Strip->Cols + 2;
+		Regions.Sum[BLOBPERIMETER][0] = 2 + 2 * (Strip->Cols + 2);
+	}
+
+	Strip->Result = BlobLabelRows(Regions, Strip->Cols, Strip->StartRow, Strip->EndRow);
+	return(NULL);
+}
+
+// Same as BlobAnalysis, with the image split in horizontal strips
+// labeled in parallel (POSIX threads, link with -lpthread). Regions
+// that cross strips are joined afterwards and are numbered as
+// BlobAnalysis does. Strip sums are merged as integers (Sum) and
+// converted once in BlobResults, so results are identical to
+// BlobAnalysis, bit for bit, whatever the number of threads.
+int BlobAnalysisParallel(IplImage* ImageHdr,	// input image
+	BlobRegions& Regions,				// region data to be output (and working storage)
+	int Cols, int Rows,					// size of input image
+	uchar Border,						// border color
+	int MinArea,						// min area of a region
+	int Threads)						// number of threads
+{
+	int StripCount = Threads;
+	if(StripCount > (Rows + 1) / BLOBSTRIPROWS) StripCount = (Rows + 1) / BLOBSTRIPROWS;
+	if(Cols < 1 || Rows < 1 || StripCount < 2)
+	{
+		return(BlobAnalysis(ImageHdr, Regions, Cols, Rows, Border, MinArea));
+	}
+
+	while((int) Regions.Strips.size() < StripCount) { Regions.Strips.push_back(new BlobRegions); }
+	std::vector<BlobStrip> Jobs(StripCount);
+	std::vector<pthread_t> Ids(StripCount);
+	int t, j;
+	for(t = 0; t < StripCount; t++)
+	{
+		Jobs[t].ImageHdr = ImageHdr;
+		Jobs[t].Regions = Regions.Strips[t];
+		Jobs[t].Cols = Cols;
+		Jobs[t].Rows = Rows;
+		Jobs[t].Border = Border;
+		Jobs[t].StartRow = (int) ((long) (Rows + 1) * t / StripCount);
+		Jobs[t].EndRow = (int) ((long) (Rows + 1) * (t + 1) / StripCount);
+		Jobs[t].Result = -1;
+	}
+
+	for(t = 1; t < StripCount; t++)
+	{
+		if(pthread_create(&Ids[t], NULL, BlobStripWorker, &Jobs[t])) break;
+	}
+	BlobStripWorker(&Jobs[0]);
+	for(j = t; j < StripCount; j++) { BlobStripWorker(&Jobs[j]); }	// Thread creation failed
+	for(j = 1; j < t; j++) { pthread_join(Ids[j], NULL); }
+
+	for(t = 0; t < StripCount; t++)
+	{
+		if(Jobs[t].Result != 0) return(-1);
+	}
+
+	// Number regions strip after strip, in order of creation, as
+	// BlobAnalysis does. Numbers of first row of a strip are the ones
+	// given by the strip above to its last row
+	Regions.Clear();
+	for(t = 0; t < StripCount; t++)
+	{
+		BlobRegions& Strip = *Regions.Strips[t];
+		Strip.NewNumber.resize(Strip.Size());
+		j = 0;
+		if(t > 0)
+		{
+			BlobRegions& Above = *Regions.Strips[t - 1];
+			for(; Strip.Transition[j] >= 0; j++) { Strip.NewNumber[j] = Above.NewNumber[Above.ThisRegion[j]]; }
+		}
+		for(; j < Strip.Size(); j++) { Strip.NewNumber[j] = Regions.Add(); }
+	}
+
+	// Parents of new regions and sets joined inside strips
+	for(t = 0; t < StripCount; t++)
+	{
+		BlobRegions& Strip = *Regions.Strips[t];
+		j = 0;
+		if(t > 0) { while(Strip.Transition[j] >= 0) j++; }
+		for(; j < Strip.Size(); j++)
+		{
+			int Parent = (int) Strip.Field[BLOBPARENT][j];
+			if(Parent >= 0) Parent = Strip.NewNumber[Parent];
+			Regions.Field[BLOBPARENT][Strip.NewNumber[j]] = (float) Parent;
+		}
+		for(j = 0; j < Strip.Size(); j++)
+		{
+			int Root = Strip.Find(j);
+			if(Root != j) Regions.Join(Strip.NewNumber[j], Strip.NewNumber[Root]);
+		}
+	}
+
+	// Move data of sets to roots of joined sets
+	for(t = 0; t < StripCount; t++)
+	{
+		BlobRegions& Strip = *Regions.Strips[t];
+		for(j = 0; j < Strip.Size(); j++)
+		{
+			if(Strip.Find(j) != j) continue;
+			int Root = Regions.Find(Strip.NewNumber[j]);
+			for(int i = BLOBCOLOR; i < BLOBDATACOUNT; i++)
+			{
+				float Data = Strip.Field[i][j];
+				float& Total = Regions.Field[i][Root];
+				if(i == BLOBCOLOR)	// Unless set has no runs (first row of strip)
+				{
+					if(Strip.Sum[BLOBAREA][j] > 0) Total = Data;
+				}
+				else if(i == BLOBMINX || i == BLOBMINY)
+				{
+					if(Total > Data) Total = Data;
+				}
+				else if(i == BLOBMAXX || i == BLOBMAXY)
+				{
+					if(Total < Data) Total = Data;
+				}
+				else // Area, Perimeter, SumX, SumY, SumXX, SumYY, SumXY (exact)
+				{
+					Regions.Sum[i][Root] += Strip.Sum[i][j];
+				}
+			}
+		}
+	}
+
+	return(BlobResults(Regions, MinArea));
+}
@@ -12,6 +12,10 @@
  * vs 0.01 14-12-2005
  * - Wrote mean, square, variance, stderror, correlation;
  * - Added comments LaTeX with formulas of functions;
+ * - Added correlation_matrix (all column pairs of a data matrix);
+ * - Added single pass accumulators (stats_accumulator, corr_accumulator),
+ *   mean, variance, stderror and correlation use them;
+ * - Added window_correlator (correlation over last W samples);
  *
  * \todo
  * - Is there a way so Doxygen translate LaTeX embedded formulas?
@@ -20,6 +24,9 @@
 #ifndef __MCORRELATION__
 #define __MCORRELATION__
 
+#include <math.h>
+#include <pthread.h>
+
 
 /** Square of number
  *
@@ -41,6 +48,220 @@ inline T square(T num)
 }
 
 
+/** Values added at once by block updates of accumulators. */
+const int stats_block = 64;
+
+
+/** Single pass statistics of a series: count, mean and M2 (sum of
+ * squared deviations from mean), all in double.
+ *
+ * Values are added one by one (Welford update) or a block at a time:
+ * block mean and M2 are computed with plain loops, then merged (Chan
+ * update). Accumulators of data split among threads, or processes (it
+ * is a plain struct, it can be written to a file), are merged with
+ * \ref merge and give same results of a single accumulator.
+ */
+struct stats_accumulator
+{
+	/** Number of values. */
+	long long n;
+	/** Mean. */
+	double mu;
+	/** Sum of squared deviations from mean. */
+	double m2;
+
+	stats_accumulator(void): n(0), mu(0), m2(0)
+	{}
+
+	/** Adds one value. */
+	void add(double x)
+	{
+		double delta = x - mu;
+
+		++n;
+		mu += delta / n;
+		m2 += delta * (x - mu);
+	}
+
+	/** Adds a vector of values.
+	 *
+	 * @param data Pointer/iterator to data vector, should allow access
+	 * to elements using data[i].
+	 *
+	 * @param size Vector size.
+	 */
+	template <class T>
+	void add(T *data, int size)
+	{
+		stats_accumulator block;
+		double s0, s1, s2, s3;
+		int i, k, count;
+
+		for (i = 0; i < size; i += stats_block) {
+			count = (size - i < stats_block) ? size - i : stats_block;
+
+			/* 4 partial sums, so adds can overlap */
+			s0 = s1 = s2 = s3 = 0;
+			for (k = 0; k + 3 < count; k += 4) {
+				s0 += data[i + k];
+				s1 += data[i + k + 1];
+				s2 += data[i + k + 2];
+				s3 += data[i + k + 3];
+			}
+			for (; k < count; ++k)
+				s0 += data[i + k];
+			block.n = count;
+			block.mu = ((s0 + s1) + (s2 + s3)) / count;
+
+			s0 = s1 = s2 = s3 = 0;
+			for (k = 0; k + 3 < count; k += 4) {
+				s0 += square(double(data[i + k]) - block.mu);
+				s1 += square(double(data[i + k + 1]) - block.mu);
+				s2 += square(double(data[i + k + 2]) - block.mu);
+				s3 += square(double(data[i + k + 3]) - block.mu);
+			}
+			for (; k < count; ++k)
+				s0 += square(double(data[i + k]) - block.mu);
+			block.m2 = (s0 + s1) + (s2 + s3);
+
+			merge(block);
+		}
+	}
+
+	/** Merges statistics of another part of the series. */
+	void merge(const stats_accumulator &other)
+	{
+		long long total = n + other.n;
+		double delta = other.mu - mu;
+
+		if (!other.n)
+			return;
+		if (!n) {
+			*this = other;
+			return;
+		}
+
+		mu += delta * other.n / total;
+		m2 += delta * delta * (double(n) * other.n / total) + other.m2;
+		n = total;
+	}
+
+	/** Sample mean. */
+	double mean(void) const
+	{
+		return mu;
+	}
+
+	/** Sample variance (divided by n - 1). */
+	double variance(void) const
+	{
+		return (n > 1) ? m2 / (n - 1) : 0;
+	}
+
+	/** Standard error, root square of variance. */
+	double stderror(void) const
+	{
+		return sqrt(variance());
+	}
+};
+
+
+/** Single pass statistics of a pair of series: both means and M2 plus
+ * co-moment (sum of products of deviations), see \ref stats_accumulator.
+ */
+struct corr_accumulator
+{
+	/** Statistics of first series. */
+	stats_accumulator x;
+	/** Statistics of second series. */
+	stats_accumulator y;
+	/** Sum of (x_i - mean x) (y_i - mean y). */
+	double cxy;
+
+	corr_accumulator(void): x(), y(), cxy(0)
+	{}
+
+	/** Adds one pair of values. */
+	void add(double xi, double yi)
+	{
+		double dx = xi - x.mu;
+
+		x.add(xi);
+		y.add(yi);
+		cxy += dx * (yi - y.mu);
+	}
+
+	/** Adds a pair of vectors.
+	 *
+	 * @param X First data vector, should allow access as X[i].
+	 *
+	 * @param Y Second data vector.
+	 *
+	 * @param size Vectors length.
+	 */
+	template <class T1, class T2>
+	void add(T1 *X, T2 *Y, int size)
+	{
+		corr_accumulator block;
+		double s0, s1;
+		int i, k, count;
+
+		for (i = 0; i < size; i += stats_block) {
+			count = (size - i < stats_block) ? size - i : stats_block;
+			block.x = block.y = stats_accumulator();
+			block.x.add(X + i, count);
+			block.y.add(Y + i, count);
+
+			s0 = s1 = 0;
+			for (k = 0; k + 1 < count; k += 2) {
+				s0 += (X[i + k] - block.x.mu) *
+					(Y[i + k] - block.y.mu);
+				s1 += (X[i + k + 1] - block.x.mu) *
+					(Y[i + k + 1] - block.y.mu);
+			}
+			for (; k < count; ++k)
+				s0 += (X[i + k] - block.x.mu) *
+					(Y[i + k] - block.y.mu);
+			block.cxy = s0 + s1;
+
+			merge(block);
+		}
+	}
+
+	/** Merges statistics of another part of the series. */
+	void merge(const corr_accumulator &other)
+	{
+		long long total = x.n + other.x.n;
+
+		if (!other.x.n)
+			return;
+		if (!x.n) {
+			*this = other;
+			return;
+		}
+
+		cxy += other.cxy + (other.x.mu - x.mu) * (other.y.mu - y.mu) *
+			(double(x.n) * other.x.n / total);
+		x.merge(other.x);
+		y.merge(other.y);
+	}
+
+	/** Sample covariance (divided by n - 1). */
+	double covariance(void) const
+	{
+		return (x.n > 1) ? cxy / (x.n - 1) : 0;
+	}
+
+	/** Correlation coefficient, 0 if a series has zero variance. */
+	double correlation(void) const
+	{
+		double ratio = sqrt(x.m2 * y.m2);
+
+		return (ratio > 0) ? cxy / ratio : 0;
+	}
+};
+
+
 /** Calculates sample mean of a given data vector.
  *
  * @param data Pointer/iterator to data vector, should allow access to elements
@@ -60,13 +281,11 @@ inline T square(T num)
 template <class T>
 inline float mean(T *data, int size)
 {
-	float result = 0;
-	for (int i = 0; i < size; ++i)
-		result += data[i];
+	stats_accumulator stats;
 
-	result /= float(size);
+	stats.add(data, size);
 
-	return result;
+	return float(stats.mean());
 }
 
 
@@ -77,7 +296,8 @@ inline float mean(T *data, int size)
  *
  * @param size Vector size.
  *
- * @param mean_d The sample mean, should be calculated before using \ref mean.
+ * @param mean_d Deviations are taken from this value, usually the sample
+ * mean (then it is same as \ref variance(T *, int)).
  *
  * @return The variance.
  */
@@ -91,13 +311,32 @@ inline float mean(T *data, int size)
 template <class T>
 inline float variance(T *data, int size, float mean_d)
 {
-	float result = 0;
-	for (int i = 0; i < size; ++i)
-		result += square(float(data[i]) - mean_d);
+	stats_accumulator stats;
+
+	/* Sum of squared deviations from mean_d = M2 + n (mean - mean_d)^2 */
+	stats.add(data, size);
+
+	return float((stats.m2 + stats.n * square(stats.mu - mean_d)) /
+		     (size - 1));
+}
+
+/** Calculates variance of a data vector in a single pass (no previous
+ * mean needed).
+ *
+ * @param data Pointer/iterator to data vector.
+ *
+ * @param size Vector size.
+ *
+ * @return The variance.
+ */
+template <class T>
+inline float variance(T *data, int size)
+{
+	stats_accumulator stats;
 
-	result /= float(size - 1);
+	stats.add(data, size);
 
-	return result;
+	return float(stats.variance());
 }
 
 /** Standard error, root square of variance.
@@ -122,13 +361,21 @@ inline float variance(T *data, int size, float mean_d)
 template <class T>
 inline float stderror(T *data, int size, float mean_d)
 {
-	float result = 0;
-
-	result = variance(data, size, mean_d);
-	result = float(sqrt(double(result)));
-
-	return result;
+	return float(sqrt(double(variance(data, size, mean_d))));
+}
 
+/** Standard error in a single pass, see \ref variance(T *, int).
+ *
+ * @param data Pointer/iterator to data vector.
+ *
+ * @param size Vector size.
+ *
+ * @return The standard error.
+ */
+template <class T>
+inline float stderror(T *data, int size)
+{
+	return float(sqrt(double(variance(data, size))));
 }
 
 /** Statistical correlation.
@@ -154,25 +401,11 @@ inline float stderror(T *data, int size, float mean_d)
 template <class T1, class T2>
 inline float correlation(T1 *X, T2* Y, int size)
 {
-	float x_mean = 0, y_mean= 0;
-	float x_desv = 0, y_desv = 0;
+	corr_accumulator stats;
 
-	float corr = 0, ratio = 0;
+	stats.add(X, Y, size);
 
-
-	x_mean = mean(X, size);
-	y_mean = mean(Y, size);
-
-	x_desv = stderror(X, size, x_mean);
-	y_desv = stderror(Y, size, y_mean);
-
-	ratio = (size - 1) * (x_desv * y_desv);
-	for (int i = 0; i < size; ++i)
-		corr += (X[i] - x_mean) * (Y[i] - y_mean);
-
-	corr /= ratio;
-
-	return corr;
+	return float(stats.correlation());
 }
 
 /** Helper structure to hold position statistics, is used to speed up
@@ -192,6 +425,22 @@ struct moments
 		s_mean(sample_mean), s_var(s_variance), s_error(std_error)
 	{}
 
+	/** Takes moments of an accumulated series. */
+	moments(const stats_accumulator &stats):
+		s_mean(stats.mean()), s_var(stats.variance()),
+		s_error(stats.stderror())
+	{}
+
+	/** Calculates moments of a data vector (single pass). */
+	template <class T>
+	moments(T *data, int size): s_mean(0), s_var(0), s_error(0)
+	{
+		stats_accumulator stats;
+
+		stats.add(data, size);
+		*this = moments(stats);
+	}
+
 	void operator() (float &sample_mean, float &s_variance, float &std_error)
 	{
 		s_mean = sample_mean;
@@ -219,21 +468,458 @@ struct moments
 template <class T1, class T2>
 float quick_corr(T1* X, moments &mdata, T2* Y, int size)
 {
-	float &x_mean = mdata.s_mean, y_mean= 0;
-	float &x_desv = mdata.s_error, y_desv = 0;
+	float &x_mean = mdata.s_mean;
+	float &x_desv = mdata.s_error;
+	stats_accumulator y_stats;
+	double shift = size ? double(Y[0]) : 0, dx, sum_x = 0, sum_xy = 0;
+	double corr, ratio;
+	int i, k, count;
+
+	/* Y statistics and products in same pass, a block at a time; Y is
+	 * shifted by its first value to keep products small.
+	 */
+	for (i = 0; i < size; i += stats_block) {
+		count = (size - i < stats_block) ? size - i : stats_block;
+		y_stats.add(Y + i, count);
+		for (k = i; k < i + count; ++k) {
+			dx = X[k] - x_mean;
+			sum_x += dx;
+			sum_xy += dx * (Y[k] - shift);
+		}
+	}
+
+	ratio = (size - 1) * (x_desv * y_stats.stderror());
+	corr = sum_xy - (y_stats.mean() - shift) * sum_x;
+	corr /= ratio;
 
-	float corr = 0, ratio = 0;
+	return float(corr);
+}
 
-	y_mean = mean(Y, size);
-	y_desv = stderror(Y, size, y_mean);
 
-	ratio = (size - 1) * (x_desv * y_desv);
-	for(int i = 0; i < size; ++i)
-		corr += (X[i] - x_mean) * (Y[i] - y_mean);
+/** Correlation over a moving window of the last W samples, for many
+ * pairs of series at once (e.g. a feature trace of each blob against a
+ * reference trace, one sample per video frame).
+ *
+ * Instead of calling \ref quick_corr on the window at each frame, O(W),
+ * running sums of x, y, x^2, y^2 and xy are kept for each pair: a new
+ * sample is added and the oldest (kept in a ring buffer) is removed,
+ * so each frame is O(1) per pair. Sums are of values minus a shift, to
+ * avoid cancellation; every W frames shift is moved to window mean and
+ * sums are recomputed from the ring buffer (amortized O(1)), so
+ * rounding errors don't pile up.
+ *
+ * Series are stored side by side (sums of all pairs are contiguous
+ * vectors), so a frame update is a plain loop over pairs.
+ */
+class window_correlator
+{
+	/** Number of pairs of series. */
+	int series;
+	/** Window length. */
+	int window;
+	/** Samples in window (at most 'window'). */
+	int count;
+	/** Ring slot of oldest sample. */
+	int head;
+	/** Frames since last recentering. */
+	int updates;
+	/** Ring buffers, 'window' rows of 'series' values. */
+	double *xs, *ys;
+	/** Shifts of each pair. */
+	double *shift_x, *shift_y;
+	/** Running sums of shifted values of each pair. */
+	double *sx, *sy, *sxx, *syy, *sxy;
+
+	/** Non copyable (it owns its buffers). */
+	window_correlator(const window_correlator &);
+	/** Non copyable (it owns its buffers). */
+	window_correlator &operator=(const window_correlator &);
+
+public:
+	/** Creates an empty window.
+	 *
+	 * @param pairs Number of pairs of series.
+	 *
+	 * @param length Window length (in samples), at least 2.
+	 */
+	window_correlator(int pairs, int length):
+		series(pairs), window(length), count(0), head(0), updates(0),
+		xs(new double[pairs * length]), ys(new double[pairs * length]),
+		shift_x(new double[pairs]), shift_y(new double[pairs]),
+		sx(new double[pairs]), sy(new double[pairs]),
+		sxx(new double[pairs]), syy(new double[pairs]),
+		sxy(new double[pairs])
+	{
+		clear();
+	}
 
-	corr /= ratio;
+	~window_correlator(void)
+	{
+		delete [] xs;
+		delete [] ys;
+		delete [] shift_x;
+		delete [] shift_y;
+		delete [] sx;
+		delete [] sy;
+		delete [] sxx;
+		delete [] syy;
+		delete [] sxy;
+	}
+
+	/** Empties window. */
+	void clear(void)
+	{
+		count = head = updates = 0;
+		for (int s = 0; s < series; ++s)
+			shift_x[s] = shift_y[s] = sx[s] = sy[s] = sxx[s] =
+				syy[s] = sxy[s] = 0;
+	}
+
+	/** Adds a sample of each pair, dropping the oldest one if window is
+	 * full.
+	 *
+	 * @param X New value of first series of each pair, X[s].
+	 *
+	 * @param Y New value of second series of each pair, Y[s].
+	 *
+	 * @param r If not NULL, will hold correlation of each pair.
+	 */
+	template <class T1, class T2>
+	void add(T1 *X, T2 *Y, float *r = NULL)
+	{
+		double *x_slot, *y_slot, dx, dy;
+		int slot = (head + count) % window;
+
+		/* First sample gives shifts */
+		if (!count)
+			for (int s = 0; s < series; ++s) {
+				shift_x[s] = X[s];
+				shift_y[s] = Y[s];
+			}
+
+		/* Full window: new sample takes slot of oldest one */
+		if (count == window) {
+			slot = head;
+			head = (head + 1) % window;
+			x_slot = xs + slot * series;
+			y_slot = ys + slot * series;
+			for (int s = 0; s < series; ++s) {
+				dx = x_slot[s] - shift_x[s];
+				dy = y_slot[s] - shift_y[s];
+				sx[s] -= dx;
+				sy[s] -= dy;
+				sxx[s] -= dx * dx;
+				syy[s] -= dy * dy;
+				sxy[s] -= dx * dy;
+			}
+		} else {
+			++count;
+		}
+
+		x_slot = xs + slot * series;
+		y_slot = ys + slot * series;
+		for (int s = 0; s < series; ++s) {
+			x_slot[s] = X[s];
+			y_slot[s] = Y[s];
+			dx = x_slot[s] - shift_x[s];
+			dy = y_slot[s] - shift_y[s];
+			sx[s] += dx;
+			sy[s] += dy;
+			sxx[s] += dx * dx;
+			syy[s] += dy * dy;
+			sxy[s] += dx * dy;
+		}
+
+		if (++updates >= window)
+			recenter();
+
+		if (r)
+			correlations(r);
+	}
+
+	/** Moves shifts to window means and recomputes sums from ring
+	 * buffer, O(W) per pair (called every W samples by \ref add).
+	 */
+	void recenter(void)
+	{
+		const double *x_slot, *y_slot;
+		double dx, dy;
+		int t, s;
+
+		updates = 0;
+		if (!count)
+			return;
+
+		for (s = 0; s < series; ++s) {
+			shift_x[s] += sx[s] / count;
+			shift_y[s] += sy[s] / count;
+			sx[s] = sy[s] = sxx[s] = syy[s] = sxy[s] = 0;
+		}
+
+		for (t = 0; t < count; ++t) {
+			x_slot = xs + ((head + t) % window) * series;
+			y_slot = ys + ((head + t) % window) * series;
+			for (s = 0; s < series; ++s) {
+				dx = x_slot[s] - shift_x[s];
+				dy = y_slot[s] - shift_y[s];
+				sx[s] += dx;
+				sy[s] += dy;
+				sxx[s] += dx * dx;
+				syy[s] += dy * dy;
+				sxy[s] += dx * dy;
+			}
+		}
+	}
+
+	/** Correlation of a pair over current window.
+	 *
+	 * @param s Pair index.
+	 *
+	 * @return The correlation, 0 if window has less than 2 samples or
+	 * a series is constant in window.
+	 */
+	float correlation(int s) const
+	{
+		double n = count, cov, var_x, var_y;
+
+		cov = n * sxy[s] - sx[s] * sy[s];
+		var_x = n * sxx[s] - sx[s] * sx[s];
+		var_y = n * syy[s] - sy[s] * sy[s];
+		if ((count < 2) || (var_x <= 0) || (var_y <= 0))
+			return 0;
+
+		return float(cov / sqrt(var_x * var_y));
+	}
+
+	/** Correlation of every pair.
+	 *
+	 * @param r Will hold correlation of each pair.
+	 */
+	void correlations(float *r) const
+	{
+		for (int s = 0; s < series; ++s)
+			r[s] = correlation(s);
+	}
+
+	/** Number of samples in window. */
+	int size(void) const
+	{
+		return count;
+	}
+
+	/** Number of pairs of series. */
+	int pairs(void) const
+	{
+		return series;
+	}
+};
+
+
+/** Rows standardized at once by \ref correlation_matrix workers. */
+const int corr_tile_rows = 256;
+
+/** Columns of a cache block in \ref correlation_matrix. */
+const int corr_block_cols = 32;
+
+
+/** Work of one \ref correlation_matrix thread. */
+template <class T>
+struct corr_job {
+	/** Data matrix (row major). */
+	const T *data;
+	/** Number of columns. */
+	int cols;
+	/** First row of this thread. */
+	int begin;
+	/** One past last row. */
+	int end;
+	/** Column means. */
+	const double *col_mean;
+	/** Column scales, 1 / sqrt(sum of squared deviations). */
+	const double *col_scale;
+	/** Partial Gram matrix (cols x cols, upper triangle). */
+	double *gram;
+};
+
+
+/** Thread body of \ref correlation_matrix: standardizes a tile of rows
+ * (stored column major, so each column is contiguous) and adds its
+ * Gram product to partial matrix, a block of columns at a time.
+ *
+ * @param param A \ref corr_job.
+ *
+ * @return NULL.
+ */
+template <class T>
+void *corr_worker(void *param)
+{
+	corr_job<T> *job = (corr_job<T> *) param;
+	int cols = job->cols, count, last_i, last_j;
+	double *tile = new double[cols * corr_tile_rows];
+	double s0, s1, s2, s3;
+	const double *zi, *zj;
+	const T *row;
+	int k;
+
+	for (int r = job->begin; r < job->end; r += corr_tile_rows) {
+		count = job->end - r;
+		if (count > corr_tile_rows)
+			count = corr_tile_rows;
+
+		for (k = 0; k < count; ++k) {
+			row = job->data + (long) (r + k) * cols;
+			for (int c = 0; c < cols; ++c)
+				tile[c * corr_tile_rows + k] =
+					(double(row[c]) - job->col_mean[c]) *
+					job->col_scale[c];
+		}
+
+		for (int bi = 0; bi < cols; bi += corr_block_cols)
+		for (int bj = bi; bj < cols; bj += corr_block_cols) {
+			last_i = (bi + corr_block_cols < cols) ?
+				bi + corr_block_cols : cols;
+			last_j = (bj + corr_block_cols < cols) ?
+				bj + corr_block_cols : cols;
+
+			for (int i = bi; i < last_i; ++i) {
+				zi = tile + i * corr_tile_rows;
+				for (int j = (i > bj) ? i : bj; j < last_j; ++j) {
+					zj = tile + j * corr_tile_rows;
+					/* 4 partial sums, so adds can overlap */
+					s0 = s1 = s2 = s3 = 0;
+					for (k = 0; k + 3 < count; k += 4) {
+						s0 += zi[k] * zj[k];
+						s1 += zi[k + 1] * zj[k + 1];
+						s2 += zi[k + 2] * zj[k + 2];
+						s3 += zi[k + 3] * zj[k + 3];
+					}
+					for (; k < count; ++k)
+						s0 += zi[k] * zj[k];
+					job->gram[i * cols + j] +=
+						(s0 + s1) + (s2 + s3);
+				}
+			}
+		}
+	}
+
+	delete [] tile;
+	return NULL;
+}
+
+
+/** Correlation of every pair of columns of a data matrix.
+ *
+ * Calling \ref correlation for each pair recomputes means and standard
+ * errors d^2 times. Here each column is standardized once:
+ *
+ * z_i = (x_i - mean) / sqrt(sum (x_i - mean)^2)
+ *
+ * so r_xy = sum z_x z_y, and the whole matrix is the Gram product Z'Z,
+ * accumulated in double. Rows are split among threads, each thread sums
+ * up its own partial matrix tile by tile (see \ref corr_worker).
+ *
+ * Threads are POSIX threads, link with -lpthread.
+ *
+ * @param data Row major matrix, element (r, c) is data[r * cols + c].
+ *
+ * @param rows Number of rows (samples), at least 2.
+ *
+ * @param cols Number of columns (descriptors).
+ *
+ * @param result A cols x cols matrix, will hold correlations (diagonal
+ * is 1, columns with zero variance have 0 correlation with others).
+ *
+ * @param threads Number of threads (caller thread is one of them).
+ *
+ * @return true in success, false otherwise.
+ */
+template <class T>
+bool correlation_matrix(const T *data, int rows, int cols, double *result,
+			int threads = 1)
+{
+	double *col_mean = NULL, *col_scale = NULL, *grams = NULL;
+	corr_job<T> *jobs = NULL;
+	pthread_t *ids = NULL;
+	bool res = false;
+	const T *row;
+	long size;
+	int i, j, t;
+
+	if ((!data) || (!result) || (rows < 2) || (cols < 1))
+		return res;
+
+	if (threads > (rows + corr_tile_rows - 1) / corr_tile_rows)
+		threads = (rows + corr_tile_rows - 1) / corr_tile_rows;
+	if (threads < 1)
+		threads = 1;
+
+	size = (long) cols * cols;
+	col_mean = new double[cols];
+	col_scale = new double[cols];
+	grams = new double[threads * size];
+	jobs = new corr_job<T>[threads];
+	ids = new pthread_t[threads];
+
+	/* Column statistics, row by row (data is row major) */
+	for (j = 0; j < cols; ++j)
+		col_mean[j] = col_scale[j] = 0;
+	for (i = 0; i < rows; ++i) {
+		row = data + (long) i * cols;
+		for (j = 0; j < cols; ++j)
+			col_mean[j] += row[j];
+	}
+	for (j = 0; j < cols; ++j)
+		col_mean[j] /= rows;
+	for (i = 0; i < rows; ++i) {
+		row = data + (long) i * cols;
+		for (j = 0; j < cols; ++j)
+			col_scale[j] += square(double(row[j]) - col_mean[j]);
+	}
+	for (j = 0; j < cols; ++j)
+		col_scale[j] = (col_scale[j] > 0) ? 1 / sqrt(col_scale[j]) : 0;
+
+	for (t = 0; t < threads; ++t) {
+		jobs[t].data = data;
+		jobs[t].cols = cols;
+		jobs[t].begin = (long) rows * t / threads;
+		jobs[t].end = (long) rows * (t + 1) / threads;
+		jobs[t].col_mean = col_mean;
+		jobs[t].col_scale = col_scale;
+		jobs[t].gram = grams + t * size;
+		for (i = 0; i < size; ++i)
+			jobs[t].gram[i] = 0;
+	}
 
-	return corr;
+	for (t = 1; t < threads; ++t)
+		if (pthread_create(&ids[t], NULL, corr_worker<T>, &jobs[t]))
+			break;
+	corr_worker<T>(&jobs[0]);
+	/* Thread creation failed: caller does the rest */
+	for (j = t; j < threads; ++j)
+		corr_worker<T>(&jobs[j]);
+	for (j = 1; j < t; ++j)
+		pthread_join(ids[j], NULL);
+
+	for (i = 0; i < cols; ++i)
+		for (j = i; j < cols; ++j) {
+			result[i * cols + j] = 0;
+			for (t = 0; t < threads; ++t)
+				result[i * cols + j] += grams[t * size +
+							      i * cols + j];
+			result[j * cols + i] = result[i * cols + j];
+		}
+	for (i = 0; i < cols; ++i)
+		result[i * cols + i] = 1;
+
+	res = true;
+
+	delete [] col_mean;
+	delete [] col_scale;
+	delete [] grams;
+	delete [] jobs;
+	delete [] ids;
+
+	return res;
 }
 
 #endif
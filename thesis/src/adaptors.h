@@ -36,6 +36,14 @@
 //OpenCv Stuff
 #include <opencv/cv.h>
 
+//posix_memalign
+#include <stdlib.h>
+//memcpy
+#include <string.h>
+
+/** Alignment (in bytes) of materialized contour buffers */
+const int buffer_alignment = 32;
+
 /** Resource ownership type */
 typedef enum {
 	/** The one who hold a reference must destroy/free resource */
@@ -72,6 +80,16 @@ protected:
 	CvSeqReader cv_reader;
 	/** Number of shapes inside sequence */
 	int sequence_length;
+	/** Materialized x coordinates of current contour */
+	NUMBER *x_buffer;
+	/** Materialized y coordinates of current contour */
+	NUMBER *y_buffer;
+	/** Scratch buffer for bulk copy of contour points */
+	CvPoint *raw_buffer;
+	/** Allocated length of materialized buffers */
+	int buffer_capacity;
+	/** If current contour is served from materialized buffers */
+	bool materialized;
 
 
 	/** Count the number of shapes inside sequence.
@@ -110,6 +128,68 @@ protected:
 
 	}
 
+	/** Frees up materialized buffers. */
+	void free_buffers(void) {
+		free(x_buffer);
+		free(y_buffer);
+		delete [] raw_buffer;
+		x_buffer = y_buffer = NULL;
+		raw_buffer = NULL;
+		buffer_capacity = 0;
+		materialized = false;
+	}
+
+	/** Grows materialized buffers to hold a given number of points.
+	 *
+	 * @param length Number of points.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool reserve_buffers(int length) {
+		void *x_tmp = NULL, *y_tmp = NULL;
+
+		if (length <= buffer_capacity)
+			return true;
+
+		free_buffers();
+		if (posix_memalign(&x_tmp, buffer_alignment,
+				   length * sizeof(NUMBER)))
+			return false;
+		if (posix_memalign(&y_tmp, buffer_alignment,
+				   length * sizeof(NUMBER))) {
+			free(x_tmp);
+			return false;
+		}
+
+		x_buffer = static_cast<NUMBER *>(x_tmp);
+		y_buffer = static_cast<NUMBER *>(y_tmp);
+		raw_buffer = new CvPoint[length];
+		buffer_capacity = length;
+		return true;
+	}
+
+	/** Copies materialized points of other adaptor.
+	 *
+	 * Used when copying objects, so a copy of a materialized adaptor
+	 * (e.g. one passed by value to \ref contour_curvature) keeps
+	 * serving points from buffers.
+	 *
+	 * @param obj An ocv_adaptor object reference.
+	 */
+	void copy_buffers(ocv_adaptor &obj) {
+		if ((!obj.materialized) || (sequence != obj.sequence))
+			return;
+
+		if (!reserve_buffers(obj.current_contour_length))
+			return;
+
+		memcpy(x_buffer, obj.x_buffer,
+		       obj.current_contour_length * sizeof(NUMBER));
+		memcpy(y_buffer, obj.y_buffer,
+		       obj.current_contour_length * sizeof(NUMBER));
+		materialized = true;
+	}
+
 public:
 
 	/** Returns current shape contour length.
@@ -145,6 +225,7 @@ public:
 	 *
 	 */
 	void reset(OWNERSHIP behaviour = IGNORE) {
+		materialized = false;
 		if (sequence)
 			cvStartReadSeq(sequence, &cv_reader);
 		purge_seq = behaviour;
@@ -164,6 +245,7 @@ public:
 
 		if (aseq) {
 
+			materialized = false;
 			if (aseq != sequence) {
 				current_contour_length = aseq->total;
 				clean_sequence();
@@ -182,7 +264,9 @@ public:
 	 * An empty constructor is necessary in some cases.
 	 */
 	ocv_adaptor(void): sequence(NULL), current_contour_length(-1),
-		purge_seq(IGNORE), sequence_length(-1) {
+		purge_seq(IGNORE), sequence_length(-1), x_buffer(NULL),
+		y_buffer(NULL), raw_buffer(NULL), buffer_capacity(0),
+		materialized(false) {
 
 	}
 
@@ -201,7 +285,9 @@ public:
 	 */
 	ocv_adaptor(CvSeq *aseq, OWNERSHIP behaviour = IGNORE):
 		sequence(NULL), current_contour_length(0),
-		purge_seq(IGNORE) {
+		purge_seq(IGNORE), sequence_length(-1), x_buffer(NULL),
+		y_buffer(NULL), raw_buffer(NULL), buffer_capacity(0),
+		materialized(false) {
 
 		reset(aseq, behaviour);
 	}
@@ -211,7 +297,8 @@ public:
 	 *
 	 * Since this class has protected pointer members, we must provide
 	 * a copy constructor. Concerning contour sequence ownership, its
-	 * default is to ignore clean up of pointer/reference.
+	 * default is to ignore clean up of pointer/reference. If copied
+	 * object was materialized, its buffers are copied too.
 	 *
 	 * @param obj An ocv_adaptor object reference.
 	 *
@@ -221,8 +308,11 @@ public:
 	 */
 	ocv_adaptor(ocv_adaptor &obj, OWNERSHIP behaviour = IGNORE):
 		sequence(NULL), current_contour_length(0),
-		purge_seq(IGNORE) {
+		purge_seq(IGNORE), sequence_length(-1), x_buffer(NULL),
+		y_buffer(NULL), raw_buffer(NULL), buffer_capacity(0),
+		materialized(false) {
 		reset(obj.sequence, behaviour);
+		copy_buffers(obj);
 	}
 
 
@@ -238,7 +328,10 @@ public:
 	 * @return A reference to current object.
 	 */
 	ocv_adaptor &operator=(ocv_adaptor &obj) {
+		if (this == &obj)
+			return *this;
 		reset(obj.sequence, obj.behaviour);
+		copy_buffers(obj);
 		return *this;
 	}
 
@@ -252,6 +345,9 @@ public:
 	 * @param point Contour point position, ranging from 0 to
 	 * (length - 1).
 	 *
+	 * If current contour was materialized (see \ref materialize),
+	 * points are read from buffers instead of contour sequence.
+	 *
 	 * @return A object of \ref mcomplex type.
 	 * \todo
 	 * - Create an exception class to throw a meaningful exception.
@@ -260,6 +356,12 @@ public:
 		mcomplex<NUMBER> obj;
 		CvPoint cv_point;
 
+		if (materialized) {
+			obj[0] = x_buffer[point];
+			obj[1] = y_buffer[point];
+			return obj;
+		}
+
 		/* KISS: keep it simple, stupid!
 		 */
 		cvSetSeqReaderPos(&cv_reader, point);
@@ -276,6 +378,63 @@ public:
 		return obj;
 	}
 
+	/** Copies current contour points to contiguous buffers.
+	 *
+	 * Contour sequence is copied once (with cvCvtSeqToArray) into
+	 * aligned x[] and y[] vectors, so subsequent random access with
+	 * operator[] doesn't walk sequence blocks anymore. Buffers are
+	 * reused between contours and are invalidated when adaptor moves
+	 * to other contour (\ref next or \ref reset), call this
+	 * function again for each contour.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool materialize(void) {
+		int i;
+
+		materialized = false;
+		if ((!sequence) || (current_contour_length < 0))
+			return false;
+
+		if (!reserve_buffers(current_contour_length))
+			return false;
+
+		cvCvtSeqToArray(sequence, raw_buffer, CV_WHOLE_SEQ);
+		for (i = 0; i < current_contour_length; ++i) {
+			x_buffer[i] = (NUMBER) raw_buffer[i].x;
+			y_buffer[i] = (NUMBER) raw_buffer[i].y;
+		}
+
+		materialized = true;
+		return true;
+	}
+
+	/** Tells if current contour was materialized.
+	 *
+	 * @return true if points are served from buffers.
+	 */
+	bool is_materialized(void) {
+		return materialized;
+	}
+
+	/** Raw access to materialized x coordinates.
+	 *
+	 * @return Pointer to x coordinates (aligned to \ref buffer_alignment)
+	 * or NULL if current contour wasn't materialized.
+	 */
+	NUMBER *x(void) {
+		return materialized ? x_buffer : NULL;
+	}
+
+	/** Raw access to materialized y coordinates.
+	 *
+	 * @return Pointer to y coordinates (aligned to \ref buffer_alignment)
+	 * or NULL if current contour wasn't materialized.
+	 */
+	NUMBER *y(void) {
+		return materialized ? y_buffer : NULL;
+	}
+
 	/** Advance to next object coordinate set.
 	 *
 	 * An OpenCV contour sequence has point coordinates of several
@@ -311,6 +470,7 @@ public:
 	 */
 	~ocv_adaptor(void) {
 		clean_sequence();
+		free_buffers();
 	}
 };
 
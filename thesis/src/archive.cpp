@@ -0,0 +1,364 @@
+/** @file
+ *
+ * Contour archive, all contours of an image in one file.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "archive.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+
+/** Size of write buffer */
+static const int buffer_size = 1 << 20;
+
+
+/** Rounds a file offset up to 8 bytes. */
+static long long align8(long long offset)
+{
+	return (offset + 7) & ~7LL;
+}
+
+
+/** Smallest width that holds a range of values.
+ *
+ * @param low Minimum value.
+ * @param high Maximum value.
+ *
+ * @return Bytes per value (1, 2 or 4).
+ */
+static int value_width(int low, int high)
+{
+	if ((low >= -128) && (high <= 127))
+		return 1;
+	if ((low >= -32768) && (high <= 32767))
+		return 2;
+	return 4;
+}
+
+
+/** Stores a value with given width. */
+static inline void put_value(vector<char> &buffer, int value, int width)
+{
+	signed char c = value;
+	short s = value;
+
+	if (width == 1)
+		buffer.push_back(c);
+	else if (width == 2)
+		buffer.insert(buffer.end(), (char *) &s, (char *) &s + 2);
+	else
+		buffer.insert(buffer.end(), (char *) &value,
+			      (char *) &value + 4);
+}
+
+
+/** Reads value 'k' of a vector with given width. */
+static inline int get_value(const char *data, int width, long long k)
+{
+	short s;
+	int i;
+
+	if (width == 1)
+		return ((const signed char *) data)[k];
+	if (width == 2) {
+		memcpy(&s, data + 2 * k, 2);
+		return s;
+	}
+	memcpy(&i, data + 4 * k, 4);
+	return i;
+}
+
+
+bool write_archive(const char *filename, const contour_set &set, bool delta)
+{
+	archive_header header;
+	static const char padding[8] = { 0 };
+	vector<char> buffer;
+	long long *offsets = NULL;
+	int *origins = NULL;
+	char *file_buffer = NULL;
+	FILE *fout = NULL;
+	const CvPoint *points;
+	int low = 0, high = 0, dx, dy, length;
+	long long pos;
+	bool result = false;
+
+	offsets = new long long[set.count + 1];
+	origins = new int[2 * set.count + 1];
+	if ((!offsets) || (!origins))
+		goto exit;
+
+	/* Value range gives width */
+	for (int i = 0; i < set.count; ++i) {
+		points = set.contour(i);
+		length = set.length(i);
+		offsets[i] = set.offsets[i];
+		origins[2 * i] = length ? points[0].x : 0;
+		origins[2 * i + 1] = length ? points[0].y : 0;
+		for (int j = 0; j < length; ++j) {
+			dx = points[j].x;
+			dy = points[j].y;
+			if (delta) {
+				dx -= j ? points[j - 1].x : points[0].x;
+				dy -= j ? points[j - 1].y : points[0].y;
+			}
+			low = min(low, min(dx, dy));
+			high = max(high, max(dx, dy));
+		}
+	}
+	offsets[set.count] = set.total;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, archive_magic, sizeof(header.magic));
+	header.version = archive_version;
+	header.flags = delta ? ARCHIVE_DELTA : 0;
+	header.width = value_width(low, high);
+	header.count = set.count;
+	header.total = set.total;
+	header.offsets_offset = sizeof(header);
+	pos = align8(header.offsets_offset +
+		     (set.count + 1) * sizeof(long long));
+	if (delta) {
+		header.origins_offset = pos;
+		pos = align8(pos + 2 * set.count * sizeof(int));
+	}
+	header.data_offset = pos;
+
+	if (!(fout = fopen(filename, "wb")))
+		goto exit;
+
+	file_buffer = new char[buffer_size];
+	if (file_buffer)
+		setvbuf(fout, file_buffer, _IOFBF, buffer_size);
+
+	fwrite(&header, sizeof(header), 1, fout);
+	fwrite(offsets, sizeof(long long), set.count + 1, fout);
+	pos = header.offsets_offset + (set.count + 1) * sizeof(long long);
+	fwrite(padding, align8(pos) - pos, 1, fout);
+	if (delta) {
+		fwrite(origins, sizeof(int), 2 * set.count, fout);
+		pos = 2 * set.count * sizeof(int);
+		fwrite(padding, align8(pos) - pos, 1, fout);
+	}
+
+	/* Point data, encoded one contour at a time */
+	for (int i = 0; i < set.count; ++i) {
+		points = set.contour(i);
+		length = set.length(i);
+		buffer.clear();
+		for (int j = 0; j < length; ++j) {
+			dx = points[j].x;
+			dy = points[j].y;
+			if (delta) {
+				dx -= j ? points[j - 1].x : points[0].x;
+				dy -= j ? points[j - 1].y : points[0].y;
+			}
+			put_value(buffer, dx, header.width);
+			put_value(buffer, dy, header.width);
+		}
+		if (buffer.size())
+			fwrite(&buffer[0], buffer.size(), 1, fout);
+	}
+
+	result = !ferror(fout);
+
+exit:
+	if (fout && fclose(fout))
+		result = false;
+	if (file_buffer)
+		delete [] file_buffer;
+	if (offsets)
+		delete [] offsets;
+	if (origins)
+		delete [] origins;
+
+	return result;
+}
+
+
+contour_archive::contour_archive(void): fd(-1), map(NULL), map_size(0),
+					header(NULL), offsets(NULL),
+					origins(NULL), data(NULL)
+{
+}
+
+
+contour_archive::~contour_archive(void)
+{
+	close();
+}
+
+
+bool contour_archive::validate(void)
+{
+	long long limit;
+
+	if (map_size < sizeof(archive_header))
+		return false;
+
+	header = (const archive_header *) map;
+	if (memcmp(header->magic, archive_magic, sizeof(archive_magic)) ||
+	    (header->version != archive_version) || (header->count < 0) ||
+	    (header->total < 0) || (header->flags & ~ARCHIVE_DELTA) ||
+	    ((header->width != 1) && (header->width != 2) &&
+	     (header->width != 4)))
+		return false;
+
+	/* Tables must fit in file */
+	limit = (long long) map_size;
+	if ((header->offsets_offset < (long long) sizeof(archive_header)) ||
+	    (header->offsets_offset & 7) ||
+	    (header->offsets_offset + (header->count + 1LL) *
+	     (long long) sizeof(long long) > limit))
+		return false;
+	offsets = (const long long *) (map + header->offsets_offset);
+
+	if (header->flags & ARCHIVE_DELTA) {
+		if ((header->origins_offset <= 0) ||
+		    (header->origins_offset & 7) ||
+		    (header->origins_offset + 2LL * header->count *
+		     (long long) sizeof(int) > limit))
+			return false;
+		origins = (const int *) (map + header->origins_offset);
+	}
+
+	if ((header->data_offset <= 0) || (header->total > limit) ||
+	    (header->data_offset + 2 * header->total * header->width > limit))
+		return false;
+	data = map + header->data_offset;
+
+	/* Offsets must be increasing, from 0 to total */
+	if ((offsets[0] != 0) || (offsets[header->count] != header->total))
+		return false;
+	for (int i = 0; i < header->count; ++i)
+		if ((offsets[i + 1] < offsets[i]) ||
+		    (offsets[i + 1] - offsets[i] > 0x7fffffff))
+			return false;
+
+	return true;
+}
+
+
+bool contour_archive::open(const char *filename)
+{
+	struct stat info;
+
+	close();
+
+	if ((fd = ::open(filename, O_RDONLY)) < 0)
+		return false;
+
+	if (fstat(fd, &info) || (info.st_size <= 0))
+		goto error;
+
+	map_size = info.st_size;
+	map = (char *) mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		map = NULL;
+		goto error;
+	}
+
+	if (validate())
+		return true;
+
+error:
+	close();
+	return false;
+}
+
+
+void contour_archive::close(void)
+{
+	if (map)
+		munmap(map, map_size);
+	if (fd >= 0)
+		::close(fd);
+
+	fd = -1;
+	map = NULL;
+	map_size = 0;
+	header = NULL;
+	offsets = NULL;
+	origins = NULL;
+	data = NULL;
+}
+
+
+int contour_archive::contour(int i, CvPoint *points) const
+{
+	long long k = 2 * offsets[i];
+	int length = this->length(i), width = header->width;
+	int x = 0, y = 0;
+
+	if (origins) {
+		x = origins[2 * i];
+		y = origins[2 * i + 1];
+	}
+
+	for (int j = 0; j < length; ++j, k += 2) {
+		if (origins) {
+			x += get_value(data, width, k);
+			y += get_value(data, width, k + 1);
+		} else {
+			x = get_value(data, width, k);
+			y = get_value(data, width, k + 1);
+		}
+		points[j].x = x;
+		points[j].y = y;
+	}
+
+	return length;
+}
+
+
+bool contour_archive::load(contour_set &set) const
+{
+	set.clear();
+	set.offsets = new int[count() + 1];
+	set.points = new CvPoint[total() > 0 ? total() : 1];
+	if ((!set.offsets) || (!set.points)) {
+		set.clear();
+		return false;
+	}
+
+	for (int i = 0; i <= count(); ++i)
+		set.offsets[i] = offsets[i];
+	for (int i = 0; i < count(); ++i)
+		contour(i, set.points + set.offsets[i]);
+
+	set.count = count();
+	set.total = total();
+
+	return true;
+}
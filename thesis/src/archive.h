@@ -0,0 +1,190 @@
+/**
+ * @file   archive.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Contour archive, all contours of an image in one binary file.
+ *
+ * Replaces one text file per contour (<img>_contour_N.txt). File layout
+ * (native byte order, sections 8 byte aligned):
+ *
+ * - \ref archive_header
+ * - offset table: count + 1 point indexes (long long), contour 'i' has
+ *   points offsets[i] to offsets[i + 1] - 1 (same as \ref contour_set)
+ * - origin table (delta encoding only): count pairs of int (x, y)
+ * - point data: pairs (x, y) of 'width' bytes (1, 2 or 4) each
+ *
+ * Writer picks the smallest width that holds every value. With delta
+ * encoding a value is the step from previous point (first point steps
+ * from contour origin), contours found with CV_CHAIN_APPROX_NONE are
+ * 8-connected so each point takes 2 bytes instead of 8.
+ *
+ * Point data of contour 'i' starts at offsets[i] * 2 * width, so it is
+ * found in O(1) without reading other contours.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _ARCHIVE_H_
+#define _ARCHIVE_H_
+
+#include "base.h"
+#include "contour.h"
+#include <stddef.h>
+
+/** File signature */
+const char archive_magic[8] = { 'C', 'N', 'T', 'A', 'R', 'C', 'H', 'V' };
+/** Format version */
+const int archive_version = 1;
+/** Flag: point data is delta encoded */
+const int ARCHIVE_DELTA = 1;
+
+
+/** \brief Fixed size file header. */
+struct archive_header {
+	/// Signature, see \ref archive_magic.
+	char magic[8];
+	/// Format version.
+	int version;
+	/// Encoding flags (\ref ARCHIVE_DELTA).
+	int flags;
+	/// Bytes per coordinate (1, 2 or 4).
+	int width;
+	/// Number of contours.
+	int count;
+	/// Total number of points.
+	long long total;
+	/// Offset of point offset table from file start.
+	long long offsets_offset;
+	/// Offset of origin table from file start (0 without delta).
+	long long origins_offset;
+	/// Offset of point data from file start.
+	long long data_offset;
+};
+
+
+/** Writes a contour set as an archive.
+ *
+ * @param filename Output file name.
+ * @param set Contour set.
+ * @param delta Use delta encoding.
+ *
+ * @return true in success, false otherwise.
+ */
+bool write_archive(const char *filename, const contour_set &set,
+		   bool delta = true);
+
+
+/** \brief Memory mapped reader of a contour archive.
+ *
+ * Example of use:
+ *
+ * contour_archive archive;
+ * archive.open("24esc.bmp_contours.cta");
+ * CvPoint *points = new CvPoint[archive.length(i)];
+ * archive.contour(i, points);
+ */
+class contour_archive {
+protected:
+	/** File descriptor */
+	int fd;
+	/** Mapped file */
+	char *map;
+	/** Mapped size */
+	size_t map_size;
+	/** Header, at beginning of mapping */
+	const archive_header *header;
+	/** Point index of each contour (count + 1 entries) */
+	const long long *offsets;
+	/** Contour origins (x, y), delta encoding only */
+	const int *origins;
+	/** Point data */
+	const char *data;
+
+	/** Checks header, tables and section bounds.
+	 *
+	 * @return true if file is well formed, false otherwise.
+	 */
+	bool validate(void);
+
+private:
+	/// Non copyable (it owns the mapping).
+	contour_archive(const contour_archive &);
+	/// Non copyable (it owns the mapping).
+	contour_archive &operator=(const contour_archive &);
+
+public:
+	/** Creates a closed reader. */
+	contour_archive(void);
+
+	/** Destructor, unmaps file. */
+	~contour_archive(void);
+
+	/** Maps an archive.
+	 *
+	 * @param filename File name.
+	 *
+	 * @return true in success, false if file can't be read or is not a
+	 * valid archive.
+	 */
+	bool open(const char *filename);
+
+	/** Unmaps file. */
+	void close(void);
+
+	/** Number of contours. */
+	int count(void) const {
+		return header ? header->count : 0;
+	}
+
+	/** Total number of points. */
+	long long total(void) const {
+		return header ? header->total : 0;
+	}
+
+	/** Number of points of a contour.
+	 *
+	 * @param i Contour index, ranging from 0 to (count() - 1).
+	 *
+	 * @return Number of points.
+	 */
+	int length(int i) const {
+		return offsets[i + 1] - offsets[i];
+	}
+
+	/** Decodes a contour.
+	 *
+	 * @param i Contour index.
+	 * @param points Pre-allocated vector with at least length(i)
+	 * elements.
+	 *
+	 * @return Number of points.
+	 */
+	int contour(int i, CvPoint *points) const;
+
+	/** Decodes every contour.
+	 *
+	 * @param set Contour set, previous content is released.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool load(contour_set &set) const;
+};
+
+#endif
@@ -0,0 +1,843 @@
+/** @file
+ *
+ * Headless batch driver, staged image pipeline.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "batch.h"
+#include "base.h"
+#include "contour.h"
+#include "descriptors.h"
+#include "vision.h"
+#include "output.h"
+#include "stage.h"
+#include "pipeline.h"
+#include "results.h"
+#include "moments.h"
+#include "chain.h"
+#include "database.h"
+#include "kmeans.h"
+#include "fourier.h"
+#include "quantile.h"
+#include <opencv/highgui.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <ctype.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/stat.h>
+using namespace std;
+
+
+/** \brief One image going through pipeline stages.
+ *
+ * Each stage releases what later stages don't need, so a job carries
+ * only its chain codes, descriptors and moments at the end.
+ */
+struct image_job {
+	/// Image file name.
+	string filename;
+	/// Image id in result file.
+	int id;
+	/// Gray scale image (decode stage).
+	IplImage *gray;
+	/// Thresholded image (threshold and morphology stages).
+	IplImage *thres;
+	/// Contours as packed chain codes (see chain.h), kept from
+	/// contour following to write stage.
+	chain_set chains;
+	/// Contour points, only while descriptors are calculated (and
+	/// up to write stage, for text files).
+	contour_set shapes;
+	/// Descriptors of each contour.
+	shape_features *features;
+	/// Moments of each valid contour (descriptor stage).
+	shape_moments *moments;
+
+	/// Constructor, a job with nothing done.
+	image_job(const string &name, int image): filename(name), id(image),
+						  gray(NULL), thres(NULL),
+						  chains(), shapes(),
+						  features(NULL), moments(NULL)
+		{}
+
+	/// Destructor, frees up everything.
+	~image_job(void) {
+		if (gray)
+			cvReleaseImage(&gray);
+		if (thres)
+			cvReleaseImage(&thres);
+		if (features)
+			delete [] features;
+		if (moments)
+			delete [] moments;
+	}
+
+private:
+	/// Non copyable.
+	image_job(const image_job &);
+	/// Non copyable.
+	image_job &operator=(const image_job &);
+};
+
+
+/** Cluster of a valid contour, written after the pipeline */
+struct cluster_label {
+	/// Image id.
+	int image;
+	/// Contour index in its image.
+	int contour;
+	/// Cluster index.
+	int label;
+
+	/// Sorts by image, then contour (write order depends on threads).
+	bool operator<(const cluster_label &other) const {
+		return (image < other.image) ||
+			((image == other.image) && (contour < other.contour));
+	}
+};
+
+
+/** Descriptors summarized by quantile sketches */
+enum summary_descriptor { SUMMARY_AREA, SUMMARY_DIAMETER, SUMMARY_ENERGY,
+			  SUMMARY_COUNT };
+
+/** Names of summarized descriptors, used in batch summary */
+static const char *summary_names[SUMMARY_COUNT] = {
+	"area", "diameter", "energy"
+};
+
+
+/** Shared data of pipeline workers */
+struct batch_pipeline {
+	/// Batch parameters.
+	const batch_options *options;
+	/// Input queue of each stage.
+	bounded_queue<image_job *> *queues[STAGE_COUNT];
+	/// Workers still running in each stage.
+	int running[STAGE_COUNT];
+	/// Images written out.
+	int done;
+	/// Images dropped.
+	int failed;
+	/// Result file rows of all images.
+	result_writer *writer;
+	/// Database id of first image.
+	int first_image;
+	/// Database records not appended yet.
+	vector<descriptor_record> pending;
+	/// A database append failed, records are kept for last append.
+	bool append_failed;
+	/// Clusters of valid contours (see \ref batch_options::clusters),
+	/// fitted by mini-batches while images are written, NULL if
+	/// disabled.
+	kmeans *model;
+	/// Descriptor vectors of next mini-batch.
+	vector<float> batch;
+	/// A mini-batch step failed.
+	bool fit_failed;
+	/// Distribution of valid contour descriptors (see quantile.h).
+	tdigest summary[SUMMARY_COUNT];
+	/// Protects counters, database records, mini-batch and sketches.
+	pthread_mutex_t lock;
+	/// Protects writer (held while rows are written out).
+	pthread_mutex_t output;
+	/// Protects model (held while a mini-batch step runs).
+	pthread_mutex_t fitting;
+
+	/// Constructor, queues are created by caller.
+	batch_pipeline(const batch_options *params, result_writer *results):
+		options(params), queues(), running(), done(0), failed(0),
+		writer(results), first_image(params->first_image), pending(),
+		append_failed(false), model(NULL), batch(), fit_failed(false),
+		summary(), lock(), output(), fitting()
+		{
+			pthread_mutex_init(&lock, NULL);
+			pthread_mutex_init(&output, NULL);
+			pthread_mutex_init(&fitting, NULL);
+			if (params->clusters > 0)
+				model = new kmeans(params->clusters,
+						   descriptor_dims);
+		}
+
+	/// Destructor.
+	~batch_pipeline(void) {
+		delete model;
+		pthread_mutex_destroy(&fitting);
+		pthread_mutex_destroy(&output);
+		pthread_mutex_destroy(&lock);
+	}
+
+private:
+	/// Non copyable.
+	batch_pipeline(const batch_pipeline &);
+	/// Non copyable.
+	batch_pipeline &operator=(const batch_pipeline &);
+};
+
+
+
+/** Records appended to database (or result rows written) at once, one
+ * segment */
+static const unsigned int segment_records = 4096;
+
+/** Contours of a k-means mini-batch (see \ref kmeans::partial_fit) */
+static const int cluster_batch = 4096;
+
+
+/** Stage function type.
+ *
+ * @param job Image job.
+ * @param pipe Pipeline (parameters and shared results).
+ *
+ * @return true in success, false if job must be dropped.
+ */
+typedef bool (*stage_function)(image_job *job, batch_pipeline &pipe);
+
+
+/** Decode stage: loads image, converts it to gray scale. */
+static bool decode_job(image_job *job, batch_pipeline &)
+{
+	IplImage *image = cvLoadImage(job->filename.c_str(), 1);
+
+	if (!image)
+		return false;
+
+	job->gray = cvCreateImage(cvSize(image->width, image->height),
+				  IPL_DEPTH_8U, 1);
+	cvCvtColor(image, job->gray, CV_BGR2GRAY);
+	cvReleaseImage(&image);
+
+	return true;
+}
+
+
+/** Threshold stage, releases gray image. */
+static bool threshold_job(image_job *job, batch_pipeline &pipe)
+{
+	const batch_options &options = *pipe.options;
+
+	job->thres = cvCreateImage(cvSize(job->gray->width,
+					  job->gray->height),
+				   IPL_DEPTH_8U, 1);
+	threshold(options.threshold, job->gray, job->thres);
+	cvReleaseImage(&job->gray);
+
+	return true;
+}
+
+
+/** Morphology stage: closes contours. */
+static bool morphology_job(image_job *job, batch_pipeline &)
+{
+	//Same closing of contours of single image mode
+	dilation(job->thres, job->thres);
+	erosion(job->thres, job->thres);
+
+	return true;
+}
+
+
+/** Contour following stage: flattens contours, releases image. */
+static bool contour_job(image_job *job, batch_pipeline &)
+{
+	CvMemStorage *storage = cvCreateMemStorage(0);
+	CvSeq *contours = NULL;
+	bool result;
+	int count;
+
+	/* Chain codes take 3 bits per point, instead of a CvPoint */
+	contours = chain_follow(job->thres, storage, &count);
+	result = pack_chains(contours, job->chains);
+	cvReleaseMemStorage(&storage);
+	cvReleaseImage(&job->thres);
+
+	return result;
+}
+
+
+/** Descriptor stage, see \ref descriptor_stage. */
+static bool descriptor_job(image_job *job, batch_pipeline &pipe)
+{
+	const batch_options &options = *pipe.options;
+	tdigest summary[SUMMARY_COUNT];
+	//Parallelism comes from stage workers, contours run in this thread
+	work_pool pool(1);
+
+	if (!unpack_chains(job->chains, job->shapes))
+		return false;
+
+	job->features = new shape_features[job->shapes.count];
+	if (!job->features)
+		return false;
+
+	descriptor_stage(job->shapes, job->features, options.diam_thres,
+			 pool, options.tau, NULL, options.tolerance);
+
+	/* Hu invariants walk contour points, then points are released
+	 * (unless text files need them)
+	 */
+	job->moments = new shape_moments[job->shapes.count];
+	for (int k = 0; k < job->shapes.count; ++k)
+		if (job->features[k].diameter >= options.diam_thres)
+			contour_moments(job->shapes.contour(k),
+					job->shapes.length(k), job->moments[k]);
+
+	/* Sketch of this image, merged into batch one */
+	for (int k = 0; k < job->shapes.count; ++k) {
+		const shape_features &f = job->features[k];
+		if (f.diameter < options.diam_thres)
+			continue;
+		summary[SUMMARY_AREA].add(f.area);
+		summary[SUMMARY_DIAMETER].add(f.diameter);
+		if (f.energy != energy_error)
+			summary[SUMMARY_ENERGY].add(f.energy);
+	}
+
+	pthread_mutex_lock(&pipe.lock);
+	for (int i = 0; i < SUMMARY_COUNT; ++i)
+		pipe.summary[i].merge(summary[i]);
+	pthread_mutex_unlock(&pipe.lock);
+
+	if (!options.text)
+		job->shapes.clear();
+
+	return true;
+}
+
+
+/** Write stage: appends rows to result file, text files are optional
+ * (see \ref write_results).
+ */
+static bool write_job(image_job *job, batch_pipeline &pipe)
+{
+	const batch_options &options = *pipe.options;
+	vector<descriptor_record> segment;
+	vector<float> batch;
+	float vector[descriptor_dims];
+	int count = job->chains.count;
+	string prefix;
+
+	//Rows go to disk a segment at a time, a crash loses only a few
+	pthread_mutex_lock(&pipe.output);
+	pipe.writer->append(job->id, job->features, count,
+			    options.diam_thres, job->moments);
+	if (pipe.writer->pending() >= segment_records)
+		pipe.writer->flush();
+	pthread_mutex_unlock(&pipe.output);
+
+	pthread_mutex_lock(&pipe.lock);
+	if (!options.database.empty()) {
+		make_records(pipe.first_image + job->id, job->features,
+			     count, options.diam_thres, pipe.pending);
+		/* A full segment is taken out and appended without lock (it
+		 * waits for other processes). After a failed append records
+		 * pile up for the last append of run_batch.
+		 */
+		if ((pipe.pending.size() >= segment_records) &&
+		    (!pipe.append_failed))
+			segment.swap(pipe.pending);
+	}
+	if (pipe.model) {
+		for (int k = 0; k < count; ++k) {
+			if (job->features[k].diameter < options.diam_thres)
+				continue;
+			descriptor_vector(job->features[k], vector);
+			pipe.batch.insert(pipe.batch.end(), vector,
+					  vector + descriptor_dims);
+		}
+		/* First batch seeds centers, it needs a point per cluster */
+		if ((int) pipe.batch.size() / descriptor_dims >=
+		    max(cluster_batch, options.clusters))
+			batch.swap(pipe.batch);
+	}
+	pthread_mutex_unlock(&pipe.lock);
+
+	/* Mini-batch step out of pipeline lock, in the order batches fill
+	 * up (other write workers keep going).
+	 */
+	if (batch.size()) {
+		pthread_mutex_lock(&pipe.fitting);
+		if (!pipe.model->partial_fit(&batch[0],
+					     batch.size() / descriptor_dims))
+			pipe.fit_failed = true;
+		pthread_mutex_unlock(&pipe.fitting);
+	}
+
+	if (segment.size() &&
+	    (!append_descriptors(options.database.c_str(), &segment[0],
+				 segment.size()))) {
+		pthread_mutex_lock(&pipe.lock);
+		if (!pipe.append_failed)
+			cerr << "Failed to append to " << options.database
+			     << ", records kept for a last try" << endl;
+		pipe.append_failed = true;
+		pipe.pending.insert(pipe.pending.begin(), segment.begin(),
+				    segment.end());
+		pthread_mutex_unlock(&pipe.lock);
+	}
+
+	if (!options.text)
+		return true;
+
+	prefix = result_prefix(options.output, job->filename, job->id);
+	return write_results(job->features, job->shapes, prefix.c_str(),
+			     options.diam_thres);
+}
+
+
+/** Stage functions, indexed by \ref batch_stage */
+static const stage_function stage_jobs[STAGE_COUNT] = {
+	decode_job, threshold_job, morphology_job,
+	contour_job, descriptor_job, write_job
+};
+
+/** Stage names, used in error messages */
+static const char *stage_names[STAGE_COUNT] = {
+	"decode", "threshold", "morphology",
+	"contour_follow", "descriptors", "write"
+};
+
+
+/** Worker thread parameters */
+struct stage_worker {
+	/// Pipeline.
+	batch_pipeline *pipe;
+	/// Stage of this worker.
+	int stage;
+};
+
+
+/** Worker main loop: pops jobs of its stage and pushes them to next one.
+ * Last worker of a stage to finish closes next stage queue.
+ *
+ * @param param Pointer to \ref stage_worker.
+ */
+static void *stage_main(void *param)
+{
+	stage_worker *worker = (stage_worker *) param;
+	batch_pipeline *pipe = worker->pipe;
+	int stage = worker->stage;
+	image_job *job = NULL;
+	bool last;
+
+	while (pipe->queues[stage]->pop(job)) {
+		if (!stage_jobs[stage](job, *pipe)) {
+			cerr << "Failed to " << stage_names[stage] << " image "
+			     << job->filename << endl;
+			pthread_mutex_lock(&pipe->lock);
+			++pipe->failed;
+			pthread_mutex_unlock(&pipe->lock);
+			delete job;
+			continue;
+		}
+
+		if (stage + 1 < STAGE_COUNT) {
+			//Next stage was closed (pipeline aborted)
+			if (!pipe->queues[stage + 1]->push(job)) {
+				pthread_mutex_lock(&pipe->lock);
+				++pipe->failed;
+				pthread_mutex_unlock(&pipe->lock);
+				delete job;
+			}
+			continue;
+		}
+
+		pthread_mutex_lock(&pipe->lock);
+		++pipe->done;
+		pthread_mutex_unlock(&pipe->lock);
+		delete job;
+	}
+
+	pthread_mutex_lock(&pipe->lock);
+	last = (--pipe->running[stage] == 0);
+	pthread_mutex_unlock(&pipe->lock);
+
+	if (last && (stage + 1 < STAGE_COUNT))
+		pipe->queues[stage + 1]->close();
+
+	return NULL;
+}
+
+
+/** Checks if a file name has an image extension known by OpenCV.
+ *
+ * @param name File name.
+ *
+ * @return true if it is an image, false otherwise.
+ */
+static bool is_image(const string &name)
+{
+	static const char *extensions[] = {
+		"bmp", "dib", "jpg", "jpeg", "jpe", "png", "pbm", "pgm",
+		"ppm", "sr", "ras", "tif", "tiff", NULL
+	};
+	string::size_type dot = name.rfind('.');
+	string ext;
+
+	if (dot == string::npos)
+		return false;
+
+	ext = name.substr(dot + 1);
+	for (string::size_type i = 0; i < ext.size(); ++i)
+		ext[i] = tolower(ext[i]);
+
+	for (int i = 0; extensions[i]; ++i)
+		if (ext == extensions[i])
+			return true;
+
+	return false;
+}
+
+
+bool list_images(const char *path, vector<string> &files)
+{
+	struct stat info;
+	struct dirent *entry;
+	DIR *dir = NULL;
+	string name, line;
+	vector<string> found;
+
+	if (stat(path, &info))
+		return false;
+
+	if (S_ISDIR(info.st_mode)) {
+		if (!(dir = opendir(path)))
+			return false;
+
+		while ((entry = readdir(dir))) {
+			name = entry->d_name;
+			if (is_image(name))
+				found.push_back(string(path) + "/" + name);
+		}
+		closedir(dir);
+		sort(found.begin(), found.end());
+
+	} else {
+		ifstream fin(path);
+		if (!fin)
+			return false;
+
+		while (getline(fin, line)) {
+			if (line.size() && (line[line.size() - 1] == '\r'))
+				line.erase(line.size() - 1);
+			if (line.empty() || (line[0] == '#'))
+				continue;
+			found.push_back(line);
+		}
+	}
+
+	files.insert(files.end(), found.begin(), found.end());
+
+	return true;
+}
+
+
+string result_prefix(const string &output, const string &filename,
+		     int index)
+{
+	string::size_type slash = filename.rfind('/');
+	string base = (slash == string::npos) ? filename :
+		filename.substr(slash + 1);
+	char position[16];
+
+	snprintf(position, sizeof(position), "%d_", index);
+	base = position + base;
+
+	if (output.empty())
+		return base + "_";
+
+	return output + "/" + base + "_";
+}
+
+
+/** Prints median, p90, p99 and max of summarized descriptors.
+ *
+ * @param pipe Pipeline, with its sketches.
+ */
+static void print_summary(batch_pipeline &pipe)
+{
+	tdigest *sketch;
+
+	cout << "Valid contours: " << pipe.summary[SUMMARY_AREA].count()
+	     << endl;
+	for (int i = 0; i < SUMMARY_COUNT; ++i) {
+		sketch = &pipe.summary[i];
+		if (sketch->count() <= 0)
+			continue;
+		cout << summary_names[i] << ": median "
+		     << sketch->quantile(0.5) << ", p90 "
+		     << sketch->quantile(0.9) << ", p99 "
+		     << sketch->quantile(0.99) << ", max "
+		     << sketch->max() << endl;
+	}
+}
+
+
+/** Descriptor vector of a result file row, same as \ref descriptor_vector
+ * of its contour.
+ *
+ * @param results Result file.
+ * @param segment Segment index.
+ * @param row Row index in segment.
+ * @param vector Vector with \ref descriptor_dims elements.
+ */
+static void result_vector(const result_file &results, int segment,
+			  long long row, float *vector)
+{
+	static const int columns[descriptor_dims] = {
+		COL_AREA, COL_DIAMETER, COL_PERIMETER, COL_RATIO,
+		COL_DIST_MAX, COL_DIST_MIN, COL_ENERGY
+	};
+	const void *data;
+
+	for (int d = 0; d < descriptor_dims; ++d) {
+		data = results.data(columns[d], segment);
+		if (results.column(columns[d]).type == COLUMN_FLOAT)
+			vector[d] = ((const float *) data)[row];
+		else
+			vector[d] = ((const double *) data)[row];
+	}
+}
+
+
+/** Clusters descriptors of all valid contours, see \ref kmeans.
+ *
+ * Centers are fitted by mini-batches in write stage, only last partial
+ * batch is left. Contours are then assigned a batch at a time from the
+ * result file (mapped, see \ref result_file), so only ids and labels
+ * are kept in memory.
+ *
+ * @param pipe Pipeline, with its model.
+ * @param results_name Result file name, closed.
+ * @param filename Cluster file name.
+ *
+ * @return true in success, false otherwise.
+ */
+static bool cluster_contours(batch_pipeline &pipe, const string &results_name,
+			     const string &filename)
+{
+	const batch_options &options = *pipe.options;
+	kmeans &model = *pipe.model;
+	work_pool pool(options.workers[STAGE_DESCRIPTOR]);
+	result_file results;
+	vector<cluster_label> contours;
+	vector<float> vectors((size_t) cluster_batch * descriptor_dims);
+	vector<int> ids, labels(cluster_batch);
+	const int *image, *contour;
+	long long rows;
+	int count, size;
+
+	if (pipe.writer->size() < options.clusters) {
+		cerr << "Only " << pipe.writer->size() << " contours for "
+		     << options.clusters << " clusters" << endl;
+		return false;
+	}
+
+	count = pipe.batch.size() / descriptor_dims;
+	if (count && (!model.partial_fit(&pipe.batch[0], count, &pool)))
+		pipe.fit_failed = true;
+	vector<float>().swap(pipe.batch);
+	if (pipe.fit_failed || (!model.ready()) ||
+	    (!results.open(results_name.c_str())))
+		return false;
+
+	contours.reserve(results.rows());
+	for (int s = 0; s < results.segments(); ++s) {
+		image = (const int *) results.data(COL_IMAGE, s);
+		contour = (const int *) results.data(COL_CONTOUR, s);
+		rows = results.segment_rows(s);
+		for (long long first = 0; first < rows; first += size) {
+			size = (int) min((long long) cluster_batch,
+					 rows - first);
+			for (int i = 0; i < size; ++i)
+				result_vector(results, s, first + i,
+					      &vectors[(size_t) i *
+						       descriptor_dims]);
+			if (model.assign(&vectors[0], size, &labels[0],
+					 &pool) < 0)
+				return false;
+			for (int i = 0; i < size; ++i) {
+				cluster_label item;
+				item.image = image[first + i];
+				item.contour = contour[first + i];
+				item.label = labels[i];
+				contours.push_back(item);
+			}
+		}
+	}
+	results.close();
+
+	count = contours.size();
+	sort(contours.begin(), contours.end());
+	ids.resize(2 * count);
+	labels.resize(count);
+	for (int i = 0; i < count; ++i) {
+		ids[2 * i] = contours[i].image;
+		ids[2 * i + 1] = contours[i].contour;
+		labels[i] = contours[i].label;
+	}
+
+	return count && write_clusters(filename.c_str(), model, &ids[0],
+				       &labels[0], count);
+}
+
+
+int run_batch(const vector<string> &files, const batch_options &options,
+	      int *failed)
+{
+	result_writer writer;
+	batch_pipeline pipe(&options, &writer);
+	bool appended = true;
+	string name, results_name;
+	stage_worker workers[STAGE_COUNT];
+	pthread_t *threads = NULL;
+	int stage_workers[STAGE_COUNT];
+	struct stat info;
+	int count = 0, k = 0, started, result = -1;
+	bool aborted = false;
+
+	if (failed)
+		*failed = 0;
+
+	if ((!options.output.empty()) &&
+	    (stat(options.output.c_str(), &info) || !S_ISDIR(info.st_mode))) {
+		cerr << "Output directory " << options.output
+		     << " doesn't exist" << endl;
+		return result;
+	}
+
+	//Result file is written while images go, image id is list position
+	for (unsigned int i = 0; i < files.size(); ++i)
+		writer.add_image(files[i].c_str());
+	name = options.output.empty() ? options.results :
+		options.output + "/" + options.results;
+	if (!writer.open(name.c_str())) {
+		cerr << "Failed to write " << name << endl;
+		return result;
+	}
+
+	//Database ids are taken under database lock, unique among batches
+	if ((!options.database.empty()) && (options.first_image < 0) &&
+	    ((pipe.first_image = reserve_images(options.database.c_str(),
+						files.size())) < 0)) {
+		cerr << "Failed to reserve image ids in " << options.database
+		     << endl;
+		return result;
+	}
+	if (!options.database.empty())
+		cout << "Database image ids " << pipe.first_image << " to "
+		     << pipe.first_image + (int) files.size() - 1 << endl;
+
+	for (int i = 0; i < STAGE_COUNT; ++i) {
+		pipe.queues[i] = new bounded_queue<image_job *>(
+			options.queue_size);
+		stage_workers[i] = (options.workers[i] > 0) ?
+			options.workers[i] : 1;
+		pipe.running[i] = stage_workers[i];
+		count += stage_workers[i];
+		workers[i].pipe = &pipe;
+		workers[i].stage = i;
+	}
+
+	/* Workers that failed to start are taken out of running count, so
+	 * last started one still closes next queue. A stage without
+	 * workers would block the pipeline: every queue is closed and
+	 * started workers just leave.
+	 */
+	threads = new pthread_t[count];
+	for (int i = 0; i < STAGE_COUNT; ++i) {
+		started = 0;
+		for (int j = 0; j < stage_workers[i]; ++j)
+			if (!pthread_create(&threads[k], NULL, stage_main,
+					    &workers[i])) {
+				++k;
+				++started;
+			} else {
+				pthread_mutex_lock(&pipe.lock);
+				--pipe.running[i];
+				pthread_mutex_unlock(&pipe.lock);
+			}
+
+		if (!started) {
+			cerr << "Failed to start " << stage_names[i]
+			     << " workers" << endl;
+			aborted = true;
+		}
+	}
+
+	if (aborted)
+		for (int i = 0; i < STAGE_COUNT; ++i)
+			pipe.queues[i]->close();
+
+	//Caller thread feeds first stage
+	for (unsigned int i = 0; (i < files.size()) && (!aborted); ++i)
+		pipe.queues[STAGE_DECODE]->push(new image_job(files[i], i));
+	pipe.queues[STAGE_DECODE]->close();
+
+	//Only started threads
+	for (int i = 0; i < k; ++i)
+		pthread_join(threads[i], NULL);
+
+	if (aborted) {
+		delete [] threads;
+		for (int i = 0; i < STAGE_COUNT; ++i)
+			delete pipe.queues[i];
+		return result;
+	}
+
+	if (pipe.pending.size())
+		appended = append_descriptors(options.database.c_str(),
+					      &pipe.pending[0],
+					      pipe.pending.size());
+	if (!appended)
+		cerr << "Failed to append " << pipe.pending.size()
+		     << " records to " << options.database << endl;
+
+	result = appended ? pipe.done : -1;
+	if (!writer.close()) {
+		cerr << "Failed to write " << name << endl;
+		result = -1;
+	}
+	results_name = name;
+	name = options.output.empty() ? options.cluster_file :
+		options.output + "/" + options.cluster_file;
+	if ((options.clusters > 0) &&
+	    (!cluster_contours(pipe, results_name, name))) {
+		cerr << "Failed to cluster contours" << endl;
+		result = -1;
+	}
+	if (failed)
+		*failed = pipe.failed;
+	print_summary(pipe);
+
+	delete [] threads;
+	for (int i = 0; i < STAGE_COUNT; ++i)
+		delete pipe.queues[i];
+
+	return result;
+}
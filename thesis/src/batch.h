@@ -0,0 +1,135 @@
+/**
+ * @file   batch.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Headless processing of many images in one process.
+ *
+ * Images flow through a pipeline of stages:
+ *
+ * decode -> threshold -> morphology -> contour_follow -> descriptors -> write
+ *
+ * Stages are linked by \ref bounded_queue and each one has its own
+ * number of worker threads, so a slow stage (i.e. descriptors) can have
+ * more workers than others and only a few images are in memory at a
+ * time. Results of all images go to a single result file (see
+ * results.h), keyed by image id. Text files of each image, named after
+ * image id and file name (see \ref result_prefix), are optional.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <string>
+#include <vector>
+
+/** Pipeline stages, in processing order */
+typedef enum { STAGE_DECODE, STAGE_THRESHOLD, STAGE_MORPHOLOGY,
+	       STAGE_CONTOUR, STAGE_DESCRIPTOR, STAGE_WRITE,
+	       STAGE_COUNT } batch_stage;
+
+
+/** \brief Parameters of a batch run. */
+struct batch_options {
+	/// Threshold value, pixels above it are background.
+	int threshold;
+	/// Minimal diameter of valid contours.
+	float diam_thres;
+	/// Simplification tolerance in pixels, 0 disables it.
+	double tolerance;
+	/// Curvature gaussian parameter.
+	double tau;
+	/// Number of worker threads of each stage.
+	int workers[STAGE_COUNT];
+	/// Capacity of queues between stages.
+	int queue_size;
+	/// Output directory, empty means current directory.
+	std::string output;
+	/// Result file name (see \ref result_writer), inside output directory.
+	std::string results;
+	/// Also write text files of each image.
+	bool text;
+	/// Descriptor database to append to (see database.h), can be empty.
+	std::string database;
+	/// Database id of first image, others follow list order. Negative
+	/// reserves ids in database (see \ref reserve_images), so other
+	/// batches appending to it don't reuse them.
+	int first_image;
+	/// Number of k-means clusters of valid contours, 0 disables it.
+	int clusters;
+	/// Cluster file name (see \ref write_clusters), inside output directory.
+	std::string cluster_file;
+
+	/// Default constructor, same defaults of single image mode.
+	batch_options(void): threshold(160), diam_thres(30), tolerance(0),
+			     tau(10.0), queue_size(4), output(),
+			     results("results.bin"), text(false),
+			     database(), first_image(-1), clusters(0),
+			     cluster_file("clusters.txt")
+		{
+			for (int i = 0; i < STAGE_COUNT; ++i)
+				workers[i] = 1;
+		}
+};
+
+
+/** Builds list of images to process.
+ *
+ * @param path A directory (every image file in it is taken, sorted by
+ * name) or a text file with one image file name per line (empty lines
+ * and lines starting with '#' are skipped).
+ * @param files Vector that will hold image file names.
+ *
+ * @return true in success, false if path can't be read.
+ */
+bool list_images(const char *path, std::vector<std::string> &files);
+
+/** Prefix of result files of an image: output directory, image position
+ * in list and image base name (with extension), e.g. "out/3_24esc.bmp_"
+ * gives "out/3_24esc.bmp_centroid.txt". Position keeps apart images with
+ * same base name in different directories.
+ *
+ * @param output Output directory, can be empty.
+ * @param filename Image file name.
+ * @param index Image position in list (its id in result file).
+ *
+ * @return The prefix.
+ */
+std::string result_prefix(const std::string &output,
+			  const std::string &filename, int index);
+
+/** Processes images with the staged pipeline.
+ *
+ * Images that fail in some stage (i.e. can't be decoded) are reported
+ * in standard error and dropped, others go on.
+ *
+ * @param files Image file names.
+ * @param options Batch parameters.
+ * @param failed Pointer to variable that will hold number of failed
+ * images (can be NULL).
+ *
+ * @return Number of images written out, or -1 if output directory
+ * doesn't exist or result file (or database) can't be written.
+ */
+int run_batch(const std::vector<std::string> &files,
+	      const batch_options &options, int *failed = NULL);
+
+#endif
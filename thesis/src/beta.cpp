@@ -72,18 +72,18 @@ To-do: Voronoi tesselation, User manual, integrate with other programs, maybe La
 #include "descriptors.h"
 #include "adaptors.h"
 #include "fourier.h"
+#include "stage.h"
+#include "moments.h"
+#include "batch.h"
+#include "results.h"
+#include "database.h"
 
 using namespace std;
 
-//Param threshold and external filename of contours centroid
+//Param threshold and result file name
 int edge_thresh = 250;
 int diameter_thresh = 500;
-char file_centroid[] = "centroid.txt";
-char file_area[] = "area.txt";
-char file_ratio[] = "ratio_centroid.txt";
-char file_diam[] = "diameter.txt";
-char file_perimeter[] = "perimeter.txt";
-char file_energy[] = "energy.txt";
+char file_results[] = "results.bin";
 
 //Minimum diameter
 float diam_thres = 7;
@@ -96,6 +96,8 @@ float diam_thres = 7;
 
 //Stores the found contour
 CvSeq* contours = 0;
+//Flat copy of found contours, used by descriptors
+contour_set shapes;
 CvMemStorage* storage = cvCreateMemStorage(0);
 //Our images
 IplImage *image = 0, *gray = 0, *thres = 0, *cnt_img = 0;
@@ -107,33 +109,6 @@ const int n_windows = 3;
 char *win_names[] = { "original", "threshold", "contour+centroid" };
 typedef enum { ORIGINAL, THRESH, CONTOUR } wnames;
 
-//Write centroid of each contour in external file
-//ps: the last one is the external contour
-bool write_centroid(CvSeq* contours, char *filename, float diam,
-		    float *diameters);
-
-
-//Write area of each contour in external file
-//ps: idem
-bool write_area(CvSeq* contours, char *filename, float diam,
-		float *diameters);
-
-//Write diameter of each contour in external file
-//ps: idem
-//bool write_diam(CvSeq* contours, char *filename, float diam);
-bool write_diam(CvSeq* contours, char *filename, float diam,
-		float *diameters, int thasize);
-
-
-//Write perimeter of each contour in external file
-//ps: idem
-bool write_perimeter(CvSeq* contours, char *filename, float diam,
-		float *diameters);
-
-//Calculate and write bending energy
-bool write_energy(CvSeq *contours, char *filename, float diam_thres,
-		  float *diameters);
-
 //Show the contour stored in a sequence
 void show_contour(void);
 
@@ -144,21 +119,51 @@ void on_track_diameter(int h);
 //Aux function to draw just one contour
 void draw_one_contour(m_point *contour, int size);
 
+//Headless processing of a list (or directory) of images
+int batch_main(int argc, char* argv[]);
+
 
 //Main function (duh!)
 int main(int argc, char* argv[])
 {
 
+	if ((argc >= 3) && (!strcmp(argv[1], "--batch")))
+		return batch_main(argc, argv);
+
 	char *filename = (argc >= 2 ? argv[1] : (char*)"escamas.bmp");
 	if ((image = cvLoadImage( filename, 1)) == 0) {
 		cout << "Can't find image \"escamas.bmp\". Please supply an image." <<
 			"\n\n" << "$program image_file_name <mode> <threshold_value>" <<
-			" <minimal_diameter>" <<
+			" <minimal_diameter> [--threads N] [--simplify T] [--text]" <<
+			" [--database db [--image-id I]]" <<
 			"\nwhere:" <<
 			"\tmode = batch (non visual execution)\n" <<
 			"\tthreshold_value = value which pixels above will be regarded" <<
 			"\n\t\tas background\n" <<
-			"\tminimal_diameter = shape diameter of valid objects" <<
+			"\tminimal_diameter = shape diameter of valid objects\n" <<
+			"\tN = number of threads calculating descriptors\n" <<
+			"\tT = tolerance (pixels) of contour simplification\n" <<
+			"\t--text = also write old text files (centroid.txt, ...)\n" <<
+			"\tDescriptors go to results.bin (see result_csv)\n" <<
+			"\tdb = descriptor database to append to, I = image id" <<
+			"\n\t\t(default: next free id of database)\n" <<
+			"\n$program --batch list_or_directory <threshold_value>" <<
+			" <minimal_diameter> [--workers D,T,M,C,S,W] [--queue Q]" <<
+			" [--output dir] [--results file] [--threads N]" <<
+			" [--simplify T] [--text] [--database db [--first-id I]]" <<
+			" [--clusters K]" <<
+			"\nwhere:" <<
+			"\tD,T,M,C,S,W = number of threads of decode, threshold," <<
+			"\n\t\tmorphology, contour following, descriptors and" <<
+			"\n\t\twrite stages (--threads N sets only descriptors)\n" <<
+			"\tQ = capacity of queues between stages\n" <<
+			"\tdir = directory of result file (and <id>_<image>_centroid.txt," <<
+			"\n\t\t... with --text)\n" <<
+			"\tfile = result file name, default is results.bin\n" <<
+			"\tI = database id of first image, others follow list order" <<
+			"\n\t\t(default: ids reserved in database)\n" <<
+			"\tK = k-means clusters of valid contours, written to" <<
+			"\n\t\tclusters.txt in output directory" <<
 			endl;
 		return -1;
 	}
@@ -172,17 +177,45 @@ int main(int argc, char* argv[])
 	int thres_min_diameter = 30;
 	string temp;
 	int pos = 0;
-	float *diameters = NULL;
-	int d_size = 0;
+	shape_features *features = NULL;
+	gate_stats gates;
+	int threads = 1;
+	double tolerance = 0;
+	bool text = false;
+	const char *database = NULL;
+	int image_id = -1;
+	int arg = 2;
 
 	for (int i = 2; i < argc; ++i) {
 		temp = argv[i];
+		if ((temp == "--threads") && (i + 1 < argc)) {
+			threads = atoi(argv[++i]);
+			continue;
+		}
+		if ((temp == "--simplify") && (i + 1 < argc)) {
+			tolerance = atof(argv[++i]);
+			continue;
+		}
+		if (temp == "--text") {
+			text = true;
+			continue;
+		}
+		if ((temp == "--database") && (i + 1 < argc)) {
+			database = argv[++i];
+			continue;
+		}
+		if ((temp == "--image-id") && (i + 1 < argc)) {
+			image_id = atoi(argv[++i]);
+			continue;
+		}
+
 		if (temp == "batch")
 			interactive = false;
-		else if (i == 3)
+		else if (arg == 3)
 			thres_value = atoi(argv[i]);
-		else if (i == 4)
+		else if (arg == 4)
 			thres_min_diameter = atoi(argv[i]);
+		++arg;
 	}
 
 	//Allocate image structure resource
@@ -243,8 +276,21 @@ int main(int argc, char* argv[])
 	print_contour(filename, contours, true, diam_thres);
 #endif
 
-	//Calculates all diameters. Its the threshold descriptor for others!
-	diameters = calc_diam(contours, &d_size);
+	//Copy contours once, descriptors will index this flat copy
+	flatten_contours(contours, shapes);
+
+	/* Calculates all descriptors, diameter is the threshold descriptor
+	 * for others (i.e. bending energy).
+	 */
+	features = new shape_features[shapes.count];
+	{
+		work_pool pool(threads);
+		descriptor_stage(shapes, features, diam_thres, pool, 10.0,
+				 &gates, tolerance);
+	}
+	cout << "Contours rejected by point count: " << gates.points
+	     << ", bounding box: " << gates.bbox << ", diameter: "
+	     << gates.diameter << ", valid: " << gates.passed << endl;
 
 	/* XXX: This is not natural, breaks flow of program. I think
 	 * that the correct approach is 2 logical blocks (interactive
@@ -252,23 +298,19 @@ int main(int argc, char* argv[])
 	 * code.
 	 */
 	if (interactive) {
-		CvSeq *tmp = contours;
-		for (int i = 0; i < d_size; ++i) {
+		for (int i = 0; i < shapes.count; ++i) {
 
-			if (diameters[i] > diam_thres) {
+			if (features[i].diameter > diam_thres) {
 				m_point *one_contour;
 				int length;
-				one_contour = points(contours, &length);
+				one_contour = points(shapes, i, &length);
 				draw_one_contour(one_contour, length);
 				cvWaitKey(0);
 				delete [] one_contour;
 
 			}
 
-			contours = contours->h_next;
-
 		}
-		contours = tmp;
 		//Frees allocated resources
 		win_free(n_windows, win_names);
 	}
@@ -279,17 +321,37 @@ int main(int argc, char* argv[])
 	cvReleaseImage(&thres);
 	cvReleaseImage(&cnt_img);
 
-	//Write external file with each contour centroid
-	write_centroid(contours, file_centroid, diam_thres, diameters);
-	//Write external file with each contour area
-	write_area(contours, file_area, diam_thres, diameters);
-	//Write external file with each contour diameter
-	write_diam(contours, file_diam, diam_thres, diameters, d_size);
-	//Write external file with each perimeter
-	write_perimeter(contours, file_perimeter, diam_thres, diameters);
-	//Write external file with bending energy
-	write_energy(contours, file_energy, diam_thres, diameters);
+	//Write result file with descriptors of each valid contour
+	{
+		result_writer writer;
+		writer.append(writer.add_image(filename), features, shapes,
+			      diam_thres);
+		if (!writer.write(file_results))
+			cout << "Failed to write " << file_results << endl;
+	}
+	//Shared descriptor database
+	if (database) {
+		vector<descriptor_record> records;
+		//Id taken under database lock, unless given
+		if (image_id < 0)
+			image_id = reserve_images(database, 1);
+		if (image_id < 0)
+			cout << "Failed to reserve image id in " << database
+			     << endl;
+		else {
+			cout << "Database image id " << image_id << endl;
+			make_records(image_id, features, shapes.count,
+				     diam_thres, records);
+		}
+		if (records.size() &&
+		    !append_descriptors(database, &records[0], records.size()))
+			cout << "Failed to append to " << database << endl;
+	}
+	//Old text files (1 per descriptor)
+	if (text)
+		write_results(features, shapes, "", diam_thres);
 
+	delete [] features;
 	return 0;
 }
 
@@ -329,187 +391,6 @@ void on_track_diameter(int h)
 	show_contour();
 }
 
-//Write max/min, max & min distances from centroid of each contour in external file
-//ps: the last one is the external contour
-bool write_dist(CvSeq* contours, char *filename, float diam,
-		float *diameters, m_point *centroid, int size);
-
-bool write_centroid(CvSeq* contours, char *filename, float diam,
-		    float *diameters)
-{
-	m_point *dumbo = NULL;
-	bool result = true;
-	int thasize = 0;
-
-	dumbo = calc_centroid(contours, &thasize);
-	write_dist(contours, file_ratio, diam, diameters, dumbo, thasize);
-	//ratio_dist(contours, dumbo, thasize, file_ratio);
-
-
-	try {
-		ofstream fout(filename);
-		for (int k = 0; k < thasize; ++k)
-			if (diameters[k] >= diam)
-				fout << dumbo[k].x << "     " << dumbo[k].y << endl;
-
-	}
-	catch(...) {
-		delete [] dumbo;
-		return false;
-	}
-	delete [] dumbo;
-	return result;
-}
-
-bool write_area(CvSeq* contours, char *filename, float diam,
-		float *diameters)
-{
-	float *dumbo = NULL;
-	bool result = true;
-	int thasize = 0;
-	dumbo = calc_area(contours, &thasize);
-
-	try {
-		ofstream fout(filename);
-		for (int k = 0; k < thasize; ++k)
-			if (diameters[k] >= diam)
-				fout << dumbo[k] << endl;
-
-	}
-	catch(...) {
-		delete [] dumbo;
-		return false;
-	}
-	delete [] dumbo;
-	return result;
-}
-
-
-bool write_energy(CvSeq *contours, char *filename, float diam_thres,
-		  float *diameters)
-{
-	double tau = 10.0, c_energy;
-	ocv_adaptor<int> handler(contours);
-	double *curvature = NULL;
-	int counter = -1;
-	bool result = true;
-	ofstream fout(filename);
-
-	try {
-		ofstream fout(filename);
-		do {
-
-			++counter;
-			if (diameters[counter] < diam_thres)
-				continue;
-
-			curvature = contour_curvature<ocv_adaptor<int>,
-				mcomplex<double> >
-				(handler, handler.contour_length(), tau);
-			///FIXME: Need an exception class!
-			if (!curvature)
-				throw int(10);
-
-			c_energy = energy(curvature, handler.contour_length());
-			fout << c_energy << endl;
-
-			delete [] curvature;
-
-		} while (handler.next());
-
-	} catch (...) {
-
-		result = false;
-
-	}
-
-	return result;
-}
-
-
-//Write perimeter of each contour in external file
-//ps: idem
-bool write_perimeter(CvSeq* contours, char *filename, float diam,
-		float *diameters)
-{
-	bool result = true;
-	int counter = 0;
-
-	try {
-		ofstream fout(filename);
-
-		while (contours) {
-			if (diameters[counter] > diam)
-				fout << contours->total << endl;
-
-			counter++;
-			contours = contours->h_next;
-
-		}
-
-	}
-	catch(...) {
-
-		result = false;
-	}
-
-	return result;
-}
-
-bool write_diam(CvSeq* contours, char *filename, float diam,
-		float *diameters, int thasize)
-{
-	float *dumbo = NULL;
-	bool result = true;
-	//int thasize = 0;
-	//dumbo = calc_diam(contours, &thasize);
-
-	try {
-		ofstream fout(filename);
-		for (int k = 0; k < thasize; ++k)
-			if (diameters[k] >= diam)
-				fout << diameters[k] << endl;
-	}
-	catch(...) {
-		delete [] dumbo;
-		return false;
-	}
-	delete [] dumbo;
-	return result;
-}
-
-
-//Write centroid of each contour in external file
-//ps: the last one is the external contour
-bool write_dist(CvSeq* contours, char *filename, float diam,
-		float *diameters, m_point *centroid, int size)
-{
-
-	d3point *distances = NULL;
-	bool result = true;
-
-	distances = new d3point[size];
-	ratio_dist(contours, centroid, size, distances);
-	//calc_centroid(contours, &thasize);
-	//ratio_dist(contours, dumbo, thasize, file_ratio);
-
-	try {
-		ofstream fout(filename);
-		for (int k = 0; k < size; ++k)
-			if (diameters[k] >= diam)
-				fout << distances[k].x << "     "
-				     << distances[k].y << "     "
-				     << distances[k].z << endl;
-	}
-	catch(...) {
-		delete [] distances;
-		return false;
-	}
-	delete [] distances;
-	return result;
-
-}
-
 void draw_one_contour(m_point *contour, int size)
 {
 	cvZero(cnt_img);
@@ -534,3 +415,96 @@ void draw_one_contour(m_point *contour, int size)
 
 	cvShowImage(win_names[CONTOUR], cnt_img);
 }
+
+
+int batch_main(int argc, char* argv[])
+{
+	batch_options options;
+	vector<string> files;
+	string temp;
+	int arg = 3, stage, done, failed = 0;
+	char *list;
+
+	for (int i = 3; i < argc; ++i) {
+		temp = argv[i];
+		if ((temp == "--workers") && (i + 1 < argc)) {
+			list = argv[++i];
+			for (stage = 0; (stage < STAGE_COUNT) && *list; ++stage) {
+				options.workers[stage] = atoi(list);
+				while (*list && (*list != ','))
+					++list;
+				if (*list)
+					++list;
+			}
+			continue;
+		}
+		if ((temp == "--threads") && (i + 1 < argc)) {
+			options.workers[STAGE_DESCRIPTOR] = atoi(argv[++i]);
+			continue;
+		}
+		if ((temp == "--queue") && (i + 1 < argc)) {
+			options.queue_size = atoi(argv[++i]);
+			continue;
+		}
+		if ((temp == "--output") && (i + 1 < argc)) {
+			options.output = argv[++i];
+			continue;
+		}
+		if ((temp == "--simplify") && (i + 1 < argc)) {
+			options.tolerance = atof(argv[++i]);
+			continue;
+		}
+		if ((temp == "--results") && (i + 1 < argc)) {
+			options.results = argv[++i];
+			continue;
+		}
+		if (temp == "--text") {
+			options.text = true;
+			continue;
+		}
+		if ((temp == "--database") && (i + 1 < argc)) {
+			options.database = argv[++i];
+			continue;
+		}
+		if ((temp == "--first-id") && (i + 1 < argc)) {
+			options.first_image = atoi(argv[++i]);
+			continue;
+		}
+		if ((temp == "--clusters") && (i + 1 < argc)) {
+			options.clusters = atoi(argv[++i]);
+			continue;
+		}
+
+		if (arg == 3)
+			options.threshold = atoi(argv[i]);
+		else if (arg == 4)
+			options.diam_thres = atoi(argv[i]);
+		++arg;
+	}
+
+	for (stage = 0; stage < STAGE_COUNT; ++stage)
+		if (options.workers[stage] <= 0) {
+			cout << "Usage: --workers and --threads values must be"
+			     << " greater than zero" << endl;
+			return -1;
+		}
+	if (options.queue_size <= 0) {
+		cout << "Usage: --queue value must be greater than zero"
+		     << endl;
+		return -1;
+	}
+
+	if (!list_images(argv[2], files)) {
+		cout << "Can't read image list \"" << argv[2] << "\"" << endl;
+		return -1;
+	}
+
+	done = run_batch(files, options, &failed);
+	if (done < 0)
+		return -1;
+
+	cout << "Images processed: " << done << ", failed: " << failed
+	     << endl;
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,264 @@
+/** @file
+ *
+ * Freeman chain code storage of contours.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "chain.h"
+#include <iostream>
+using namespace std;
+
+
+/** Chain code of a step between 2 neighbour points.
+ *
+ * @param dx Step in x (-1, 0 or 1).
+ * @param dy Step in y (-1, 0 or 1).
+ *
+ * @return Chain code or -1 if points are not neighbours.
+ */
+static int step_code(int dx, int dy)
+{
+	/* Indexed by [dy + 1][dx + 1] */
+	static const int table[3][3] = {
+		{ 3, 2, 1 },
+		{ 4, -1, 0 },
+		{ 5, 6, 7 }
+	};
+
+	if ((dx < -1) || (dx > 1) || (dy < -1) || (dy > 1))
+		return -1;
+
+	return table[dy + 1][dx + 1];
+}
+
+
+/** Stores a code in packed vector (which must be zeroed before). */
+static inline void put_code(unsigned char *codes, int k, int code)
+{
+	int bit = 3 * k;
+
+	codes[bit >> 3] |= (code << (bit & 7)) & 0xff;
+	if ((bit & 7) > 5)
+		codes[(bit >> 3) + 1] |= code >> (8 - (bit & 7));
+}
+
+
+/** Allocates chain set vectors, codes zeroed.
+ *
+ * @return true in success, false otherwise.
+ */
+static bool alloc_chains(chain_set &set, int count, int total)
+{
+	int bytes = chain_set::packed_size(total);
+
+	set.clear();
+	set.codes = new unsigned char[bytes];
+	set.offsets = new int[count + 1];
+	set.origins = new CvPoint[count > 0 ? count : 1];
+	if ((!set.codes) || (!set.offsets) || (!set.origins)) {
+		set.clear();
+		return false;
+	}
+
+	for (int i = 0; i < bytes; ++i)
+		set.codes[i] = 0;
+	set.offsets[0] = 0;
+	set.count = count;
+	set.total = total;
+
+	return true;
+}
+
+
+CvSeq *chain_follow(IplImage *thres, CvMemStorage* storage, int *ncontour)
+{
+	CvSeq *chains = NULL;
+
+	*ncontour = cvFindContours(thres, storage, &chains, sizeof(CvChain),
+				   CV_RETR_LIST, CV_CHAIN_CODE,
+				   cvPoint(0,0));
+
+	cout << "Number of contours found: " << *ncontour << endl;
+
+	return chains;
+}
+
+
+bool pack_chains(CvSeq *chains, chain_set &set)
+{
+	CvSeq *temp = NULL;
+	CvSeqReader reader;
+	int count = 0, total = 0, k = 0, i = 0;
+	schar code;
+
+	for (temp = chains; temp != NULL; temp = temp->h_next) {
+		++count;
+		total += temp->total;
+	}
+
+	if (!alloc_chains(set, count, total))
+		return false;
+
+	for (temp = chains; temp != NULL; temp = temp->h_next, ++i) {
+		set.origins[i] = ((CvChain *) temp)->origin;
+		cvStartReadSeq(temp, &reader);
+		for (int j = 0; j < temp->total; ++j, ++k) {
+			CV_READ_SEQ_ELEM(code, reader);
+			put_code(set.codes, k, code & 7);
+		}
+		set.offsets[i + 1] = k;
+	}
+
+	return true;
+}
+
+
+bool pack_chains(const contour_set &contours, chain_set &set)
+{
+	const CvPoint *points;
+	int length, total = 0, k = 0, next, code;
+
+	/* A single point contour has no codes, others one per point */
+	for (int i = 0; i < contours.count; ++i)
+		if (contours.length(i) > 1)
+			total += contours.length(i);
+
+	if (!alloc_chains(set, contours.count, total))
+		return false;
+
+	for (int i = 0; i < contours.count; ++i) {
+		points = contours.contour(i);
+		length = contours.length(i);
+		set.origins[i] = (length > 0) ? points[0] : cvPoint(0, 0);
+
+		for (int j = 0; (length > 1) && (j < length); ++j, ++k) {
+			next = (j + 1 < length) ? j + 1 : 0;
+			code = step_code(points[next].x - points[j].x,
+					 points[next].y - points[j].y);
+			if (code < 0) {
+				set.clear();
+				return false;
+			}
+			put_code(set.codes, k, code);
+		}
+		set.offsets[i + 1] = k;
+	}
+
+	return true;
+}
+
+
+bool unpack_chains(const chain_set &set, contour_set &contours)
+{
+	CvPoint p;
+	int length, code, k = 0, total = 0;
+
+	contours.clear();
+	for (int i = 0; i < set.count; ++i)
+		total += (set.length(i) > 0) ? set.length(i) : 1;
+
+	contours.offsets = new int[set.count + 1];
+	contours.points = new CvPoint[total > 0 ? total : 1];
+	if ((!contours.offsets) || (!contours.points)) {
+		contours.clear();
+		return false;
+	}
+
+	contours.offsets[0] = 0;
+	for (int i = 0; i < set.count; ++i) {
+		p = set.origins[i];
+		length = set.length(i);
+		contours.points[k++] = p;
+		/* Last code closes contour, back at origin */
+		for (int j = 0; j < length - 1; ++j) {
+			code = set.code(set.offsets[i] + j);
+			p.x += chain_dx[code];
+			p.y += chain_dy[code];
+			contours.points[k++] = p;
+		}
+		contours.offsets[i + 1] = k;
+	}
+
+	contours.count = set.count;
+	contours.total = total;
+
+	return true;
+}
+
+
+void chain_features(const chain_set &set, int index, shape_features &record)
+{
+	static const double step_length[8] = {
+		1, M_SQRT2, 1, M_SQRT2, 1, M_SQRT2, 1, M_SQRT2
+	};
+	long long sum_x = 0, sum_y = 0, area = 0;
+	int length = set.length(index), size, code, dx, dy, first, x, y;
+	int min_x, max_x, min_y, max_y;
+	double perimeter = 0;
+
+	x = set.origins[index].x;
+	y = set.origins[index].y;
+	min_x = max_x = x;
+	min_y = max_y = y;
+	size = (length > 0) ? length : 1;
+
+	/* Point 'j' is visited before step 'j' */
+	first = set.offsets[index];
+	for (int j = 0; j < length; ++j) {
+		sum_x += x;
+		sum_y += y;
+		if (x < min_x)
+			min_x = x;
+		if (x > max_x)
+			max_x = x;
+		if (y < min_y)
+			min_y = y;
+		if (y > max_y)
+			max_y = y;
+
+		code = set.code(first + j);
+		dx = chain_dx[code];
+		dy = chain_dy[code];
+		area += (long long) x * dy - (long long) dx * y;
+		perimeter += step_length[code];
+		x += dx;
+		y += dy;
+	}
+	if (length == 0) {
+		sum_x = x;
+		sum_y = y;
+	}
+
+	record.perimeter = size;
+	record.centroid.x = float(sum_x) / size;
+	record.centroid.y = float(sum_y) / size;
+	record.area = float((area < 0 ? -area : area) * 0.5);
+	record.length = float(perimeter);
+	record.bbox.x = min_x;
+	record.bbox.y = min_y;
+	record.bbox.width = max_x - min_x + 1;
+	record.bbox.height = max_y - min_y + 1;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file   chain.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Freeman chain code storage of contours.
+ *
+ * A contour found with CV_CHAIN_APPROX_NONE is 8-connected, so it can be
+ * stored as its first point plus one direction (0 to 7) per step. Codes
+ * are packed with 3 bits each, instead of 8 bytes of a CvPoint, which
+ * makes a big difference for huge images.
+ *
+ * Codes follow OpenCV convention (y axis pointing down):
+ *
+ *   3 2 1
+ *   4 . 0
+ *   5 6 7
+ *
+ * Point based descriptors (perimeter, area, centroid, bounding box) are
+ * calculated walking the codes, without decoding contours to points.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _CHAIN_H_
+#define _CHAIN_H_
+
+#include "base.h"
+#include "contour.h"
+#include "descriptors.h"
+
+/** Step of each chain code, x */
+const int chain_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+/** Step of each chain code, y */
+const int chain_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+
+/** \brief Packed chain codes of all contours found in an image.
+ *
+ * Contour 'i' starts at origins[i] and its codes are code(offsets[i]) to
+ * code(offsets[i + 1] - 1). Last code goes back to origin (the contour is
+ * closed), so a contour has as many points as codes (a single pixel
+ * contour has no codes at all).
+ */
+struct chain_set {
+	/// Chain codes, 3 bits each.
+	unsigned char *codes;
+	/// Index of first code of each contour, offsets[count] == total.
+	int *offsets;
+	/// First point of each contour.
+	CvPoint *origins;
+	/// Number of contours.
+	int count;
+	/// Total number of codes.
+	int total;
+
+	/// Default constructor, an empty set.
+	chain_set(void): codes(NULL), offsets(NULL), origins(NULL), count(0),
+			 total(0)
+		{}
+
+	/// Destructor, frees up vectors.
+	~chain_set(void) {
+		clear();
+	}
+
+	/// Frees up vectors, making set empty.
+	void clear(void) {
+		if (codes)
+			delete [] codes;
+		if (offsets)
+			delete [] offsets;
+		if (origins)
+			delete [] origins;
+		codes = NULL;
+		offsets = NULL;
+		origins = NULL;
+		count = total = 0;
+	}
+
+	/** Number of codes of a contour.
+	 *
+	 * @param i Contour index, ranging from 0 to (count - 1).
+	 *
+	 * @return Number of codes.
+	 */
+	int length(int i) const {
+		return offsets[i + 1] - offsets[i];
+	}
+
+	/** Reads a code.
+	 *
+	 * @param k Code index, ranging from 0 to (total - 1).
+	 *
+	 * @return Chain code.
+	 */
+	int code(int k) const {
+		int bit = 3 * k;
+		int pair = codes[bit >> 3] | (codes[(bit >> 3) + 1] << 8);
+		return (pair >> (bit & 7)) & 7;
+	}
+
+	/** Size of packed codes vector.
+	 *
+	 * @param codes Number of codes.
+	 *
+	 * @return Number of bytes (there is a spare byte, so a code can
+	 * always be read as a pair of bytes).
+	 */
+	static int packed_size(int codes) {
+		return (3 * codes + 7) / 8 + 1;
+	}
+
+private:
+	/// Non copyable (it owns its vectors).
+	chain_set(const chain_set &);
+	/// Non copyable (it owns its vectors).
+	chain_set &operator=(const chain_set &);
+};
+
+
+/** Contour following function, just like \ref contour_follow but asking
+ * OpenCV for chain codes (CV_CHAIN_CODE).
+ *
+ * @param thres Image with contours, must have 1 layer and be 8bit based.
+ * @param storage OpenCV auxiliary storage variable.
+ * @param ncontour Pointer to variable that will hold number of found contours.
+ *
+ * @return A OpenCV sequence of chains (CvChain).
+ */
+CvSeq *chain_follow(IplImage *thres, CvMemStorage* storage, int *ncontour);
+
+/** Copies a sequence of OpenCV chains into a chain set.
+ *
+ * @param chains Sequence of chains (see \ref chain_follow).
+ * @param set Chain set, previous content is released.
+ *
+ * @return true in success, false otherwise.
+ */
+bool pack_chains(CvSeq *chains, chain_set &set);
+
+/** Encodes a contour set as a chain set.
+ *
+ * @param contours Contour set, its contours must be 8-connected.
+ * @param set Chain set, previous content is released.
+ *
+ * @return true in success, false otherwise (i.e. 2 consecutive points
+ * are not neighbours).
+ */
+bool pack_chains(const contour_set &contours, chain_set &set);
+
+/** Decodes a chain set to a contour set.
+ *
+ * @param set Chain set.
+ * @param contours Contour set, previous content is released.
+ *
+ * @return true in success, false otherwise.
+ */
+bool unpack_chains(const chain_set &set, contour_set &contours);
+
+/** Calculates point based descriptors of one contour walking its codes.
+ *
+ * Fills up centroid, area, perimeter (number of points), length (with
+ * sqrt(2) for diagonal steps) and bounding box, with the same values of
+ * \ref contour_features on decoded points.
+ *
+ * @param set Chain set.
+ * @param index Contour index.
+ * @param record Record that will hold descriptors.
+ */
+void chain_features(const chain_set &set, int index, shape_features &record);
+
+#endif
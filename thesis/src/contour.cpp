@@ -76,6 +76,36 @@ CvSeq *contour_follow(IplImage *thres, CvMemStorage* storage, int *ncontour)
 
 }
 
+//Copy contours to a flat contour set
+bool flatten_contours(CvSeq *contours, contour_set &set)
+{
+	CvSeq *temp = NULL;
+	int i;
+
+	set.clear();
+	for (temp = contours; temp != NULL; temp = temp->h_next) {
+		++set.count;
+		set.total += temp->total;
+	}
+
+	set.offsets = new int[set.count + 1];
+	set.points = new CvPoint[set.total > 0 ? set.total : 1];
+	if ((!set.offsets) || (!set.points)) {
+		set.clear();
+		return false;
+	}
+
+	set.offsets[0] = 0;
+	for (i = 0, temp = contours; temp != NULL; temp = temp->h_next, ++i) {
+		if (temp->total > 0)
+			cvCvtSeqToArray(temp, set.points + set.offsets[i],
+					CV_WHOLE_SEQ);
+		set.offsets[i + 1] = set.offsets[i] + temp->total;
+	}
+
+	return true;
+}
+
 //This one marks the centroid of each found contour
 void mark_centroid(CvSeq *contour, IplImage *img, float *contour_diameters,
 		   float diam_thres)
@@ -31,6 +31,71 @@
 
 #include "base.h"
 
+/** \brief Flat storage of all contours found in an image.
+ *
+ * Points of every contour are kept one after the other in a single
+ * vector and contour 'i' spans points[offsets[i]] to
+ * points[offsets[i + 1] - 1]. Its built once (see \ref flatten_contours)
+ * and then contours can be accessed by index, without walking the
+ * OpenCV sequence list again.
+ */
+struct contour_set {
+	/// Points of all contours.
+	CvPoint *points;
+	/// Offset of first point of each contour, offsets[count] == total.
+	int *offsets;
+	/// Number of contours.
+	int count;
+	/// Total number of points.
+	int total;
+
+	/// Default constructor, an empty set.
+	contour_set(void): points(NULL), offsets(NULL), count(0), total(0)
+		{}
+
+	/// Destructor, frees up vectors.
+	~contour_set(void) {
+		clear();
+	}
+
+	/// Frees up vectors, making set empty.
+	void clear(void) {
+		if (points)
+			delete [] points;
+		if (offsets)
+			delete [] offsets;
+		points = NULL;
+		offsets = NULL;
+		count = total = 0;
+	}
+
+	/** Number of points of a contour.
+	 *
+	 * @param i Contour index, ranging from 0 to (count - 1).
+	 *
+	 * @return Contour length.
+	 */
+	int length(int i) const {
+		return offsets[i + 1] - offsets[i];
+	}
+
+	/** Points of a contour.
+	 *
+	 * @param i Contour index, ranging from 0 to (count - 1).
+	 *
+	 * @return Pointer to first point of contour.
+	 */
+	CvPoint *contour(int i) const {
+		return points + offsets[i];
+	}
+
+private:
+	/// Non copyable (it owns its vectors).
+	contour_set(const contour_set &);
+	/// Non copyable (it owns its vectors).
+	contour_set &operator=(const contour_set &);
+};
+
 /** Contour following function. Given a image, it will find the contours
  * coordinates of objects/shapes in this image. We use OpenCV to this
  * task, 'cvFindContours'.
@@ -47,6 +112,19 @@
 CvSeq *contour_follow(IplImage *thres, CvMemStorage* storage, int *ncontour);
 
 
+/** Copies a contour sequence into a flat contour set.
+ *
+ * Contour order is preserved, so index 'i' in set is the i-th contour
+ * reached following h_next.
+ *
+ * @param contours Sequence with shape contours (see \ref contour_follow).
+ * @param set Contour set, previous content is released.
+ *
+ * @return true in success, false otherwise.
+ */
+bool flatten_contours(CvSeq *contours, contour_set &set);
+
+
 /** After you have already got the contours, this function will make it easy
  * to create an image with this contours.
  *
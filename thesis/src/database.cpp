@@ -0,0 +1,472 @@
+/** @file
+ *
+ * Append only descriptor database.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "database.h"
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+
+/** Writes a whole buffer at a file offset.
+ *
+ * @return true in success, false otherwise.
+ */
+static bool write_at(int fd, const void *buffer, size_t size, off_t offset)
+{
+	const char *data = (const char *) buffer;
+	ssize_t done;
+
+	while (size > 0) {
+		done = pwrite(fd, data, size, offset);
+		if ((done < 0) && (errno == EINTR))
+			continue;
+		if (done <= 0)
+			return false;
+		data += done;
+		offset += done;
+		size -= done;
+	}
+
+	return true;
+}
+
+
+/** Reads a whole buffer from a file offset.
+ *
+ * @return true in success, false otherwise.
+ */
+static bool read_at(int fd, void *buffer, size_t size, off_t offset)
+{
+	char *data = (char *) buffer;
+	ssize_t done;
+
+	while (size > 0) {
+		done = pread(fd, data, size, offset);
+		if ((done < 0) && (errno == EINTR))
+			continue;
+		if (done <= 0)
+			return false;
+		data += done;
+		offset += done;
+		size -= done;
+	}
+
+	return true;
+}
+
+
+/** Checks signature, version and record size of a header. */
+static bool valid_header(const database_header &header)
+{
+	return (!memcmp(header.magic, database_magic, sizeof(database_magic)))
+		&& (header.version == database_version) &&
+		(header.record_size == sizeof(descriptor_record)) &&
+		(header.committed >= (long long) sizeof(database_header));
+}
+
+
+/** Opens and locks a database, creating file if needed (serializes
+ * writers of all processes).
+ *
+ * @param filename Database file name.
+ * @param header Will hold file header.
+ *
+ * @return File descriptor (unlock and close it with \ref unlock_file)
+ * or -1 in error case.
+ */
+static int lock_file(const char *filename, database_header &header)
+{
+	struct stat info;
+	int fd;
+
+	if ((fd = ::open(filename, O_RDWR | O_CREAT, 0644)) < 0)
+		return -1;
+
+	if (flock(fd, LOCK_EX)) {
+		::close(fd);
+		return -1;
+	}
+
+	if (fstat(fd, &info))
+		goto error;
+
+	if (info.st_size < (off_t) sizeof(header)) {
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, database_magic, sizeof(header.magic));
+		header.version = database_version;
+		header.record_size = sizeof(descriptor_record);
+		header.committed = sizeof(header);
+		if (!write_at(fd, &header, sizeof(header), 0))
+			goto error;
+	} else if ((!read_at(fd, &header, sizeof(header), 0)) ||
+		   (!valid_header(header)))
+		goto error;
+
+	return fd;
+
+error:
+	flock(fd, LOCK_UN);
+	::close(fd);
+	return -1;
+}
+
+
+/** Unlocks and closes a database opened by \ref lock_file. */
+static void unlock_file(int fd)
+{
+	flock(fd, LOCK_UN);
+	::close(fd);
+}
+
+
+/** Finds next image id of a database written before header had it,
+ * from segment headers.
+ *
+ * @return true in success, false if a segment header can't be read.
+ */
+static bool scan_images(int fd, database_header &header)
+{
+	segment_header segment;
+	long long offset = sizeof(header);
+
+	for (long long k = 0; k < header.segments; ++k) {
+		if (!read_at(fd, &segment, sizeof(segment), offset))
+			return false;
+		if (segment.max_image >= header.next_image)
+			header.next_image = segment.max_image + 1LL;
+		offset += sizeof(segment) +
+			(long long) segment.count * sizeof(descriptor_record);
+	}
+
+	return true;
+}
+
+
+int make_records(int image, const shape_features *features, int size,
+		 float diam, vector<descriptor_record> &records)
+{
+	descriptor_record record;
+	int count = 0;
+
+	memset(&record, 0, sizeof(record));
+	record.image = image;
+
+	for (int k = 0; k < size; ++k) {
+		const shape_features &f = features[k];
+		if (f.diameter < diam)
+			continue;
+
+		record.contour = k;
+		record.points = f.perimeter;
+		record.centroid_x = f.centroid.x;
+		record.centroid_y = f.centroid.y;
+		record.area = f.area;
+		record.diameter = f.diameter;
+		record.perimeter = f.length;
+		record.ratio = f.distances.x;
+		record.dist_max = f.distances.y;
+		record.dist_min = f.distances.z;
+		record.energy = f.energy;
+		records.push_back(record);
+		++count;
+	}
+
+	return count;
+}
+
+
+void descriptor_vector(const shape_features &features, float *vector)
+{
+	vector[0] = features.area;
+	vector[1] = features.diameter;
+	vector[2] = features.length;
+	vector[3] = features.distances.x;
+	vector[4] = features.distances.y;
+	vector[5] = features.distances.z;
+	vector[6] = features.energy;
+}
+
+
+void descriptor_vector(const descriptor_record &record, float *vector)
+{
+	vector[0] = record.area;
+	vector[1] = record.diameter;
+	vector[2] = record.perimeter;
+	vector[3] = record.ratio;
+	vector[4] = record.dist_max;
+	vector[5] = record.dist_min;
+	vector[6] = record.energy;
+}
+
+
+int reserve_images(const char *filename, int count)
+{
+	database_header header;
+	int fd, first = -1;
+
+	if (count < 0)
+		return -1;
+
+	if ((fd = lock_file(filename, header)) < 0)
+		return -1;
+
+	if ((!header.next_image) && header.segments &&
+	    (!scan_images(fd, header)))
+		goto exit;
+	if (header.next_image + count > INT_MAX)
+		goto exit;
+
+	header.next_image += count;
+	if (write_at(fd, &header, sizeof(header), 0))
+		first = header.next_image - count;
+
+exit:
+	unlock_file(fd);
+	return first;
+}
+
+
+bool append_descriptors(const char *filename,
+			const descriptor_record *records, int count,
+			bool sync)
+{
+	database_header header;
+	segment_header segment;
+	long long offset;
+	size_t bytes;
+	int fd = -1;
+	bool result = false;
+
+	if ((count < 0) || ((!records) && count))
+		return false;
+	if (!count)
+		return true;
+
+	if ((fd = lock_file(filename, header)) < 0)
+		return false;
+
+	segment.magic = segment_magic;
+	segment.count = count;
+	segment.min_image = segment.max_image = records[0].image;
+	for (int i = 1; i < count; ++i) {
+		if (records[i].image < segment.min_image)
+			segment.min_image = records[i].image;
+		if (records[i].image > segment.max_image)
+			segment.max_image = records[i].image;
+	}
+
+	/* Records, then segment header, then committed size */
+	offset = header.committed;
+	bytes = count * sizeof(descriptor_record);
+	if (!write_at(fd, records, bytes, offset + sizeof(segment)))
+		goto exit;
+	if (!write_at(fd, &segment, sizeof(segment), offset))
+		goto exit;
+	if (sync && fdatasync(fd))
+		goto exit;
+
+	/* Later reservations skip ids not given by them */
+	if ((!header.next_image) && header.segments &&
+	    (!scan_images(fd, header)))
+		goto exit;
+	if (segment.max_image >= header.next_image)
+		header.next_image = segment.max_image + 1LL;
+
+	header.committed = offset + sizeof(segment) + bytes;
+	header.segments += 1;
+	header.records += count;
+	if (!write_at(fd, &header, sizeof(header), 0))
+		goto exit;
+	if (sync && fdatasync(fd))
+		goto exit;
+
+	result = true;
+
+exit:
+	unlock_file(fd);
+	return result;
+}
+
+
+descriptor_db::descriptor_db(void): fd(-1), map(NULL), map_size(0),
+				    index(), total(0)
+{
+}
+
+
+descriptor_db::~descriptor_db(void)
+{
+	close();
+}
+
+
+bool descriptor_db::build_index(void)
+{
+	const database_header *header;
+	const segment_header *segment;
+	segment_info info;
+	long long offset, next, end;
+	bool clamped = false;
+
+	if (map_size < sizeof(database_header))
+		return false;
+
+	header = (const database_header *) map;
+	if (!valid_header(*header))
+		return false;
+
+	/* A writer may commit between fstat and mmap, then committed is
+	 * past mapping: index segments that fit in it (they are complete,
+	 * file only grows).
+	 */
+	end = header->committed;
+	if (end > (long long) map_size) {
+		end = map_size;
+		clamped = true;
+	}
+
+	offset = sizeof(database_header);
+	while (offset < end) {
+		if (offset + (long long) sizeof(segment_header) > end)
+			return clamped;
+
+		segment = (const segment_header *) (map + offset);
+		if ((segment->magic != segment_magic) || (segment->count < 0))
+			return false;
+
+		info.offset = offset + sizeof(segment_header);
+		info.first = total;
+		info.count = segment->count;
+		info.min_image = segment->min_image;
+		info.max_image = segment->max_image;
+
+		next = info.offset +
+			(long long) info.count * sizeof(descriptor_record);
+		if (next > end)
+			return clamped;
+
+		index.push_back(info);
+		total += info.count;
+		offset = next;
+	}
+
+	return true;
+}
+
+
+bool descriptor_db::open(const char *filename)
+{
+	struct stat info;
+
+	close();
+
+	if ((fd = ::open(filename, O_RDONLY)) < 0)
+		return false;
+
+	if (fstat(fd, &info) || (info.st_size <= 0))
+		goto error;
+
+	map_size = info.st_size;
+	map = (char *) mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		map = NULL;
+		goto error;
+	}
+
+	if (build_index())
+		return true;
+
+error:
+	close();
+	return false;
+}
+
+
+void descriptor_db::close(void)
+{
+	if (map)
+		munmap(map, map_size);
+	if (fd >= 0)
+		::close(fd);
+
+	fd = -1;
+	map = NULL;
+	map_size = 0;
+	index.clear();
+	total = 0;
+}
+
+
+const descriptor_record *descriptor_db::record(long long i) const
+{
+	int low = 0, high = index.size() - 1, middle;
+
+	if ((i < 0) || (i >= total))
+		return NULL;
+
+	/* Last segment whose first record is not after i */
+	while (low < high) {
+		middle = (low + high + 1) / 2;
+		if (index[middle].first <= i)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return records(low) + (i - index[low].first);
+}
+
+
+int descriptor_db::find_image(int image,
+			      vector<const descriptor_record *> &result) const
+{
+	const descriptor_record *data;
+	int count = 0;
+
+	for (unsigned int s = 0; s < index.size(); ++s) {
+		if ((image < index[s].min_image) ||
+		    (image > index[s].max_image))
+			continue;
+
+		data = records(s);
+		for (int i = 0; i < index[s].count; ++i)
+			if (data[i].image == image) {
+				result.push_back(data + i);
+				++count;
+			}
+	}
+
+	return count;
+}
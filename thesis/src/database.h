@@ -0,0 +1,305 @@
+/**
+ * @file   database.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Append only descriptor database, shared by many processes.
+ *
+ * Descriptors of a whole corpus (millions of images) go to one file of
+ * fixed width records (\ref descriptor_record). File layout (native
+ * byte order):
+ *
+ * - \ref database_header, with size of committed data
+ * - segments, each one a \ref segment_header followed by its records
+ *
+ * A writer appends a segment with \ref append_descriptors, holding an
+ * exclusive flock() on the file, so batch processes can share the same
+ * database. Records are written before segment header and header before
+ * committed size, so readers (which take no lock) never see a partial
+ * segment. A writer that dies in the middle leaves garbage beyond
+ * committed size, next writer overwrites it.
+ *
+ * Readers (\ref descriptor_db) memory map the file and build a segment
+ * index with image id range of each segment, so images can be found
+ * without touching other segments.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _DATABASE_H_
+#define _DATABASE_H_
+
+#include "descriptors.h"
+#include <vector>
+#include <stddef.h>
+
+/** File signature */
+const char database_magic[8] = { 'C', 'N', 'T', 'D', 'E', 'S', 'C', 'B' };
+/** Format version */
+const int database_version = 1;
+/** Segment signature */
+const int segment_magic = 0x31474553;
+/** Number of dimensions of \ref descriptor_vector */
+const int descriptor_dims = 7;
+
+
+/** \brief Descriptors of one contour (64 bytes). */
+struct descriptor_record {
+	/// Image id, given by writer.
+	int image;
+	/// Contour index in its image.
+	int contour;
+	/// Number of contour points.
+	int points;
+	/// Centroid, x.
+	float centroid_x;
+	/// Centroid, y.
+	float centroid_y;
+	/// Contour area.
+	float area;
+	/// Contour diameter.
+	float diameter;
+	/// Polygon perimeter.
+	float perimeter;
+	/// Max/min distance from centroid.
+	double ratio;
+	/// Max distance from centroid.
+	double dist_max;
+	/// Min distance from centroid.
+	double dist_min;
+	/// Bending energy.
+	double energy;
+};
+
+
+/** \brief File header (64 bytes). */
+struct database_header {
+	/// Signature, see \ref database_magic.
+	char magic[8];
+	/// Format version.
+	int version;
+	/// Size of a record, checked by readers.
+	int record_size;
+	/// End of last complete segment, readers stop here.
+	long long committed;
+	/// Number of segments.
+	long long segments;
+	/// Number of records.
+	long long records;
+	/// Next image id not used by any record or reservation (see
+	/// \ref reserve_images).
+	long long next_image;
+	/// Unused.
+	long long reserved;
+};
+
+
+/** \brief Segment header (16 bytes). */
+struct segment_header {
+	/// Signature, see \ref segment_magic.
+	int magic;
+	/// Number of records.
+	int count;
+	/// Smallest image id of segment records.
+	int min_image;
+	/// Largest image id of segment records.
+	int max_image;
+};
+
+
+/** \brief Segment index entry, built by readers. */
+struct segment_info {
+	/// Offset of first record from file start.
+	long long offset;
+	/// Index of first record in database.
+	long long first;
+	/// Number of records.
+	int count;
+	/// Smallest image id.
+	int min_image;
+	/// Largest image id.
+	int max_image;
+};
+
+
+/** Fills up records with descriptors of valid contours of an image.
+ *
+ * @param image Image id.
+ * @param features Descriptors of each contour.
+ * @param size Number of contours.
+ * @param diam Minimal diameter of valid contours.
+ * @param records Vector where records are appended.
+ *
+ * @return Number of appended records.
+ */
+int make_records(int image, const shape_features *features, int size,
+		 float diam, std::vector<descriptor_record> &records);
+
+/** Descriptor vector of a contour: area, diameter, perimeter (polygon
+ * length), max/min, max and min centroid distances, bending energy.
+ *
+ * @param features Contour descriptors.
+ * @param vector Vector with \ref descriptor_dims elements.
+ */
+void descriptor_vector(const shape_features &features, float *vector);
+
+/** Descriptor vector of a database record, same as above.
+ *
+ * @param record Database record.
+ * @param vector Vector with \ref descriptor_dims elements.
+ */
+void descriptor_vector(const descriptor_record &record, float *vector);
+
+/** Reserves a range of image ids of a database, creating file if
+ * needed. Safe with other processes, ids are never given twice and are
+ * above every image id already appended.
+ *
+ * @param filename Database file name.
+ * @param count Number of ids.
+ *
+ * @return First id of range (others follow it) or -1 in error case.
+ */
+int reserve_images(const char *filename, int count);
+
+/** Appends a segment to a database, creating file if needed. Safe
+ * with other processes appending to same file. Image ids should come
+ * from \ref reserve_images, ids given in another way are only kept out
+ * of later reservations.
+ *
+ * @param filename Database file name.
+ * @param records Vector with records.
+ * @param count Number of records.
+ * @param sync Flush data to disk before committing it.
+ *
+ * @return true in success, false otherwise.
+ */
+bool append_descriptors(const char *filename,
+			const descriptor_record *records, int count,
+			bool sync = false);
+
+
+/** \brief Memory mapped database reader.
+ *
+ * Example of use:
+ *
+ * descriptor_db db;
+ * db.open("corpus.db");
+ * for (int s = 0; s < db.segments(); ++s) {
+ *	const descriptor_record *r = db.records(s);
+ *	for (int i = 0; i < db.segment(s).count; ++i) ... r[i] ...
+ * }
+ *
+ * Reader sees data committed when it was opened, open it again to see
+ * newer segments.
+ */
+class descriptor_db {
+protected:
+	/** File descriptor */
+	int fd;
+	/** Mapped file */
+	char *map;
+	/** Mapped size */
+	size_t map_size;
+	/** Segment index */
+	std::vector<segment_info> index;
+	/** Number of records */
+	long long total;
+
+	/** Checks header and builds segment index.
+	 *
+	 * @return true if file is well formed, false otherwise.
+	 */
+	bool build_index(void);
+
+private:
+	/// Non copyable (it owns the mapping).
+	descriptor_db(const descriptor_db &);
+	/// Non copyable (it owns the mapping).
+	descriptor_db &operator=(const descriptor_db &);
+
+public:
+	/** Creates a closed reader. */
+	descriptor_db(void);
+
+	/** Destructor, unmaps file. */
+	~descriptor_db(void);
+
+	/** Maps a database.
+	 *
+	 * @param filename File name.
+	 *
+	 * @return true in success, false if file can't be read or is not a
+	 * valid database.
+	 */
+	bool open(const char *filename);
+
+	/** Unmaps file. */
+	void close(void);
+
+	/** Number of records. */
+	long long size(void) const {
+		return total;
+	}
+
+	/** Number of segments. */
+	int segments(void) const {
+		return index.size();
+	}
+
+	/** Segment index entry.
+	 *
+	 * @param s Segment index, ranging from 0 to (segments() - 1).
+	 *
+	 * @return Segment information.
+	 */
+	const segment_info &segment(int s) const {
+		return index[s];
+	}
+
+	/** Records of a segment.
+	 *
+	 * @param s Segment index.
+	 *
+	 * @return Pointer to segment(s).count records.
+	 */
+	const descriptor_record *records(int s) const {
+		return (const descriptor_record *) (map + index[s].offset);
+	}
+
+	/** Reads a record by its index in database.
+	 *
+	 * @param i Record index, ranging from 0 to (size() - 1).
+	 *
+	 * @return Pointer to record (binary search on segments).
+	 */
+	const descriptor_record *record(long long i) const;
+
+	/** Finds records of an image, skipping segments whose image range
+	 * doesn't include it.
+	 *
+	 * @param image Image id.
+	 * @param result Vector where pointers to records are appended.
+	 *
+	 * @return Number of records found.
+	 */
+	int find_image(int image,
+		       std::vector<const descriptor_record *> &result) const;
+};
+
+#endif
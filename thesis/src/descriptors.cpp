@@ -28,6 +28,7 @@
 
 
 #include "descriptors.h"
+#include "hull.h"
 
 #include <fstream>
 #include <iostream>
@@ -237,8 +238,8 @@ float* calc_diam(CvSeq *contour, int *size)
 {
 	CvSeq *temp = NULL;
 	float *result = NULL;
-	m_point *coord = NULL;
-	int csize = 0;
+	CvPoint *coord = NULL;
+	int capacity = 0;
 	int counter = 0;
 
 	for (temp = contour; temp != NULL; temp = temp->h_next)
@@ -248,12 +249,20 @@ float* calc_diam(CvSeq *contour, int *size)
 	result = new float[counter];
 
 	for (int i = 0; i < counter; ++i) {
-		coord = points(contour, &csize);
-		result[i] = diameter(coord, &csize);
-		delete [] coord;
+		if (contour->total > capacity) {
+			if (coord)
+				delete [] coord;
+			capacity = contour->total;
+			coord = new CvPoint[capacity];
+		}
+		cvCvtSeqToArray(contour, coord, CV_WHOLE_SEQ);
+		result[i] = diameter(coord, contour->total);
 		contour = contour->h_next;
 	}
 
+	if (coord)
+		delete [] coord;
+
 	return result;
 
 }
@@ -306,3 +315,293 @@ exit:
 
 }
 
+
+m_point centroid(const CvPoint *contour, int size)
+{
+	m_point answer;
+	float meanx = 0, meany = 0;
+
+	for (int i = 0; i < size; i++) {
+		meanx += contour[i].x;
+		meany += contour[i].y;
+	}
+
+	meanx /= size;
+	meany /= size;
+	answer.x = meanx;
+	answer.y = meany;
+
+	return answer;
+
+}
+
+
+float diameter(const CvPoint *contour, int size)
+{
+	float result = 0;
+	CvPoint *hull;
+	int hull_size;
+
+	hull = convex_hull(contour, size, &hull_size);
+	if (hull) {
+		result = hull_diameter(hull, hull_size);
+		delete [] hull;
+	}
+
+	return result;
+
+}
+
+
+d3point centroid_dist(const CvPoint *contour, int size,
+		      const m_point &center)
+{
+	d3point result;
+	float max, min, idist;
+
+	//Initializes the distances with first coordinate
+	max = min = distance(contour[0], center);
+
+	//Run over all contour and calculate distance to centroid
+	for (int j = 1; j < size; ++j) {
+		idist = distance(contour[j], center);
+		if (max < idist)
+			max = idist;
+
+		if (min > idist)
+			min = idist;
+	}
+
+	result.x = max/min;
+	result.y = max;
+	result.z = min;
+
+	return result;
+
+}
+
+
+float polygon_area(const CvPoint *contour, int size)
+{
+	double area = 0;
+	int j;
+
+	for (int i = 0; i < size; ++i) {
+		j = (i + 1 < size) ? i + 1 : 0;
+		area += (double) contour[i].x * contour[j].y -
+			(double) contour[j].x * contour[i].y;
+	}
+
+	area *= 0.5;
+	if (area < 0)
+		area = -area;
+
+	return float(area);
+
+}
+
+
+float polygon_length(const CvPoint *contour, int size)
+{
+	double length = 0, dx, dy;
+	int j;
+
+	for (int i = 0; i < size; ++i) {
+		j = (i + 1 < size) ? i + 1 : 0;
+		dx = contour[j].x - contour[i].x;
+		dy = contour[j].y - contour[i].y;
+		length += sqrt(dx * dx + dy * dy);
+	}
+
+	return float(length);
+
+}
+
+
+m_point *points(const contour_set &set, int index, int *size)
+{
+	m_point *result = NULL;
+	const CvPoint *p = set.contour(index);
+
+	*size = set.length(index);
+	result = new m_point[*size];
+	if (!result)
+		goto exit;
+
+	for (int i = 0; i < *size; ++i) {
+		result[i].x = p[i].x;
+		result[i].y = p[i].y;
+	}
+
+exit:
+	return result;
+
+}
+
+
+m_point *calc_centroid(const contour_set &set, int *size)
+{
+	m_point *answer = NULL;
+
+	*size = set.count;
+	answer = new m_point[set.count];
+
+	for (int i = 0; i < set.count; ++i)
+		answer[i] = centroid(set.contour(i), set.length(i));
+
+	return answer;
+
+}
+
+
+float *calc_area(const contour_set &set, int *size)
+{
+	float *result = NULL;
+
+	*size = set.count;
+	result = new float[set.count];
+
+	for (int i = 0; i < set.count; ++i)
+		result[i] = polygon_area(set.contour(i), set.length(i));
+
+	return result;
+
+}
+
+
+float *calc_diam(const contour_set &set, int *size)
+{
+	float *result = NULL;
+
+	*size = set.count;
+	result = new float[set.count];
+
+	for (int i = 0; i < set.count; ++i)
+		result[i] = diameter(set.contour(i), set.length(i));
+
+	return result;
+
+}
+
+
+void ratio_dist(const contour_set &set, m_point *centroid, int size,
+		d3point *distances)
+{
+	if (set.count != size)
+		return;
+
+	for (int i = 0; i < size; ++i)
+		distances[i] = centroid_dist(set.contour(i), set.length(i),
+					     centroid[i]);
+
+}
+
+
+void contour_features(const CvPoint *contour, int size,
+		      shape_features &record, bool distances)
+{
+	long long sum_x = 0, sum_y = 0, area = 0, cross;
+	long long a00 = 0, a10 = 0, a01 = 0, a20 = 0, a11 = 0, a02 = 0;
+	long long xi, yi, xj, yj;
+	double length = 0;
+	int min_x, max_x, min_y, max_y, j;
+	float dx, dy, dist, max, min;
+
+	record.perimeter = size;
+	if (size < 1)
+		return;
+
+	min_x = max_x = contour[0].x;
+	min_y = max_y = contour[0].y;
+
+	for (int i = 0; i < size; ++i) {
+		j = (i + 1 < size) ? i + 1 : 0;
+		xi = contour[i].x;
+		yi = contour[i].y;
+		xj = contour[j].x;
+		yj = contour[j].y;
+
+		sum_x += xi;
+		sum_y += yi;
+
+		if (xi < min_x)
+			min_x = contour[i].x;
+		if (xi > max_x)
+			max_x = contour[i].x;
+		if (yi < min_y)
+			min_y = contour[i].y;
+		if (yi > max_y)
+			max_y = contour[i].y;
+
+		length += sqrt(double((xj - xi) * (xj - xi) +
+				      (yj - yi) * (yj - yi)));
+
+		/* Green's theorem, each edge adds its triangle with
+		 * origin (scaled by 2, 6, 12 and 24).
+		 */
+		cross = xi * yj - xj * yi;
+		a00 += cross;
+		a10 += (xi + xj) * cross;
+		a01 += (yi + yj) * cross;
+		a20 += (xi * xi + xi * xj + xj * xj) * cross;
+		a11 += (2 * xi * yi + xi * yj + xj * yi + 2 * xj * yj) * cross;
+		a02 += (yi * yi + yi * yj + yj * yj) * cross;
+	}
+	area = a00;
+
+	/* Regression note: centroid() accumulates coordinates in a float,
+	 * which stops being exact once a sum passes 2^24. Sums here are
+	 * exact 64 bit integers, so for big contours (or far from origin)
+	 * centroids are more precise than, and differ from, centroid().
+	 * Below that the float division gives the same values.
+	 */
+	record.centroid.x = float(sum_x) / size;
+	record.centroid.y = float(sum_y) / size;
+
+	record.area = float((area < 0 ? -area : area) * 0.5);
+	record.length = float(length);
+	record.bbox.x = min_x;
+	record.bbox.y = min_y;
+	record.bbox.width = max_x - min_x + 1;
+	record.bbox.height = max_y - min_y + 1;
+
+	/* Clockwise contours give negative integrals */
+	if (area < 0) {
+		a00 = -a00;
+		a10 = -a10;
+		a01 = -a01;
+		a20 = -a20;
+		a11 = -a11;
+		a02 = -a02;
+	}
+	record.moments.m00 = a00 / 2.0;
+	record.moments.m10 = a10 / 6.0;
+	record.moments.m01 = a01 / 6.0;
+	record.moments.m20 = a20 / 12.0;
+	record.moments.m11 = a11 / 24.0;
+	record.moments.m02 = a02 / 12.0;
+
+	if (!distances)
+		return;
+
+	/* Second pass: centroid distances, on squared distances */
+	dx = contour[0].x - record.centroid.x;
+	dy = contour[0].y - record.centroid.y;
+	max = min = dx * dx + dy * dy;
+	for (int i = 1; i < size; ++i) {
+		dx = contour[i].x - record.centroid.x;
+		dy = contour[i].y - record.centroid.y;
+		dist = dx * dx + dy * dy;
+		if (max < dist)
+			max = dist;
+		if (min > dist)
+			min = dist;
+	}
+
+	max = float(sqrt(max));
+	min = float(sqrt(min));
+	record.distances.x = max/min;
+	record.distances.y = max;
+	record.distances.z = min;
+
+}
@@ -33,6 +33,7 @@
 
 
 #include "base.h"
+#include "contour.h"
 
 /** Calculates diameter (maximum distance of 2 points).
  * First version was done in 21-08-2005.
@@ -104,9 +105,6 @@ float *calc_area(CvSeq *contour, int *size);
  * @param size Pointer to variable that will hold contour's areas vector size.
  *
  * @return Vector with calculated diameter of all contours.
- *
- * TODO: it should be changed to work with m_point vectors, just like
- *       function 'diameter'.
  */
 float* calc_diam(CvSeq *contour, int *size);
 
@@ -142,4 +140,208 @@ void ratio_dist(CvSeq *contour, m_point* centroid, int size, d3point *distances)
 
 
 
+/** \brief Raw (spatial) moments of contour region up to second order.
+ *
+ * mpq is the integral of x^p * y^q over the region enclosed by the
+ * contour, calculated from contour points only (Green's theorem).
+ */
+struct raw_moments {
+	/// Order 0 (area).
+	double m00;
+	/// Order 1.
+	double m10, m01;
+	/// Order 2.
+	double m20, m11, m02;
+
+	/// Default constructor, zero's struct fields.
+	raw_moments(void): m00(0), m10(0), m01(0), m20(0), m11(0), m02(0)
+		{}
+};
+
+
+/** Gating result, tells which bound rejected a contour (see
+ * \ref descriptor_stage).
+ */
+typedef enum { /** Passed all gates, every descriptor was calculated */
+	       GATE_PASSED,
+	       /** Point count bound is below diameter threshold */
+	       GATE_POINTS,
+	       /** Bounding box diagonal is below diameter threshold */
+	       GATE_BBOX,
+	       /** Exact diameter is below threshold */
+	       GATE_DIAMETER
+} gate_result;
+
+
+/** \brief Descriptors of one contour.
+ *
+ * Filled by the descriptor stage (see \ref descriptor_stage), one record
+ * per contour in same order of \ref contour_set.
+ */
+struct shape_features {
+	/// Centroid (mean point) of contour.
+	m_point centroid;
+	/// Contour area.
+	float area;
+	/// Contour diameter.
+	float diameter;
+	/// Minimal width (see \ref hull_features).
+	float width;
+	/// Contour area divided by convex hull area.
+	float solidity;
+	/// Max/min, max and min distances from centroid.
+	d3point distances;
+	/// Number of contour points.
+	int perimeter;
+	/// Polygon perimeter (sum of edge lengths).
+	float length;
+	/// Bounding box (upright).
+	CvRect bbox;
+	/// Region raw moments.
+	raw_moments moments;
+	/// Bending energy (only calculated for contours above threshold).
+	double energy;
+	/// Gate that rejected contour, fields after it were not calculated.
+	gate_result gate;
+
+	/// Default constructor, zero's struct fields.
+	shape_features(void): centroid(), area(0), diameter(0), width(0),
+			      solidity(0), distances(), perimeter(0),
+			      length(0), bbox(), moments(), energy(0),
+			      gate(GATE_PASSED)
+		{
+			centroid.x = centroid.y = 0;
+			bbox.x = bbox.y = bbox.width = bbox.height = 0;
+		}
+};
+
+
+/** Calculates point based descriptors of one contour: centroid, area,
+ * perimeter (number of points and polygon length), bounding box, raw
+ * moments and centroid distances.
+ *
+ * All of them but centroid distances are accumulated in a single pass
+ * over contour points, distances need the centroid so they take a
+ * second one (comparing squared distances, only 2 sqrt calls).
+ * Diameter, hull geometry and energy are left untouched.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ * @param record Record that will hold descriptors.
+ * @param distances Calculate centroid distances (second pass), caller
+ * may skip it to do it on a simplified contour.
+ */
+void contour_features(const CvPoint *contour, int size,
+		      shape_features &record, bool distances = true);
+
+/** Calculates the perimeter of a polygon (sum of its edges length).
+ *
+ * @param contour Vector with polygon vertices.
+ * @param size Number of vertices.
+ *
+ * @return Polygon perimeter.
+ */
+float polygon_length(const CvPoint *contour, int size);
+
+
+/** Calculates centroid (mean point) of one contour.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ *
+ * @return The centroid.
+ */
+m_point centroid(const CvPoint *contour, int size);
+
+/** Calculates diameter of one contour, using rotating calipers on its
+ * convex hull (see \ref hull_diameter) instead of testing all pairs
+ * of points.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ *
+ * @return Calculated diameter.
+ */
+float diameter(const CvPoint *contour, int size);
+
+/** Calculates max/min, max and min distances from centroid of one
+ * contour, see \ref ratio_dist.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ * @param center Contour centroid.
+ *
+ * @return Structure with max/min (x), max (y) and min (z) distances.
+ */
+d3point centroid_dist(const CvPoint *contour, int size,
+		      const m_point &center);
+
+
+/** Contour set overloads.
+ *
+ * Same descriptors as the ones above, but calculated on a flat
+ * \ref contour_set. Contours are addressed by index, so there is no
+ * sequence list to walk (neither to count contours).
+ */
+
+/** Calculates the area of a polygon (shoelace formula).
+ *
+ * @param contour Vector with polygon vertices.
+ * @param size Number of vertices.
+ *
+ * @return Polygon area (always positive).
+ */
+float polygon_area(const CvPoint *contour, int size);
+
+/** It returns a vector with coordinates of a given contour.
+ *
+ * @param set Contour set.
+ * @param index Contour index.
+ * @param size Pointer to variable that will hold the size of returned vector.
+ *
+ * @return A vector with coordinates of one contour or NULL in error case
+ * (remember to free up this memory later).
+ */
+m_point *points(const contour_set &set, int index, int *size);
+
+/** Calculates centroid of each contour in a contour set, see
+ * \ref calc_centroid.
+ *
+ * @param set Contour set.
+ * @param size Pointer to a variable that will hold the size of answer vector.
+ *
+ * @return A vector with centroid of each contour.
+ */
+m_point *calc_centroid(const contour_set &set, int *size);
+
+/** Calculates the area of each contour in a contour set.
+ *
+ * @param set Contour set.
+ * @param size Pointer to variable that will hold areas vector size.
+ *
+ * @return Vector with calculated area of all contours.
+ */
+float *calc_area(const contour_set &set, int *size);
+
+/** Calculates diameter of each contour in a contour set.
+ *
+ * @param set Contour set.
+ * @param size Pointer to variable that will hold diameters vector size.
+ *
+ * @return Vector with calculated diameter of all contours.
+ */
+float *calc_diam(const contour_set &set, int *size);
+
+/** Calculates max/min, max and min distances of centroids in each
+ * contour of a contour set, see \ref ratio_dist.
+ *
+ * @param set Contour set.
+ * @param centroid Vector with centroid coordinates of contours.
+ * @param size The size of vector (must be equal to number of contours).
+ * @param distances Pre-allocated vector of structure with 3 fields (x, y, z).
+ */
+void ratio_dist(const contour_set &set, m_point *centroid, int size,
+		d3point *distances);
+
+
 #endif
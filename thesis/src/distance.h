@@ -0,0 +1,115 @@
+/**
+ * @file   distance.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Distance kernels of descriptor vectors.
+ *
+ * Vectors are padded with zeros to a multiple of 4 floats (see
+ * \ref vector_stride), so kernels work 4 dimensions at a time with SSE
+ * and need no remainder loop.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _DISTANCE_H_
+#define _DISTANCE_H_
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+/** Floats of a padded vector.
+ *
+ * @param dim Number of dimensions.
+ *
+ * @return dim rounded up to a multiple of 4.
+ */
+inline int vector_stride(int dim)
+{
+	return (dim + 3) & ~3;
+}
+
+
+/** Squared euclidean distance of padded vectors.
+ *
+ * @param a Vector with 'stride' floats.
+ * @param b Vector with 'stride' floats.
+ * @param stride Multiple of 4.
+ *
+ * @return Squared distance.
+ */
+inline float distance2(const float *a, const float *b, int stride)
+{
+#ifdef __SSE__
+	__m128 sum = _mm_setzero_ps(), diff;
+	float parts[4];
+
+	for (int i = 0; i < stride; i += 4) {
+		diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+		sum = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+	}
+	_mm_storeu_ps(parts, sum);
+
+	return (parts[0] + parts[1]) + (parts[2] + parts[3]);
+#else
+	float sum = 0, diff;
+
+	for (int i = 0; i < stride; ++i) {
+		diff = a[i] - b[i];
+		sum += diff * diff;
+	}
+
+	return sum;
+#endif
+}
+
+
+/** Nearest of a set of padded vectors.
+ *
+ * @param vector Vector with 'stride' floats.
+ * @param set 'count' vectors, 'stride' floats each.
+ * @param count Number of vectors in set (at least 1).
+ * @param stride Multiple of 4.
+ * @param distance If not NULL, will hold squared distance to nearest.
+ *
+ * @return Index of nearest vector.
+ */
+inline int nearest(const float *vector, const float *set, int count,
+		   int stride, float *distance = NULL)
+{
+	float best = distance2(vector, set, stride), dist;
+	int result = 0;
+
+	for (int i = 1; i < count; ++i) {
+		dist = distance2(vector, set + i * stride, stride);
+		if (dist < best) {
+			best = dist;
+			result = i;
+		}
+	}
+
+	if (distance)
+		*distance = best;
+
+	return result;
+}
+
+#endif
@@ -115,7 +115,11 @@ void transform(TYPE1 g, int length, TYPE2 G, TYPE3 *mutex)
 	pthread_mutex_unlock(mutex);
 
 	fftw_execute(fwd_plan);
+
+	/* Plan destruction touches planner data too */
+	pthread_mutex_lock(mutex);
 	fftw_destroy_plan(fwd_plan);
+	pthread_mutex_unlock(mutex);
 }
 
 /** It does fourier transform in a given vector. Pay attention that its not
@@ -172,7 +176,11 @@ void inverse(TYPE1 G, int length, TYPE2 g, TYPE3 *mutex)
 	pthread_mutex_unlock(mutex);
 
 	fftw_execute(inv_plan);
+
+	/* Plan destruction touches planner data too */
+	pthread_mutex_lock(mutex);
 	fftw_destroy_plan(inv_plan);
+	pthread_mutex_unlock(mutex);
 }
 
 
@@ -184,7 +192,6 @@ void inverse(TYPE1 G, int length, TYPE2 g, TYPE3 *mutex)
  * @param length Length of signal vector
  *
  * @return A new vector with shifted signal or NULL on error.
- * FIXME: make it work with vector's length = 3.
  */
 template <class TYPE>
 TYPE *shift(TYPE *signal, int length)
@@ -208,9 +215,8 @@ TYPE *shift(TYPE *signal, int length)
 		for (i = 0; i < cutoff - 1; ++i, ++counter)
 			transf[i] = signal[cutoff + i];
 
-		/* XXX: do we need this arithmetic? */
 		for (i = cutoff - 1; i < length; ++i, ++counter)
-			transf[i] = signal[i - cutoff - 2];
+			transf[i] = signal[i - cutoff + 1];
 
 	} else {
 
@@ -293,7 +299,7 @@ TYPE *unshift(TYPE *signal, int length)
  *
  * TODO: use type mcomplex.
  */
-std::complex<double> *create_filter(double diff_level, int length)
+inline std::complex<double> *create_filter(double diff_level, int length)
 {
 	std::complex<double> *res;
 	res = new std::complex<double>[length];
@@ -371,7 +377,8 @@ inline double calc_scnst(double tau)
  *       this function tends to infinite (inf). I test it against Scilab
  *       with: tau = 10; f= 7; exp((2*%pi^2/(tau^2))*f^2)
  */
-double *gaussian_fourier(int length, double tau = 2.0, double upper = 6.0)
+inline double *gaussian_fourier(int length, double tau = 2.0,
+				double upper = 6.0)
 {
 	double cnst, sampling, lower;
 	double *G = NULL;
@@ -476,7 +483,10 @@ std::complex<double> *differentiate(TYPE1 signal, int length,
 	if (!tmp2)
 		goto error;
 
-	inverse(tmp2, length, tmp);
+	if (mutex)
+		inverse(tmp2, length, tmp, mutex);
+	else
+		inverse(tmp2, length, tmp);
 	res = tmp;
 
 	/* Pay attention that Fourier inverse is not
@@ -599,11 +609,15 @@ exit:
  * @param extra_filter Use an extra filter (e.g. beta function) to control
  * high curvature spikes.
  *
+ * @param mutex A mutex object to lock when doing fourier transform (only
+ * needed when several threads calculate curvature at same time).
+ *
  * @return A vector with contour curvature or NULL on error.
  */
 template <typename TYPE1, typename TYPE2>
 double *contour_curvature(TYPE1 signal, int length, double tau = 8,
-		      bool normalize = false, FILTER_TYPE extra_filter = FBETA)
+		      bool normalize = false, FILTER_TYPE extra_filter = FBETA,
+		      pthread_mutex_t *mutex = NULL)
 {
 	double *result = NULL;
 	TYPE2 *x, *y;
@@ -623,13 +637,13 @@ double *contour_curvature(TYPE1 signal, int length, double tau = 8,
 	}
 
 	x_diff = (mcomplex<double>*) differentiate(x, length, diff_level = 1,
-						   tau);
+						   tau, mutex);
 	xx_diff = (mcomplex<double>*) differentiate(x, length,diff_level = 2,
-						    tau);
+						    tau, mutex);
 	y_diff = (mcomplex<double>*) differentiate(y, length, diff_level = 1,
-						   tau);
+						   tau, mutex);
 	yy_diff = (mcomplex<double>*) differentiate(y, length, diff_level = 2,
-						    tau);
+						    tau, mutex);
 	if ((!x_diff) || (!xx_diff) || (!y_diff) || (!yy_diff))
 		goto cleanup;
 
@@ -666,15 +680,17 @@ exit:
  * @param tau see \ref contour_curvature
  * @param normalize see \ref contour_curvature
  * @param extra_filter see \ref contour_curvature
+ * @param mutex see \ref contour_curvature
  *
  * @return see \ref contour_curvature
  */
 template <typename TYPE>
 double *contour_curvature(TYPE *signal, int length, double tau = 8,
-		      bool normalize = false, FILTER_TYPE extra_filter = FBETA)
+		      bool normalize = false, FILTER_TYPE extra_filter = FBETA,
+		      pthread_mutex_t *mutex = NULL)
 {
 	return contour_curvature<TYPE *, TYPE>(signal, length, tau, normalize,
-					     extra_filter);
+					     extra_filter, mutex);
 
 }
 /** Calculates multiscale bending energy.
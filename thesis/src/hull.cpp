@@ -0,0 +1,276 @@
+/** @file
+ *
+ * Convex hull module, hull based shape geometry.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "hull.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+/** Lexicographic order of points (x first, then y). */
+static bool point_less(const CvPoint &a, const CvPoint &b)
+{
+	return (a.x < b.x) || ((a.x == b.x) && (a.y < b.y));
+}
+
+/** Cross product of (a - o) and (b - o), positive when o->a->b turns
+ * counterclockwise.
+ */
+static inline long long cross(const CvPoint &o, const CvPoint &a,
+			      const CvPoint &b)
+{
+	return (long long) (a.x - o.x) * (b.y - o.y) -
+		(long long) (a.y - o.y) * (b.x - o.x);
+}
+
+/** Dot product of (b - a) and (d - c). */
+static inline long long dot(const CvPoint &a, const CvPoint &b,
+			    const CvPoint &c, const CvPoint &d)
+{
+	return (long long) (b.x - a.x) * (d.x - c.x) +
+		(long long) (b.y - a.y) * (d.y - c.y);
+}
+
+/** Squared distance of 2 points. */
+static inline long long square_dist(const CvPoint &a, const CvPoint &b)
+{
+	long long dx = a.x - b.x, dy = a.y - b.y;
+	return dx * dx + dy * dy;
+}
+
+/** Twice the signed area of a polygon (shoelace formula). */
+static long long twice_area(const CvPoint *polygon, int size)
+{
+	long long area = 0;
+	int j;
+
+	for (int i = 0; i < size; ++i) {
+		j = (i + 1 < size) ? i + 1 : 0;
+		area += (long long) polygon[i].x * polygon[j].y -
+			(long long) polygon[j].x * polygon[i].y;
+	}
+
+	return area;
+}
+
+
+CvPoint *convex_hull(const CvPoint *contour, int size, int *hull_size)
+{
+	CvPoint *sorted = NULL, *hull = NULL;
+	int k = 0, lower;
+
+	*hull_size = 0;
+	if ((!contour) || (size < 1))
+		goto exit;
+
+	sorted = new CvPoint[size];
+	hull = new CvPoint[size + 1];
+	if ((!sorted) || (!hull))
+		goto error;
+
+	std::copy(contour, contour + size, sorted);
+	std::sort(sorted, sorted + size, point_less);
+
+	/* Lower hull */
+	for (int i = 0; i < size; ++i) {
+		while ((k >= 2) && (cross(hull[k - 2], hull[k - 1],
+					  sorted[i]) <= 0))
+			--k;
+		hull[k++] = sorted[i];
+	}
+
+	/* Upper hull, last point is first point of lower hull */
+	lower = k + 1;
+	for (int i = size - 2; i >= 0; --i) {
+		while ((k >= lower) && (cross(hull[k - 2], hull[k - 1],
+					      sorted[i]) <= 0))
+			--k;
+		hull[k++] = sorted[i];
+	}
+
+	/* First point is repeated at end (except for a single point) */
+	if (k > 1)
+		--k;
+	/* All points equal, lower and upper hulls are the same point */
+	if ((k == 2) && (hull[0].x == hull[1].x) && (hull[0].y == hull[1].y))
+		k = 1;
+
+	*hull_size = k;
+	goto exit;
+
+error:
+	if (hull)
+		delete [] hull;
+	hull = NULL;
+
+exit:
+	if (sorted)
+		delete [] sorted;
+
+	return hull;
+}
+
+
+float hull_diameter(const CvPoint *hull, int size)
+{
+	long long best = 0, tmp;
+	int j = 1, next;
+
+	if (size < 2)
+		return 0;
+	if (size == 2)
+		return float(sqrt(double(square_dist(hull[0], hull[1]))));
+
+	/* For each edge, advance antipodal vertex while it gets farther
+	 * from edge line. Farthest pair is one of antipodal pairs.
+	 */
+	for (int i = 0; i < size; ++i) {
+		next = (i + 1) % size;
+		while (cross(hull[i], hull[next], hull[(j + 1) % size]) >
+		       cross(hull[i], hull[next], hull[j]))
+			j = (j + 1) % size;
+
+		tmp = std::max(square_dist(hull[i], hull[j]),
+			       square_dist(hull[next], hull[j]));
+		if (tmp > best)
+			best = tmp;
+	}
+
+	return float(sqrt(double(best)));
+}
+
+
+/** Fills up rectangle corners.
+ *
+ * @param rect Vector with 4 corners.
+ * @param origin Edge first vertex.
+ * @param ux Edge unit vector, x.
+ * @param uy Edge unit vector, y.
+ * @param low Minimal projection of hull along edge.
+ * @param high Maximal projection of hull along edge.
+ * @param height Distance from edge to farthest vertex.
+ */
+static void rect_corners(m_point *rect, const CvPoint &origin, double ux,
+			 double uy, double low, double high, double height)
+{
+	/* Normal pointing inside a counterclockwise hull */
+	double nx = -uy, ny = ux;
+
+	rect[0].x = origin.x + ux * low;
+	rect[0].y = origin.y + uy * low;
+	rect[1].x = origin.x + ux * high;
+	rect[1].y = origin.y + uy * high;
+	rect[2].x = rect[1].x + nx * height;
+	rect[2].y = rect[1].y + ny * height;
+	rect[3].x = rect[0].x + nx * height;
+	rect[3].y = rect[0].y + ny * height;
+}
+
+
+bool hull_geometry(const CvPoint *contour, int size, hull_features &result)
+{
+	CvPoint *hull = NULL;
+	int hsize, j, k, m, next;
+	long long area;
+	double length, ux, uy, height, low, high, rect_area;
+	bool first = true;
+
+	result = hull_features();
+	hull = convex_hull(contour, size, &hsize);
+	if (!hull)
+		return false;
+
+	if (hsize < 3) {
+		result.diameter = hull_diameter(hull, hsize);
+		rect_corners(result.rect, hull[0], 1, 0, 0, 0, 0);
+		if (hsize == 2) {
+			result.rect[1].x = result.rect[2].x = hull[1].x;
+			result.rect[1].y = result.rect[2].y = hull[1].y;
+		}
+		result.solidity = 1;
+		goto exit;
+	}
+
+	result.diameter = hull_diameter(hull, hsize);
+	result.hull_area = float(twice_area(hull, hsize) * 0.5);
+	area = twice_area(contour, size);
+	if (area < 0)
+		area = -area;
+	result.solidity = float(area * 0.5 / result.hull_area);
+
+	/* Rotating calipers: for each hull edge, k is the vertex with
+	 * maximal projection along edge, j the farthest from edge line and
+	 * m the one with minimal projection. All of them only move forward.
+	 */
+	j = k = m = 1;
+	for (int i = 0; i < hsize; ++i) {
+		next = (i + 1) % hsize;
+
+		if (first)
+			k = next;
+		while (dot(hull[i], hull[next], hull[k], hull[(k + 1) % hsize])
+		       > 0)
+			k = (k + 1) % hsize;
+
+		if (first)
+			j = k;
+		while (cross(hull[i], hull[next], hull[(j + 1) % hsize]) >
+		       cross(hull[i], hull[next], hull[j]))
+			j = (j + 1) % hsize;
+
+		if (first)
+			m = j;
+		while (dot(hull[i], hull[next], hull[m], hull[(m + 1) % hsize])
+		       < 0)
+			m = (m + 1) % hsize;
+		first = false;
+
+		length = sqrt(double(square_dist(hull[i], hull[next])));
+		ux = (hull[next].x - hull[i].x) / length;
+		uy = (hull[next].y - hull[i].y) / length;
+		height = cross(hull[i], hull[next], hull[j]) / length;
+		high = dot(hull[i], hull[next], hull[i], hull[k]) / length;
+		low = dot(hull[i], hull[next], hull[i], hull[m]) / length;
+		rect_area = (high - low) * height;
+
+		if ((i == 0) || (height < result.width))
+			result.width = float(height);
+
+		if ((i == 0) || (rect_area < result.rect_area)) {
+			result.rect_area = float(rect_area);
+			rect_corners(result.rect, hull[i], ux, uy, low, high,
+				     height);
+		}
+	}
+
+exit:
+	delete [] hull;
+
+	return true;
+}
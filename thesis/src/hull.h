@@ -0,0 +1,97 @@
+/**
+ * @file   hull.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Convex hull module, hull based shape geometry.
+ *
+ * Convex hull is calculated with Andrew's monotone chain (O(n log n))
+ * and then rotating calipers visit it in linear time, giving exact
+ * diameter (farthest points of a shape are always hull vertices),
+ * minimal width, minimal area bounding rectangle and solidity.
+ *
+ * Since contour points are integer, orientation tests and squared
+ * distances are done with integer arithmetic (no rounding issues).
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _HULL_H_
+#define _HULL_H_
+
+#include "base.h"
+
+/** \brief Hull based geometry of one contour. */
+struct hull_features {
+	/// Maximum distance of 2 points.
+	float diameter;
+	/// Minimal distance between 2 parallel lines enclosing contour.
+	float width;
+	/// Corners of minimal area bounding rectangle.
+	m_point rect[4];
+	/// Area of minimal bounding rectangle.
+	float rect_area;
+	/// Area of convex hull.
+	float hull_area;
+	/// Contour area divided by hull area (1 for convex shapes).
+	float solidity;
+
+	/// Default constructor, zero's struct fields.
+	hull_features(void): diameter(0), width(0), rect_area(0),
+			     hull_area(0), solidity(0)
+		{
+			for (int i = 0; i < 4; ++i)
+				rect[i].x = rect[i].y = 0;
+		}
+};
+
+
+/** Calculates convex hull of a set of points.
+ *
+ * @param contour Vector with points (need not to be in any order).
+ * @param size Number of points.
+ * @param hull_size Pointer to variable that will hold number of hull
+ * vertices.
+ *
+ * @return A vector with hull vertices in counterclockwise order
+ * (without collinear points) or NULL in error case (remember to free
+ * up this memory later).
+ */
+CvPoint *convex_hull(const CvPoint *contour, int size, int *hull_size);
+
+/** Calculates diameter of a convex polygon with rotating calipers.
+ *
+ * @param hull Vector with hull vertices (see \ref convex_hull).
+ * @param size Number of vertices.
+ *
+ * @return Maximum distance of 2 vertices.
+ */
+float hull_diameter(const CvPoint *hull, int size);
+
+/** Calculates all hull based descriptors of a contour.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ * @param result Structure that will hold descriptors.
+ *
+ * @return true in success, false otherwise.
+ */
+bool hull_geometry(const CvPoint *contour, int size, hull_features &result);
+
+#endif
@@ -0,0 +1,553 @@
+/** @file
+ *
+ * KD-tree index of shape descriptor vectors.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "kdtree.h"
+#include "distance.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+using namespace std;
+
+
+/** Candidate neighbour: squared distance and point position */
+typedef pair<float, int> neighbour;
+
+/** Max heap of candidates, worst one on top */
+typedef priority_queue<neighbour> neighbour_heap;
+
+
+/** \brief File header. */
+struct kdtree_header {
+	/// Signature, see \ref kdtree_magic.
+	char magic[8];
+	/// Format version.
+	int version;
+	/// Number of dimensions.
+	int dim;
+	/// Floats per stored vector.
+	int stride;
+	/// Number of points.
+	int count;
+	/// Maximum points per leaf.
+	int leaf_size;
+	/// Number of nodes.
+	int node_count;
+};
+
+
+/** Subtree to be built by a task */
+struct build_job {
+	/// Node index.
+	int node;
+	/// First point.
+	int begin;
+	/// One past last point.
+	int end;
+};
+
+
+/** Shared data of build tasks */
+struct build_data {
+	/// The tree.
+	kd_tree *tree;
+	/// Subtrees.
+	vector<build_job> *jobs;
+	/// Normalized points.
+	const float *points;
+	/// Point indexes.
+	int *order;
+};
+
+
+/** Shared data of search tasks */
+struct search_data {
+	/// The tree.
+	const kd_tree *tree;
+	/// Raw query vectors.
+	const float *queries;
+	/// Number of neighbours.
+	int k;
+	/// Output ids.
+	int *ids;
+	/// Output distances.
+	float *distances;
+};
+
+
+/** Compares 2 points by one coordinate */
+struct coordinate_less {
+	/// Normalized points.
+	const float *points;
+	/// Floats per point.
+	int stride;
+	/// Compared dimension.
+	int dim;
+
+	/// Compares points a and b.
+	bool operator()(int a, int b) const {
+		return points[a * stride + dim] < points[b * stride + dim];
+	}
+};
+
+
+kd_tree::kd_tree(void): dim(0), stride(0), count(0), leaf_size(0),
+			node_count(0), mean(NULL), scale(NULL), data(NULL),
+			ids(NULL), nodes(NULL)
+{
+}
+
+
+kd_tree::~kd_tree(void)
+{
+	clear();
+}
+
+
+void kd_tree::clear(void)
+{
+	if (mean)
+		delete [] mean;
+	if (scale)
+		delete [] scale;
+	if (data)
+		delete [] data;
+	if (ids)
+		delete [] ids;
+	if (nodes)
+		delete [] nodes;
+
+	mean = scale = data = NULL;
+	ids = NULL;
+	nodes = NULL;
+	dim = stride = count = leaf_size = node_count = 0;
+}
+
+
+int kd_tree::subtree_nodes(int size) const
+{
+	if (size <= leaf_size)
+		return 1;
+
+	return 1 + subtree_nodes(size / 2) + subtree_nodes(size - size / 2);
+}
+
+
+void kd_tree::normalize(const float *vector, float *result) const
+{
+	int i;
+
+	for (i = 0; i < dim; ++i)
+		result[i] = (vector[i] - mean[i]) * scale[i];
+	for (; i < stride; ++i)
+		result[i] = 0;
+}
+
+
+int kd_tree::split_node(int node, int begin, int end, const float *points,
+			int *order)
+{
+	kd_node &entry = nodes[node];
+	coordinate_less less;
+	float low, high, spread = -1, value;
+	int middle = begin + (end - begin) / 2;
+
+	entry.begin = begin;
+	entry.end = end;
+	entry.dim = -1;
+	entry.right = -1;
+	entry.split = 0;
+	if (end - begin <= leaf_size)
+		return -1;
+
+	/* Dimension with biggest spread */
+	for (int d = 0; d < dim; ++d) {
+		low = high = points[order[begin] * stride + d];
+		for (int i = begin + 1; i < end; ++i) {
+			value = points[order[i] * stride + d];
+			low = min(low, value);
+			high = max(high, value);
+		}
+		if (high - low > spread) {
+			spread = high - low;
+			entry.dim = d;
+		}
+	}
+
+	less.points = points;
+	less.stride = stride;
+	less.dim = entry.dim;
+	nth_element(order + begin, order + middle, order + end, less);
+
+	entry.split = points[order[middle] * stride + entry.dim];
+	entry.right = node + 1 + subtree_nodes(middle - begin);
+
+	return middle;
+}
+
+
+void kd_tree::build_subtree(int node, int begin, int end,
+			    const float *points, int *order)
+{
+	int middle = split_node(node, begin, end, points, order);
+
+	if (middle < 0)
+		return;
+
+	build_subtree(node + 1, begin, middle, points, order);
+	build_subtree(nodes[node].right, middle, end, points, order);
+}
+
+
+void kd_tree::build_task(int index, void *param)
+{
+	build_data *shared = (build_data *) param;
+	build_job &job = (*shared->jobs)[index];
+
+	shared->tree->build_subtree(job.node, job.begin, job.end,
+				    shared->points, shared->order);
+}
+
+
+bool kd_tree::build(const float *vectors, int size, int dimensions,
+		    work_pool *pool, int leaf)
+{
+	float *points = NULL;
+	int *order = NULL;
+	double sum, sum2, value;
+	vector<build_job> jobs, split;
+	build_job job;
+	build_data shared;
+	unsigned int target;
+	int middle;
+	bool result = false;
+
+	clear();
+	if ((!vectors) || (size < 1) || (dimensions < 1))
+		goto exit;
+
+	dim = dimensions;
+	stride = vector_stride(dim);
+	count = size;
+	leaf_size = (leaf > 0) ? leaf : 1;
+	node_count = subtree_nodes(count);
+
+	mean = new float[dim];
+	scale = new float[dim];
+	points = new float[(size_t) count * stride];
+	order = new int[count];
+	nodes = new kd_node[node_count];
+	if ((!mean) || (!scale) || (!points) || (!order) || (!nodes))
+		goto exit;
+
+	/* Per dimension normalization: zero mean, unit variance */
+	for (int d = 0; d < dim; ++d) {
+		sum = sum2 = 0;
+		for (int i = 0; i < count; ++i) {
+			value = vectors[(size_t) i * dim + d];
+			sum += value;
+			sum2 += value * value;
+		}
+		mean[d] = sum / count;
+		value = sum2 / count - double(mean[d]) * mean[d];
+		scale[d] = (value > 0) ? 1 / sqrt(value) : 1;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		normalize(vectors + (size_t) i * dim,
+			  points + (size_t) i * stride);
+		order[i] = i;
+	}
+
+	/* Top levels serially, until there are enough subtrees */
+	job.node = 0;
+	job.begin = 0;
+	job.end = count;
+	jobs.push_back(job);
+	target = pool ? 4 * pool->size() : 0;
+	while (jobs.size() < target) {
+		split.clear();
+		for (unsigned int i = 0; i < jobs.size(); ++i) {
+			job = jobs[i];
+			middle = split_node(job.node, job.begin, job.end,
+					    points, order);
+			if (middle < 0)
+				continue;
+			job.node = jobs[i].node + 1;
+			job.end = middle;
+			split.push_back(job);
+			job.node = nodes[jobs[i].node].right;
+			job.begin = middle;
+			job.end = jobs[i].end;
+			split.push_back(job);
+		}
+		if (split.empty()) {
+			jobs.clear();
+			break;
+		}
+		jobs.swap(split);
+	}
+
+	shared.tree = this;
+	shared.jobs = &jobs;
+	shared.points = points;
+	shared.order = order;
+	if (pool && jobs.size())
+		pool->run(build_task, &shared, jobs.size());
+	else
+		for (unsigned int i = 0; i < jobs.size(); ++i)
+			build_task(i, &shared);
+
+	/* Points in leaf order, so leaves are contiguous */
+	data = new float[(size_t) count * stride];
+	ids = order;
+	order = NULL;
+	if (!data)
+		goto exit;
+	for (int i = 0; i < count; ++i)
+		memcpy(data + (size_t) i * stride,
+		       points + (size_t) ids[i] * stride,
+		       stride * sizeof(float));
+
+	result = true;
+
+exit:
+	if (points)
+		delete [] points;
+	if (order)
+		delete [] order;
+	if (!result)
+		clear();
+
+	return result;
+}
+
+
+/** Searches a subtree.
+ *
+ * @param nodes Tree nodes.
+ * @param data Stored points.
+ * @param stride Floats per point.
+ * @param node Node index.
+ * @param query Normalized query.
+ * @param k Number of neighbours.
+ * @param best Candidates heap.
+ */
+static void search_node(const kd_node *nodes, const float *data, int stride,
+			int node, const float *query, unsigned int k,
+			neighbour_heap &best)
+{
+	const kd_node &entry = nodes[node];
+	float diff, dist;
+	int near, far;
+
+	if (entry.dim < 0) {
+		for (int i = entry.begin; i < entry.end; ++i) {
+			dist = distance2(query, data + (size_t) i * stride,
+					 stride);
+			if (best.size() < k) {
+				best.push(neighbour(dist, i));
+			} else if (dist < best.top().first) {
+				best.pop();
+				best.push(neighbour(dist, i));
+			}
+		}
+		return;
+	}
+
+	diff = query[entry.dim] - entry.split;
+	near = (diff < 0) ? node + 1 : entry.right;
+	far = (diff < 0) ? entry.right : node + 1;
+
+	search_node(nodes, data, stride, near, query, k, best);
+	if ((best.size() < k) || (diff * diff < best.top().first))
+		search_node(nodes, data, stride, far, query, k, best);
+}
+
+
+int kd_tree::search(const float *query, int k, int *result_ids,
+		    float *distances) const
+{
+	neighbour_heap best;
+	float *normal = NULL;
+	int found = 0;
+
+	for (int i = 0; i < k; ++i) {
+		result_ids[i] = -1;
+		distances[i] = 0;
+	}
+
+	if ((!count) || (k < 1))
+		return 0;
+
+	normal = new float[stride];
+	normalize(query, normal);
+	search_node(nodes, data, stride, 0, normal, k, best);
+	delete [] normal;
+
+	/* Heap gives worst first */
+	found = best.size();
+	for (int i = found - 1; i >= 0; --i) {
+		result_ids[i] = ids[best.top().second];
+		distances[i] = sqrt(best.top().first);
+		best.pop();
+	}
+
+	return found;
+}
+
+
+void kd_tree::search_task(int index, void *param)
+{
+	search_data *shared = (search_data *) param;
+	int k = shared->k;
+
+	shared->tree->search(shared->queries +
+			     (size_t) index * shared->tree->dim, k,
+			     shared->ids + (size_t) index * k,
+			     shared->distances + (size_t) index * k);
+}
+
+
+void kd_tree::search(const float *queries, int size, int k, int *result_ids,
+		     float *distances, work_pool &pool) const
+{
+	search_data shared;
+
+	shared.tree = this;
+	shared.queries = queries;
+	shared.k = k;
+	shared.ids = result_ids;
+	shared.distances = distances;
+
+	pool.run(search_task, &shared, size);
+}
+
+
+bool kd_tree::save(const char *filename) const
+{
+	kdtree_header header;
+	FILE *fout = NULL;
+	bool result = false;
+
+	if (!count)
+		return false;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kdtree_magic, sizeof(header.magic));
+	header.version = kdtree_version;
+	header.dim = dim;
+	header.stride = stride;
+	header.count = count;
+	header.leaf_size = leaf_size;
+	header.node_count = node_count;
+
+	if (!(fout = fopen(filename, "wb")))
+		return false;
+
+	fwrite(&header, sizeof(header), 1, fout);
+	fwrite(mean, sizeof(float), dim, fout);
+	fwrite(scale, sizeof(float), dim, fout);
+	fwrite(nodes, sizeof(kd_node), node_count, fout);
+	fwrite(ids, sizeof(int), count, fout);
+	fwrite(data, sizeof(float), (size_t) count * stride, fout);
+
+	result = !ferror(fout);
+	if (fclose(fout))
+		result = false;
+
+	return result;
+}
+
+
+bool kd_tree::load(const char *filename)
+{
+	kdtree_header header;
+	FILE *fin = NULL;
+	size_t points;
+	bool result = false;
+
+	clear();
+	if (!(fin = fopen(filename, "rb")))
+		return false;
+
+	if ((fread(&header, sizeof(header), 1, fin) != 1) ||
+	    memcmp(header.magic, kdtree_magic, sizeof(header.magic)) ||
+	    (header.version != kdtree_version) || (header.dim < 1) ||
+	    (header.stride != vector_stride(header.dim)) ||
+	    (header.count < 1) || (header.leaf_size < 1))
+		goto exit;
+
+	dim = header.dim;
+	stride = header.stride;
+	count = header.count;
+	leaf_size = header.leaf_size;
+	node_count = subtree_nodes(count);
+	if (node_count != header.node_count)
+		goto exit;
+
+	points = (size_t) count * stride;
+	mean = new float[dim];
+	scale = new float[dim];
+	nodes = new kd_node[node_count];
+	ids = new int[count];
+	data = new float[points];
+	if ((!mean) || (!scale) || (!nodes) || (!ids) || (!data))
+		goto exit;
+
+	if ((fread(mean, sizeof(float), dim, fin) != (size_t) dim) ||
+	    (fread(scale, sizeof(float), dim, fin) != (size_t) dim) ||
+	    (fread(nodes, sizeof(kd_node), node_count, fin) !=
+	     (size_t) node_count) ||
+	    (fread(ids, sizeof(int), count, fin) != (size_t) count) ||
+	    (fread(data, sizeof(float), points, fin) != points))
+		goto exit;
+
+	/* Nodes are trusted by search, check them once */
+	for (int i = 0; i < node_count; ++i)
+		if ((nodes[i].begin < 0) || (nodes[i].end > count) ||
+		    (nodes[i].begin > nodes[i].end) ||
+		    (nodes[i].dim >= dim) ||
+		    ((nodes[i].dim >= 0) && ((nodes[i].right <= i) ||
+					     (nodes[i].right >= node_count) ||
+					     (i + 1 >= node_count))))
+			goto exit;
+
+	result = true;
+
+exit:
+	fclose(fin);
+	if (!result)
+		clear();
+
+	return result;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file   kdtree.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Exact k nearest neighbour search of shape descriptor vectors.
+ *
+ * Descriptors have very different ranges (area is thousands of pixels,
+ * ratio is about 1), so each dimension is normalized to zero mean and
+ * unit variance before building the tree and before each query.
+ *
+ * KD-tree splits at median of the dimension with biggest spread, so its
+ * shape depends only on number of points: node 'i' with 'm' points has
+ * left child at i + 1 and right child at i + 1 + nodes(m / 2). Subtrees
+ * are built by \ref work_pool tasks straight into the node vector.
+ * Points are stored in leaf order, leaves are scanned with SSE.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _KDTREE_H_
+#define _KDTREE_H_
+
+#include "pool.h"
+
+/** File signature */
+const char kdtree_magic[8] = { 'C', 'N', 'T', 'K', 'D', 'T', 'R', 'E' };
+/** Format version */
+const int kdtree_version = 1;
+
+
+/** \brief Tree node, a leaf when 'dim' is negative. */
+struct kd_node {
+	/// First point (in leaf order).
+	int begin;
+	/// One past last point.
+	int end;
+	/// Split dimension, -1 for leaves.
+	int dim;
+	/// Index of right child (left child is next node).
+	int right;
+	/// Split value, left points <= split <= right points.
+	float split;
+};
+
+
+/** \brief KD-tree of descriptor vectors.
+ *
+ * Example of use:
+ *
+ * kd_tree tree;
+ * tree.build(vectors, count, descriptor_dims, &pool);
+ * tree.search(query, 10, ids, distances);
+ * tree.save("corpus.kdt");
+ *
+ * Ids are vector positions given to \ref build, distances are
+ * euclidean in normalized space.
+ */
+class kd_tree {
+protected:
+	/** Number of dimensions */
+	int dim;
+	/** Floats per stored vector (dim rounded up to 4) */
+	int stride;
+	/** Number of points */
+	int count;
+	/** Maximum points per leaf */
+	int leaf_size;
+	/** Number of nodes */
+	int node_count;
+	/** Mean of each dimension */
+	float *mean;
+	/** Inverse standard deviation of each dimension */
+	float *scale;
+	/** Normalized points in leaf order, 'stride' floats each */
+	float *data;
+	/** Original index of each stored point */
+	int *ids;
+	/** Nodes, root is node 0 */
+	kd_node *nodes;
+
+	/** Number of nodes of a subtree.
+	 *
+	 * @param size Number of points.
+	 *
+	 * @return Node count.
+	 */
+	int subtree_nodes(int size) const;
+
+	/** Splits a node, fills up its entry.
+	 *
+	 * @param node Node index.
+	 * @param begin First point.
+	 * @param end One past last point.
+	 * @param points Normalized points (original order).
+	 * @param order Point indexes, reordered in range.
+	 *
+	 * @return Index of first right point, or -1 if node is a leaf.
+	 */
+	int split_node(int node, int begin, int end, const float *points,
+		       int *order);
+
+	/** Builds a subtree serially.
+	 *
+	 * @param node Node index.
+	 * @param begin First point.
+	 * @param end One past last point.
+	 * @param points Normalized points.
+	 * @param order Point indexes.
+	 */
+	void build_subtree(int node, int begin, int end, const float *points,
+			   int *order);
+
+	/** Normalizes a vector.
+	 *
+	 * @param vector Raw vector with 'dim' elements.
+	 * @param result Vector with 'stride' elements (padding zeroed).
+	 */
+	void normalize(const float *vector, float *result) const;
+
+	/** Frees up everything. */
+	void clear(void);
+
+	/** Task: builds one subtree, see \ref work_pool. */
+	static void build_task(int index, void *param);
+
+	/** Task: runs one query of a batch, see \ref work_pool. */
+	static void search_task(int index, void *param);
+
+private:
+	/// Non copyable (it owns its vectors).
+	kd_tree(const kd_tree &);
+	/// Non copyable (it owns its vectors).
+	kd_tree &operator=(const kd_tree &);
+
+public:
+	/** Creates an empty tree. */
+	kd_tree(void);
+
+	/** Destructor, frees up vectors. */
+	~kd_tree(void);
+
+	/** Builds tree, previous content is released.
+	 *
+	 * @param vectors Points, 'size' vectors of 'dimensions' floats.
+	 * @param size Number of points.
+	 * @param dimensions Number of dimensions.
+	 * @param pool Thread pool that builds subtrees (can be NULL).
+	 * @param leaf Maximum number of points in a leaf.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool build(const float *vectors, int size, int dimensions,
+		   work_pool *pool = NULL, int leaf = 16);
+
+	/** Finds k nearest neighbours of a point.
+	 *
+	 * @param query Raw vector with 'dimensions' floats.
+	 * @param k Number of neighbours.
+	 * @param result_ids Vector that will hold k ids, nearest first.
+	 * @param distances Vector that will hold k distances.
+	 *
+	 * @return Number of neighbours found (k or less, for small trees),
+	 * remaining slots get id -1.
+	 */
+	int search(const float *query, int k, int *result_ids,
+		   float *distances) const;
+
+	/** Finds k nearest neighbours of many points.
+	 *
+	 * @param queries 'size' raw vectors.
+	 * @param size Number of queries.
+	 * @param k Number of neighbours.
+	 * @param result_ids Vector with size * k elements, see \ref search.
+	 * @param distances Vector with size * k elements.
+	 * @param pool Thread pool that runs queries.
+	 */
+	void search(const float *queries, int size, int k, int *result_ids,
+		    float *distances, work_pool &pool) const;
+
+	/** Saves tree to a file.
+	 *
+	 * @param filename File name.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool save(const char *filename) const;
+
+	/** Loads a tree saved with \ref save, previous content is released.
+	 *
+	 * @param filename File name.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool load(const char *filename);
+
+	/** Number of points. */
+	int size(void) const {
+		return count;
+	}
+
+	/** Number of dimensions. */
+	int dimensions(void) const {
+		return dim;
+	}
+};
+
+#endif
@@ -0,0 +1,585 @@
+/** @file
+ *
+ * K-means clustering of shape descriptor vectors.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "kmeans.h"
+#include "distance.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+
+/** Points per assignment task */
+static const int chunk_size = 1024;
+
+
+/** Shared data of assignment and seeding tasks */
+struct chunk_data {
+	/// Normalized points.
+	const float *points;
+	/// Number of points.
+	int size;
+	/// Floats per point.
+	int stride;
+	/// Centers.
+	const float *centers;
+	/// Number of centers.
+	int k;
+	/// Cluster of each point (assignment).
+	int *labels;
+	/// Per chunk sums of each cluster (k * stride), can be NULL.
+	double *sums;
+	/// Per chunk points of each cluster (k), can be NULL.
+	long long *counts;
+	/// Per chunk changed labels.
+	int *changed;
+	/// Per chunk cost (sum of squared distances).
+	double *cost;
+	/// Squared distance to nearest seed (seeding).
+	float *nearest;
+};
+
+
+/** Runs tasks in a pool, or in caller thread if there is no pool. */
+static void run_tasks(work_pool *pool, task_function function, void *data,
+		      int count)
+{
+	if (pool)
+		pool->run(function, data, count);
+	else
+		for (int i = 0; i < count; ++i)
+			function(i, data);
+}
+
+
+/** Number of chunks of a point vector. */
+static int chunk_count(int size)
+{
+	return (size + chunk_size - 1) / chunk_size;
+}
+
+
+/** Task: assigns a chunk of points to nearest centers, summing them up
+ * per cluster when sums are required.
+ */
+static void assign_task(int index, void *param)
+{
+	chunk_data *shared = (chunk_data *) param;
+	int begin = index * chunk_size;
+	int end = min(begin + chunk_size, shared->size);
+	int stride = shared->stride, k = shared->k, c, changed = 0;
+	double *sums = NULL, cost = 0;
+	long long *counts = NULL;
+	const float *point;
+	float dist;
+
+	if (shared->sums) {
+		sums = shared->sums + (size_t) index * k * stride;
+		counts = shared->counts + (size_t) index * k;
+		memset(sums, 0, k * stride * sizeof(double));
+		memset(counts, 0, k * sizeof(long long));
+	}
+
+	for (int i = begin; i < end; ++i) {
+		point = shared->points + (size_t) i * stride;
+		c = nearest(point, shared->centers, k, stride, &dist);
+		if (shared->labels[i] != c) {
+			shared->labels[i] = c;
+			++changed;
+		}
+		cost += dist;
+		if (sums) {
+			for (int d = 0; d < stride; ++d)
+				sums[c * stride + d] += point[d];
+			++counts[c];
+		}
+	}
+
+	shared->changed[index] = changed;
+	shared->cost[index] = cost;
+}
+
+
+/** Task: updates distance of a chunk of points to nearest seed, given
+ * the newest seed (first center in 'centers').
+ */
+static void seed_task(int index, void *param)
+{
+	chunk_data *shared = (chunk_data *) param;
+	int begin = index * chunk_size;
+	int end = min(begin + chunk_size, shared->size);
+	int stride = shared->stride;
+	double total = 0;
+	float dist;
+
+	for (int i = begin; i < end; ++i) {
+		dist = distance2(shared->points + (size_t) i * stride,
+				 shared->centers, stride);
+		if (dist < shared->nearest[i])
+			shared->nearest[i] = dist;
+		total += shared->nearest[i];
+	}
+
+	shared->cost[index] = total;
+}
+
+
+kmeans::kmeans(int clusters, int dimensions, unsigned int random_seed):
+	k(clusters), dim(dimensions), stride(vector_stride(dimensions)),
+	seed(random_seed), scaled(false), seeded(false),
+	mean(new float[dimensions]), scale(new float[dimensions]),
+	centers(new float[clusters * vector_stride(dimensions)]),
+	counts(new long long[clusters])
+{
+	memset(centers, 0, k * stride * sizeof(float));
+	memset(counts, 0, k * sizeof(long long));
+}
+
+
+kmeans::~kmeans(void)
+{
+	delete [] mean;
+	delete [] scale;
+	delete [] centers;
+	delete [] counts;
+}
+
+
+void kmeans::set_scale(const double *sum, const double *sum2,
+		       long long size)
+{
+	double average, variance;
+
+	for (int d = 0; d < dim; ++d) {
+		average = sum[d] / size;
+		variance = sum2[d] / size - average * average;
+		mean[d] = average;
+		scale[d] = (variance > 0) ? 1 / sqrt(variance) : 1;
+	}
+
+	scaled = true;
+}
+
+
+float *kmeans::normalize(const float *vectors, int size) const
+{
+	float *points = new float[(size_t) size * stride], *point;
+	const float *raw;
+	int d;
+
+	if (!points)
+		return NULL;
+
+	for (int i = 0; i < size; ++i) {
+		raw = vectors + (size_t) i * dim;
+		point = points + (size_t) i * stride;
+		for (d = 0; d < dim; ++d)
+			point[d] = (raw[d] - mean[d]) * scale[d];
+		for (; d < stride; ++d)
+			point[d] = 0;
+	}
+
+	return points;
+}
+
+
+void kmeans::seed_centers(const float *points, int size, work_pool *pool)
+{
+	float *nearest = new float[size];
+	int chunks = chunk_count(size), chunk, pick, end;
+	double *totals = new double[chunks], total, draw;
+	chunk_data shared;
+
+	memset(&shared, 0, sizeof(shared));
+	shared.points = points;
+	shared.size = size;
+	shared.stride = stride;
+	shared.cost = totals;
+	shared.nearest = nearest;
+	for (int i = 0; i < size; ++i)
+		nearest[i] = FLT_MAX;
+
+	pick = rand_r(&seed) % size;
+	memcpy(centers, points + (size_t) pick * stride,
+	       stride * sizeof(float));
+
+	for (int c = 1; c < k; ++c) {
+		shared.centers = centers + (c - 1) * stride;
+		run_tasks(pool, seed_task, &shared, chunks);
+
+		total = 0;
+		for (int i = 0; i < chunks; ++i)
+			total += totals[i];
+
+		/* Draw proportional to squared distance: chunk, then point */
+		draw = total * (rand_r(&seed) / (RAND_MAX + 1.0));
+		if (total <= 0) {
+			pick = rand_r(&seed) % size;
+		} else {
+			for (chunk = 0; chunk < chunks - 1; ++chunk) {
+				if (draw < totals[chunk])
+					break;
+				draw -= totals[chunk];
+			}
+			pick = chunk * chunk_size;
+			end = min(pick + chunk_size, size);
+			for (; pick < end - 1; ++pick) {
+				if (draw < nearest[pick])
+					break;
+				draw -= nearest[pick];
+			}
+		}
+
+		memcpy(centers + c * stride, points + (size_t) pick * stride,
+		       stride * sizeof(float));
+	}
+
+	seeded = true;
+
+	delete [] nearest;
+	delete [] totals;
+}
+
+
+int kmeans::fit(const float *vectors, int size, work_pool *pool,
+		int iterations)
+{
+	double *sum = NULL, *sum2 = NULL, value;
+	float *points = NULL, *farthest;
+	int *labels = NULL, *changed = NULL, chunks, moved, iteration = -1;
+	double *sums = NULL, *costs = NULL, far;
+	long long *chunk_counts = NULL;
+	chunk_data shared;
+
+	scaled = seeded = false;
+	if ((!vectors) || (size < k) || (k < 1))
+		return -1;
+
+	sum = new double[dim];
+	sum2 = new double[dim];
+	for (int d = 0; d < dim; ++d) {
+		sum[d] = sum2[d] = 0;
+		for (int i = 0; i < size; ++i) {
+			value = vectors[(size_t) i * dim + d];
+			sum[d] += value;
+			sum2[d] += value * value;
+		}
+	}
+	set_scale(sum, sum2, size);
+
+	if (!(points = normalize(vectors, size)))
+		goto exit;
+	seed_centers(points, size, pool);
+
+	chunks = chunk_count(size);
+	labels = new int[size];
+	changed = new int[chunks];
+	costs = new double[chunks];
+	sums = new double[(size_t) chunks * k * stride];
+	chunk_counts = new long long[(size_t) chunks * k];
+	for (int i = 0; i < size; ++i)
+		labels[i] = -1;
+
+	memset(&shared, 0, sizeof(shared));
+	shared.points = points;
+	shared.size = size;
+	shared.stride = stride;
+	shared.centers = centers;
+	shared.k = k;
+	shared.labels = labels;
+	shared.sums = sums;
+	shared.counts = chunk_counts;
+	shared.changed = changed;
+	shared.cost = costs;
+
+	for (iteration = 1; iteration <= iterations; ++iteration) {
+		run_tasks(pool, assign_task, &shared, chunks);
+
+		/* Merge chunk sums */
+		moved = 0;
+		memset(counts, 0, k * sizeof(long long));
+		for (int i = 0; i < chunks; ++i) {
+			moved += changed[i];
+			for (int c = 0; c < k; ++c)
+				counts[c] += chunk_counts[i * k + c];
+		}
+		if (!moved)
+			break;
+
+		for (int c = 0; c < k; ++c) {
+			if (!counts[c])
+				continue;
+			for (int d = 0; d < stride; ++d) {
+				value = 0;
+				for (int i = 0; i < chunks; ++i)
+					value += sums[((size_t) i * k + c) *
+						      stride + d];
+				centers[c * stride + d] = value / counts[c];
+			}
+		}
+
+		/* Empty cluster takes the point farthest from its center */
+		for (int c = 0; c < k; ++c) {
+			if (counts[c])
+				continue;
+			farthest = points;
+			far = -1;
+			for (int i = 0; i < size; ++i) {
+				value = distance2(points + (size_t) i * stride,
+						  centers + labels[i] * stride,
+						  stride);
+				if (value > far) {
+					far = value;
+					farthest = points + (size_t) i * stride;
+				}
+			}
+			memcpy(centers + c * stride, farthest,
+			       stride * sizeof(float));
+		}
+	}
+
+	if (iteration > iterations)
+		iteration = iterations;
+
+exit:
+	delete [] sum;
+	delete [] sum2;
+	if (points)
+		delete [] points;
+	if (labels)
+		delete [] labels;
+	if (changed)
+		delete [] changed;
+	if (costs)
+		delete [] costs;
+	if (sums)
+		delete [] sums;
+	if (chunk_counts)
+		delete [] chunk_counts;
+
+	return iteration;
+}
+
+
+void kmeans::update_batch(const float *points, int size, work_pool *pool)
+{
+	int chunks = chunk_count(size), c;
+	int *labels = new int[size], *changed = new int[chunks];
+	double *costs = new double[chunks];
+	const float *point;
+	float rate, *center;
+	chunk_data shared;
+
+	memset(&shared, 0, sizeof(shared));
+	shared.points = points;
+	shared.size = size;
+	shared.stride = stride;
+	shared.centers = centers;
+	shared.k = k;
+	shared.labels = labels;
+	shared.changed = changed;
+	shared.cost = costs;
+	for (int i = 0; i < size; ++i)
+		labels[i] = -1;
+
+	run_tasks(pool, assign_task, &shared, chunks);
+
+	/* Per center learning rate, decreasing with points seen */
+	for (int i = 0; i < size; ++i) {
+		c = labels[i];
+		point = points + (size_t) i * stride;
+		center = centers + c * stride;
+		rate = 1.0f / ++counts[c];
+		for (int d = 0; d < stride; ++d)
+			center[d] += rate * (point[d] - center[d]);
+	}
+
+	delete [] labels;
+	delete [] changed;
+	delete [] costs;
+}
+
+
+bool kmeans::partial_fit(const float *vectors, int size, work_pool *pool)
+{
+	double *sum, *sum2, value;
+	float *points;
+
+	if ((!vectors) || (size < 1) || (k < 1))
+		return false;
+	if ((!seeded) && (size < k))
+		return false;
+
+	if (!scaled) {
+		sum = new double[dim];
+		sum2 = new double[dim];
+		for (int d = 0; d < dim; ++d) {
+			sum[d] = sum2[d] = 0;
+			for (int i = 0; i < size; ++i) {
+				value = vectors[(size_t) i * dim + d];
+				sum[d] += value;
+				sum2[d] += value * value;
+			}
+		}
+		set_scale(sum, sum2, size);
+		delete [] sum;
+		delete [] sum2;
+	}
+
+	if (!(points = normalize(vectors, size)))
+		return false;
+
+	if (!seeded) {
+		seed_centers(points, size, pool);
+		memset(counts, 0, k * sizeof(long long));
+	}
+	update_batch(points, size, pool);
+
+	delete [] points;
+
+	return true;
+}
+
+
+bool kmeans::fit(const descriptor_db &db, work_pool *pool, int batch,
+		 int passes)
+{
+	vector<double> sum(dim, 0), sum2(dim, 0);
+	vector<float> vectors;
+	const descriptor_record *records;
+	int filled = 0;
+
+	scaled = seeded = false;
+	if ((dim != descriptor_dims) || (db.size() < k) || (k < 1))
+		return false;
+
+	/* Normalization from whole database, then mini-batches */
+	batch = max(batch, k);
+	vectors.resize((size_t) batch * dim);
+	for (int s = 0; s < db.segments(); ++s) {
+		records = db.records(s);
+		for (int i = 0; i < db.segment(s).count; ++i) {
+			descriptor_vector(records[i], &vectors[0]);
+			for (int d = 0; d < dim; ++d) {
+				sum[d] += vectors[d];
+				sum2[d] += double(vectors[d]) * vectors[d];
+			}
+		}
+	}
+	set_scale(&sum[0], &sum2[0], db.size());
+
+	for (int pass = 0; pass < passes; ++pass)
+		for (int s = 0; s < db.segments(); ++s) {
+			records = db.records(s);
+			for (int i = 0; i < db.segment(s).count; ++i) {
+				descriptor_vector(records[i],
+						  &vectors[(size_t) filled * dim]);
+				if (++filled < batch)
+					continue;
+				if (!partial_fit(&vectors[0], filled, pool))
+					return false;
+				filled = 0;
+			}
+		}
+
+	/* Remainder, unless it is too small to seed centers */
+	if (filled && ((filled >= k) || seeded))
+		return partial_fit(&vectors[0], filled, pool);
+
+	return seeded;
+}
+
+
+int kmeans::assign(const float *vector, float *distance) const
+{
+	float *point, dist;
+	int result;
+
+	if (!seeded)
+		return -1;
+
+	if (!(point = normalize(vector, 1)))
+		return -1;
+	result = nearest(point, centers, k, stride, &dist);
+	delete [] point;
+
+	if (distance)
+		*distance = sqrt(dist);
+
+	return result;
+}
+
+
+double kmeans::assign(const float *vectors, int size, int *labels,
+		      work_pool *pool) const
+{
+	float *points;
+	int chunks = chunk_count(size), *changed;
+	double *costs, result = 0;
+	chunk_data shared;
+
+	if (!seeded)
+		return -1;
+	if (!(points = normalize(vectors, size)))
+		return -1;
+
+	changed = new int[chunks];
+	costs = new double[chunks];
+	memset(&shared, 0, sizeof(shared));
+	shared.points = points;
+	shared.size = size;
+	shared.stride = stride;
+	shared.centers = centers;
+	shared.k = k;
+	shared.labels = labels;
+	shared.changed = changed;
+	shared.cost = costs;
+	for (int i = 0; i < size; ++i)
+		labels[i] = -1;
+
+	run_tasks(pool, assign_task, &shared, chunks);
+	for (int i = 0; i < chunks; ++i)
+		result += costs[i];
+
+	delete [] points;
+	delete [] changed;
+	delete [] costs;
+
+	return result;
+}
+
+
+void kmeans::center(int c, float *vector) const
+{
+	for (int d = 0; d < dim; ++d)
+		vector[d] = centers[c * stride + d] / scale[d] + mean[d];
+}
@@ -0,0 +1,219 @@
+/**
+ * @file   kmeans.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  K-means clustering of shape descriptor vectors.
+ *
+ * Centers are seeded with k-means++ (each new center is drawn with
+ * probability proportional to squared distance from nearest center)
+ * and refined with Lloyd iterations. Assignment of points to centers
+ * is split in chunks run by a \ref work_pool, each chunk also sums up
+ * its points per cluster so update step only merges chunk sums.
+ *
+ * Corpora that don't fit in memory use mini-batch k-means: each batch
+ * is assigned to current centers, then every point moves its center
+ * by a learning rate of 1 / (points seen by that center). The database
+ * version streams records of a memory mapped \ref descriptor_db.
+ *
+ * As in \ref kd_tree, dimensions are normalized to zero mean and unit
+ * variance, centers are returned in raw (input) units.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _KMEANS_H_
+#define _KMEANS_H_
+
+#include "database.h"
+#include "pool.h"
+
+
+/** \brief K-means model.
+ *
+ * Example of use:
+ *
+ * kmeans model(8, descriptor_dims);
+ * model.fit(vectors, count, &pool);
+ * model.assign(vectors, count, labels, &pool);
+ *
+ * or, for a whole corpus:
+ *
+ * model.fit(db, &pool);
+ */
+class kmeans {
+protected:
+	/** Number of clusters */
+	int k;
+	/** Number of dimensions */
+	int dim;
+	/** Floats per normalized vector */
+	int stride;
+	/** Random generator state */
+	unsigned int seed;
+	/** Normalization was set */
+	bool scaled;
+	/** Centers were seeded */
+	bool seeded;
+	/** Mean of each dimension */
+	float *mean;
+	/** Inverse standard deviation of each dimension */
+	float *scale;
+	/** Normalized centers, 'stride' floats each */
+	float *centers;
+	/** Points of each cluster (points seen, in mini-batch mode) */
+	long long *counts;
+
+	/** Sets normalization from mean and variance of each dimension.
+	 *
+	 * @param sum Sum of values of each dimension.
+	 * @param sum2 Sum of squared values of each dimension.
+	 * @param size Number of points.
+	 */
+	void set_scale(const double *sum, const double *sum2, long long size);
+
+	/** Normalizes points.
+	 *
+	 * @param vectors 'size' raw vectors.
+	 * @param size Number of points.
+	 *
+	 * @return Normalized padded vectors (delete [] them), NULL if out
+	 * of memory.
+	 */
+	float *normalize(const float *vectors, int size) const;
+
+	/** Seeds centers with k-means++.
+	 *
+	 * @param points Normalized points.
+	 * @param size Number of points (at least k).
+	 * @param pool Thread pool (can be NULL).
+	 */
+	void seed_centers(const float *points, int size, work_pool *pool);
+
+	/** Mini-batch step on normalized points. */
+	void update_batch(const float *points, int size, work_pool *pool);
+
+private:
+	/// Non copyable (it owns its vectors).
+	kmeans(const kmeans &);
+	/// Non copyable (it owns its vectors).
+	kmeans &operator=(const kmeans &);
+
+public:
+	/** Creates a model.
+	 *
+	 * @param clusters Number of clusters.
+	 * @param dimensions Number of dimensions.
+	 * @param random_seed Seed of k-means++ draws, same seed and input
+	 * give same clusters.
+	 */
+	kmeans(int clusters, int dimensions, unsigned int random_seed = 1);
+
+	/** Destructor, frees up vectors. */
+	~kmeans(void);
+
+	/** Clusters points in memory, previous model is discarded.
+	 *
+	 * @param vectors 'size' raw vectors.
+	 * @param size Number of points (at least number of clusters).
+	 * @param pool Thread pool (can be NULL).
+	 * @param iterations Maximum number of Lloyd iterations.
+	 *
+	 * @return Number of iterations run, -1 in error.
+	 */
+	int fit(const float *vectors, int size, work_pool *pool = NULL,
+		int iterations = 100);
+
+	/** Mini-batch step. First batch sets normalization (unless set by
+	 * a database fit) and seeds centers.
+	 *
+	 * @param vectors 'size' raw vectors.
+	 * @param size Number of points (first batch needs at least number
+	 * of clusters).
+	 * @param pool Thread pool (can be NULL).
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool partial_fit(const float *vectors, int size, work_pool *pool = NULL);
+
+	/** Clusters all records of a database with mini-batches, previous
+	 * model is discarded. Normalization is taken from whole database.
+	 *
+	 * @param db Open database.
+	 * @param pool Thread pool (can be NULL).
+	 * @param batch Points per mini-batch.
+	 * @param passes Number of passes over database.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool fit(const descriptor_db &db, work_pool *pool = NULL,
+		 int batch = 4096, int passes = 1);
+
+	/** Nearest center of a point.
+	 *
+	 * @param vector Raw vector.
+	 * @param distance If not NULL, will hold distance in normalized
+	 * space.
+	 *
+	 * @return Cluster index, -1 if model is empty.
+	 */
+	int assign(const float *vector, float *distance = NULL) const;
+
+	/** Nearest center of many points.
+	 *
+	 * @param vectors 'size' raw vectors.
+	 * @param size Number of points.
+	 * @param labels Vector that will hold cluster of each point.
+	 * @param pool Thread pool (can be NULL).
+	 *
+	 * @return Sum of squared distances (in normalized space), -1 if
+	 * model is empty.
+	 */
+	double assign(const float *vectors, int size, int *labels,
+		      work_pool *pool = NULL) const;
+
+	/** Center of a cluster, in raw units.
+	 *
+	 * @param c Cluster index.
+	 * @param vector Vector that will hold 'dimensions' floats.
+	 */
+	void center(int c, float *vector) const;
+
+	/** Number of points of a cluster (points seen, in mini-batch mode). */
+	long long size(int c) const {
+		return counts[c];
+	}
+
+	/** Number of clusters. */
+	int clusters(void) const {
+		return k;
+	}
+
+	/** Number of dimensions. */
+	int dimensions(void) const {
+		return dim;
+	}
+
+	/** Centers were computed. */
+	bool ready(void) const {
+		return seeded;
+	}
+};
+
+#endif
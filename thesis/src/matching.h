@@ -0,0 +1,361 @@
+/**
+ * @file   matching.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Curvature signature matching, compares shapes by its
+ * curvature independent of contour start point.
+ *
+ * Two curvature signatures are resampled to a common length and
+ * aligned by circular cross-correlation, which is calculated with
+ * fourier transform (see \ref transform and \ref inverse) in
+ * O(N log N) instead of O(N^2) of trying every start point.
+ *
+ * Since the squared distance of two aligned signatures is bounded
+ * by their bending energies (Cauchy-Schwarz), we use \ref energy to
+ * discard templates before doing any transform at all.
+ *
+ * \todo
+ * - Handle mirrored shapes (reverse contour direction).
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _MATCHING_H
+#define _MATCHING_H
+
+#include <algorithm>
+#include <math.h>
+#include "fourier.h"
+
+/** Matching error */
+const double match_error = -1.0;
+
+
+/** \brief Curvature signature, ready to be compared with others.
+ *
+ * Holds resampled curvature, its spectrum and energy, so a template
+ * signature is transformed only once no matter how many shapes
+ * are compared against it.
+ */
+struct signature {
+	/// Resampled curvature.
+	double *samples;
+	/// Fourier transform of samples.
+	mcomplex<double> *spectrum;
+	/// Number of samples.
+	int length;
+	/// Bending energy of samples, see \ref energy.
+	double s_energy;
+
+	/// Default constructor, zero's struct fields.
+	signature(void): samples(NULL), spectrum(NULL), length(0),
+			 s_energy(energy_error)
+		{}
+
+	/// Destructor, frees up samples and spectrum.
+	~signature(void) {
+		if (samples)
+			delete [] samples;
+		if (spectrum)
+			delete [] spectrum;
+	}
+
+private:
+	/// Non copyable (it owns its vectors).
+	signature(const signature &);
+	/// Non copyable (it owns its vectors).
+	signature &operator=(const signature &);
+};
+
+
+/** Resamples a closed curve signal (e.g. curvature) to a new length.
+ *
+ * Uses linear interpolation, wrapping around the end of signal since
+ * the contour is closed.
+ *
+ * @param signal Signal vector, accessable with signal[i].
+ *
+ * @param length Signal vector length.
+ *
+ * @param target Length of resampled signal.
+ *
+ * @return A new vector with resampled signal or NULL on error.
+ */
+template <typename TYPE>
+double *resample(TYPE signal, int length, int target)
+{
+	double *result = NULL;
+	double step, position, frac;
+	int i, index;
+
+	if ((length < 1) || (target < 1))
+		goto exit;
+
+	result = new double[target];
+	if (!result)
+		goto exit;
+
+	step = double(length) / target;
+	for (i = 0; i < target; ++i) {
+		position = i * step;
+		index = int(position);
+		frac = position - index;
+		result[i] = (1.0 - frac) * signal[index] +
+			frac * signal[(index + 1) % length];
+	}
+
+exit:
+	return result;
+}
+
+
+/** Fills up a signature with a given curvature.
+ *
+ * @param sig Signature object, previous content is released.
+ *
+ * @param curvature Contour curvature (see \ref contour_curvature).
+ *
+ * @param length Curvature vector length.
+ *
+ * @param target Common length of signatures to be compared.
+ *
+ * @param mutex A mutex to lock when doing fourier transform.
+ *
+ * @return true in success, false otherwise.
+ */
+template <typename TYPE>
+bool make_signature(signature &sig, TYPE curvature, int length, int target,
+		    pthread_mutex_t *mutex = NULL)
+{
+	mcomplex<double> *tmp = NULL;
+	bool result = false;
+
+	if (sig.samples)
+		delete [] sig.samples;
+	if (sig.spectrum)
+		delete [] sig.spectrum;
+	sig.spectrum = NULL;
+	sig.length = 0;
+	sig.s_energy = energy_error;
+
+	sig.samples = resample(curvature, length, target);
+	if (!sig.samples)
+		goto exit;
+
+	tmp = new mcomplex<double>[target];
+	sig.spectrum = new mcomplex<double>[target];
+	if ((!tmp) || (!sig.spectrum))
+		goto exit;
+
+	for (int i = 0; i < target; ++i)
+		tmp[i](sig.samples[i], 0);
+
+	if (mutex)
+		transform(tmp, target, sig.spectrum, mutex);
+	else
+		transform(tmp, target, sig.spectrum);
+
+	sig.length = target;
+	sig.s_energy = energy(sig.samples, target);
+	result = true;
+
+exit:
+	if (tmp)
+		delete [] tmp;
+
+	return result;
+}
+
+
+/** Tells if a signature was built (see \ref make_signature).
+ *
+ * @param sig A signature.
+ *
+ * @return true if it has samples and a valid energy, false otherwise.
+ */
+inline bool valid_signature(const signature &sig)
+{
+	return (sig.length > 0) && (sig.s_energy >= 0);
+}
+
+
+/** Cheap lower bound of distance between 2 signatures.
+ *
+ * Whatever the alignment, the mean squared difference of 2 signals
+ * can't be smaller than (sqrt(e1) - sqrt(e2))^2, where e1 and e2 are
+ * its energies.
+ *
+ * @param a A signature.
+ * @param b Other signature.
+ *
+ * @return Lower bound of \ref align_signatures distance.
+ */
+inline double signature_bound(const signature &a, const signature &b)
+{
+	double diff = sqrt(a.s_energy) - sqrt(b.s_energy);
+	return diff * diff;
+}
+
+
+/** Finds best circular alignment of 2 signatures.
+ *
+ * Calculates circular cross-correlation c(s) = sum(a(i + s) * b(i))
+ * as inverse transform of A * conj(B) and picks its maximum.
+ *
+ * @param a A signature.
+ *
+ * @param b Other signature, must have same length of first one.
+ *
+ * @param shift Pointer to variable that will hold the shift of 'a'
+ * which best matches 'b' (can be NULL).
+ *
+ * @param mutex A mutex to lock when doing fourier transform.
+ *
+ * @return Mean squared difference of aligned signatures or
+ * \ref match_error.
+ */
+inline double align_signatures(const signature &a, const signature &b,
+			       int *shift = NULL,
+			       pthread_mutex_t *mutex = NULL)
+{
+	double result = match_error, best;
+	mcomplex<double> *product = NULL, *corr = NULL;
+	int length = a.length, best_shift = 0;
+
+	if ((length < 1) || (length != b.length))
+		goto exit;
+
+	product = new mcomplex<double>[length];
+	corr = new mcomplex<double>[length];
+	if ((!product) || (!corr))
+		goto exit;
+
+	for (int i = 0; i < length; ++i) {
+		std::complex<double> tmp = a.spectrum[i] *
+			std::conj(b.spectrum[i]);
+		product[i](tmp.real(), tmp.imag());
+	}
+
+	if (mutex)
+		inverse(product, length, corr, mutex);
+	else
+		inverse(product, length, corr);
+
+	best = corr[0].real();
+	for (int i = 1; i < length; ++i)
+		if (corr[i].real() > best) {
+			best = corr[i].real();
+			best_shift = i;
+		}
+
+	/* Inverse is not normalized, so corr = length * sum(a * b) */
+	result = a.s_energy + b.s_energy -
+		2.0 * best / (double(length) * length);
+	if (result < 0)
+		result = 0;
+
+	if (shift)
+		*shift = best_shift;
+
+exit:
+	if (product)
+		delete [] product;
+	if (corr)
+		delete [] corr;
+
+	return result;
+}
+
+
+/** Finds the nearest template of a shape signature.
+ *
+ * Templates are visited in ascending order of \ref signature_bound and
+ * search stops when bound alone is worse than best distance found,
+ * so most templates never get transformed.
+ *
+ * @param query Signature of shape.
+ *
+ * @param templates Vector of template signatures (same length of query),
+ * templates whose \ref make_signature failed are skipped.
+ *
+ * @param count Number of templates.
+ *
+ * @param distance Pointer to variable that will hold distance to
+ * nearest template (can be NULL).
+ *
+ * @param shift Pointer to variable that will hold alignment of nearest
+ * template (can be NULL).
+ *
+ * @param mutex A mutex to lock when doing fourier transform.
+ *
+ * @return Index of nearest template or -1 in error case.
+ */
+inline int nearest_signature(const signature &query, signature *templates,
+			     int count, double *distance = NULL,
+			     int *shift = NULL, pthread_mutex_t *mutex = NULL)
+{
+	std::pair<double, int> *order = NULL;
+	double best = match_error, dist;
+	int result = -1, best_shift = 0, tmp_shift, valid = 0;
+
+	if ((!templates) || (count < 1) || (!valid_signature(query)))
+		goto exit;
+
+	order = new std::pair<double, int>[count];
+	if (!order)
+		goto exit;
+
+	/* Failed signatures have no energy (bound would be NaN, breaking
+	 * sort), they are left out.
+	 */
+	for (int i = 0; i < count; ++i)
+		if (valid_signature(templates[i]))
+			order[valid++] = std::make_pair(
+				signature_bound(query, templates[i]), i);
+	std::sort(order, order + valid);
+
+	for (int i = 0; i < valid; ++i) {
+		if ((result >= 0) && (order[i].first >= best))
+			break;
+
+		dist = align_signatures(templates[order[i].second], query,
+					&tmp_shift, mutex);
+		if (dist == match_error)
+			continue;
+
+		if ((result < 0) || (dist < best)) {
+			best = dist;
+			best_shift = tmp_shift;
+			result = order[i].second;
+		}
+	}
+
+	if (distance)
+		*distance = best;
+	if (shift)
+		*shift = best_shift;
+
+exit:
+	if (order)
+		delete [] order;
+
+	return result;
+}
+
+#endif
@@ -0,0 +1,251 @@
+/** @file
+ *
+ * Moment descriptors (raw, central, Hu and Zernike invariants).
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "moments.h"
+
+
+/** Binomial coefficients up to \ref moment_order */
+static const double binomial[moment_order + 1][moment_order + 1] = {
+	{ 1, 0, 0, 0 },
+	{ 1, 1, 0, 0 },
+	{ 1, 2, 1, 0 },
+	{ 1, 3, 3, 1 }
+};
+
+
+/** Raw moments relative to a reference point (Green's theorem).
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ * @param ox Reference point, x.
+ * @param oy Reference point, y.
+ * @param m Moment table that will hold results.
+ */
+static void relative_moments(const CvPoint *contour, int size, int ox,
+			     int oy, double m[][moment_order + 1])
+{
+	long long a00 = 0, a10 = 0, a01 = 0, a20 = 0, a11 = 0, a02 = 0;
+	long long xi, yi, xj, yj, cross;
+	double a30 = 0, a21 = 0, a12 = 0, a03 = 0;
+	double x0, y0, x1, y1, c;
+	int j;
+
+	for (int i = 0; i < size; ++i) {
+		j = (i + 1 < size) ? i + 1 : 0;
+		xi = contour[i].x - ox;
+		yi = contour[i].y - oy;
+		xj = contour[j].x - ox;
+		yj = contour[j].y - oy;
+
+		cross = xi * yj - xj * yi;
+		a00 += cross;
+		a10 += (xi + xj) * cross;
+		a01 += (yi + yj) * cross;
+		a20 += (xi * xi + xi * xj + xj * xj) * cross;
+		a11 += (2 * xi * yi + xi * yj + xj * yi + 2 * xj * yj) * cross;
+		a02 += (yi * yi + yi * yj + yj * yj) * cross;
+
+		x0 = double(xi);
+		y0 = double(yi);
+		x1 = double(xj);
+		y1 = double(yj);
+		c = double(cross);
+		a30 += (x0 * x0 * x0 + x0 * x0 * x1 + x0 * x1 * x1 +
+			x1 * x1 * x1) * c;
+		a03 += (y0 * y0 * y0 + y0 * y0 * y1 + y0 * y1 * y1 +
+			y1 * y1 * y1) * c;
+		a21 += (x0 * x0 * (3 * y0 + y1) + 2 * x0 * x1 * (y0 + y1) +
+			x1 * x1 * (y0 + 3 * y1)) * c;
+		a12 += (y0 * y0 * (3 * x0 + x1) + 2 * y0 * y1 * (x0 + x1) +
+			y1 * y1 * (x0 + 3 * x1)) * c;
+	}
+
+	m[0][0] = a00 / 2.0;
+	m[1][0] = a10 / 6.0;
+	m[0][1] = a01 / 6.0;
+	m[2][0] = a20 / 12.0;
+	m[1][1] = a11 / 24.0;
+	m[0][2] = a02 / 12.0;
+	m[3][0] = a30 / 20.0;
+	m[2][1] = a21 / 60.0;
+	m[1][2] = a12 / 60.0;
+	m[0][3] = a03 / 20.0;
+}
+
+
+/** Calculates Zernike moments (orders up to 3) from central moments.
+ *
+ * Low order Zernike polynomials are polynomials in x and y, so its
+ * moments are linear combinations of central moments. First order
+ * central moments are null, so is Z11.
+ *
+ * @param result Moments with central moments already calculated.
+ * @param radius Unit disk radius.
+ */
+static void zernike_moments(shape_moments &result, double radius)
+{
+	double r2 = radius * radius, r4 = r2 * r2, r5 = r4 * radius;
+	double re, im;
+
+	result.zernike[0] = result.mu[0][0] / (M_PI * r2);
+	result.zernike[1] = 0;
+	result.zernike[2] = fabs(3 / M_PI * (2 * (result.mu[2][0] +
+						 result.mu[0][2]) / r4 -
+					     result.mu[0][0] / r2));
+
+	re = result.mu[2][0] - result.mu[0][2];
+	im = 2 * result.mu[1][1];
+	result.zernike[3] = 3 / M_PI * sqrt(re * re + im * im) / r4;
+
+	re = result.mu[3][0] + result.mu[1][2];
+	im = result.mu[2][1] + result.mu[0][3];
+	result.zernike[4] = 12 / M_PI * sqrt(re * re + im * im) / r5;
+
+	re = result.mu[3][0] - 3 * result.mu[1][2];
+	im = 3 * result.mu[2][1] - result.mu[0][3];
+	result.zernike[5] = 4 / M_PI * sqrt(re * re + im * im) / r5;
+}
+
+
+bool contour_moments(const CvPoint *contour, int size, shape_moments &result,
+		     bool zernike)
+{
+	double rel[moment_order + 1][moment_order + 1] = { { 0 } };
+	double xc, yc, ox, oy, sum, radius, dist;
+	double n[moment_order + 1][moment_order + 1];
+	double t0, t1, t2, t3, t4;
+	int ref_x, ref_y;
+
+	result = shape_moments();
+	if ((!contour) || (size < 3))
+		return false;
+
+	ref_x = contour[0].x;
+	ref_y = contour[0].y;
+	relative_moments(contour, size, ref_x, ref_y, rel);
+
+	if (rel[0][0] == 0)
+		return false;
+
+	/* Clockwise contours give negative integrals */
+	if (rel[0][0] < 0)
+		for (int p = 0; p <= moment_order; ++p)
+			for (int q = 0; p + q <= moment_order; ++q)
+				rel[p][q] = -rel[p][q];
+
+	/* Raw moments, moving origin back from reference point */
+	ox = ref_x;
+	oy = ref_y;
+	for (int p = 0; p <= moment_order; ++p)
+		for (int q = 0; p + q <= moment_order; ++q) {
+			sum = 0;
+			for (int i = 0; i <= p; ++i)
+				for (int j = 0; j <= q; ++j)
+					sum += binomial[p][i] * binomial[q][j] *
+						pow(ox, p - i) * pow(oy, q - j) *
+						rel[i][j];
+			result.m[p][q] = sum;
+		}
+
+	/* Central moments, from relative ones (smaller numbers) */
+	xc = rel[1][0] / rel[0][0];
+	yc = rel[0][1] / rel[0][0];
+	result.mu[0][0] = rel[0][0];
+	result.mu[2][0] = rel[2][0] - xc * rel[1][0];
+	result.mu[1][1] = rel[1][1] - xc * rel[0][1];
+	result.mu[0][2] = rel[0][2] - yc * rel[0][1];
+	result.mu[3][0] = rel[3][0] - 3 * xc * rel[2][0] +
+		2 * xc * xc * rel[1][0];
+	result.mu[2][1] = rel[2][1] - 2 * xc * rel[1][1] - yc * rel[2][0] +
+		2 * xc * xc * rel[0][1];
+	result.mu[1][2] = rel[1][2] - 2 * yc * rel[1][1] - xc * rel[0][2] +
+		2 * yc * yc * rel[1][0];
+	result.mu[0][3] = rel[0][3] - 3 * yc * rel[0][2] +
+		2 * yc * yc * rel[0][1];
+
+	for (int p = 0; p <= moment_order; ++p)
+		for (int q = 0; p + q <= moment_order; ++q)
+			result.nu[p][q] = (p + q < 2) ? 0 :
+				result.mu[p][q] /
+				pow(result.mu[0][0], 1 + (p + q) / 2.0);
+	result.nu[0][0] = 1;
+
+	/* Hu invariants */
+	for (int p = 0; p <= moment_order; ++p)
+		for (int q = 0; q <= moment_order; ++q)
+			n[p][q] = result.nu[p][q];
+
+	t0 = n[3][0] + n[1][2];
+	t1 = n[2][1] + n[0][3];
+	t2 = n[3][0] - 3 * n[1][2];
+	t3 = 3 * n[2][1] - n[0][3];
+	t4 = n[2][0] - n[0][2];
+
+	result.hu[0] = n[2][0] + n[0][2];
+	result.hu[1] = t4 * t4 + 4 * n[1][1] * n[1][1];
+	result.hu[2] = t2 * t2 + t3 * t3;
+	result.hu[3] = t0 * t0 + t1 * t1;
+	result.hu[4] = t2 * t0 * (t0 * t0 - 3 * t1 * t1) +
+		t3 * t1 * (3 * t0 * t0 - t1 * t1);
+	result.hu[5] = t4 * (t0 * t0 - t1 * t1) + 4 * n[1][1] * t0 * t1;
+	result.hu[6] = t3 * t0 * (t0 * t0 - 3 * t1 * t1) -
+		t2 * t1 * (3 * t0 * t0 - t1 * t1);
+
+	if (zernike) {
+		xc += ref_x;
+		yc += ref_y;
+		radius = 0;
+		for (int i = 0; i < size; ++i) {
+			dist = norm(contour[i].x - xc, contour[i].y - yc);
+			if (dist > radius)
+				radius = dist;
+		}
+		zernike_moments(result, radius);
+	}
+
+	return true;
+}
+
+
+shape_moments *calc_moments(const contour_set &set, int *size, bool zernike)
+{
+	shape_moments *result = NULL;
+
+	*size = set.count;
+	result = new shape_moments[set.count];
+	if (!result)
+		goto exit;
+
+	for (int i = 0; i < set.count; ++i)
+		contour_moments(set.contour(i), set.length(i), result[i],
+				zernike);
+
+exit:
+	return result;
+}
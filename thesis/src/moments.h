@@ -0,0 +1,102 @@
+/**
+ * @file   moments.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Moment descriptors (raw, central, normalized, Hu invariants and
+ * low order Zernike) of a contour region.
+ *
+ * Region moments are calculated from contour points only, with Green's
+ * theorem: each polygon edge adds the moment of its triangle with
+ * origin. Coordinates are taken relative to a contour point, so sums
+ * stay small and central moments don't suffer from cancellation.
+ *
+ * For integer points, sums of orders 0 to 2 are done in 64 bit
+ * integers and are exact; order 3 sums grow too fast for 64 bits with
+ * big contours and are done in double.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _MOMENTS_H_
+#define _MOMENTS_H_
+
+#include "base.h"
+#include "contour.h"
+
+/** Maximum moment order */
+const int moment_order = 3;
+
+/** Number of Zernike moments (see \ref shape_moments) */
+const int zernike_count = 6;
+
+
+/** \brief Moments of one contour region.
+ *
+ * Moment tables are indexed by [p][q], only entries with p + q <= 3
+ * are valid. Region orientation (contour clockwise or not) doesn't
+ * matter, area (m[0][0]) is always positive.
+ */
+struct shape_moments {
+	/// Raw moments, integral of x^p * y^q.
+	double m[moment_order + 1][moment_order + 1];
+	/// Central moments (about region centroid).
+	double mu[moment_order + 1][moment_order + 1];
+	/// Scale normalized central moments, mu / m00^(1 + (p + q) / 2).
+	double nu[moment_order + 1][moment_order + 1];
+	/// Hu's 7 invariants (translation, scale and rotation).
+	double hu[7];
+	/// Zernike moment magnitudes |Z00|, |Z11|, |Z20|, |Z22|, |Z31|
+	/// and |Z33| (rotation invariant), only if requested.
+	double zernike[zernike_count];
+
+	/// Default constructor, zero's struct fields.
+	shape_moments(void): m(), mu(), nu(), hu(), zernike()
+		{}
+};
+
+
+/** Calculates moments of one contour region.
+ *
+ * @param contour Vector with contour points (a closed polygon).
+ * @param size Number of points.
+ * @param result Structure that will hold moments.
+ * @param zernike Calculate Zernike moments too, the unit disk is
+ * centered at region centroid with radius equal to maximum distance of
+ * contour points from it.
+ *
+ * @return true in success, false otherwise (i.e. contour has null area).
+ */
+bool contour_moments(const CvPoint *contour, int size, shape_moments &result,
+		     bool zernike = false);
+
+/** Calculates moments of each contour in a contour set.
+ *
+ * @param set Contour set.
+ * @param size Pointer to variable that will hold moments vector size.
+ * @param zernike Calculate Zernike moments too.
+ *
+ * @return A vector with moments of each contour (contours with null area
+ * get zeros) or NULL in error case (remember to free up this memory
+ * later).
+ */
+shape_moments *calc_moments(const contour_set &set, int *size,
+			    bool zernike = false);
+
+#endif
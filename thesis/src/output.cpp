@@ -29,146 +29,317 @@
 
 #include "output.h"
 #include "descriptors.h"
+#include "moments.h"
+#include "fourier.h"
+#include "archive.h"
 #include <fstream>
 #include <iostream>
 #include <string>
-//Class stringstream
-#include <sstream>
 using namespace std;
 
-/** Create a scilab program to handle exported text files with coordinates of
- * contours.
+//Names of descriptor files
+static const char file_centroid[] = "centroid.txt";
+static const char file_area[] = "area.txt";
+static const char file_ratio[] = "ratio_centroid.txt";
+static const char file_diam[] = "diameter.txt";
+static const char file_perimeter[] = "perimeter.txt";
+static const char file_energy[] = "energy.txt";
+static const char file_hu[] = "hu.txt";
+
+/** Create a scilab program to display contours stored in a contour
+ * archive (see archive.h).
  *
  *
- * @param n_contour Number of contours found in original image.
- * @param img_file_name Name of image file, is used to append name in contour
- *                     files (e.g.: 24esc.bmp_contour_10.txt)
+ * @param img_file_name Name of image file.
+ * @param archive_name Name of contour archive (written without delta
+ *                     encoding, so coordinates are read directly).
  */
-void sci_prog(int n_contour, string img_file_name)
+void sci_prog(string img_file_name, string archive_name)
 {
 
-	string filename, buffer;
-	typedef enum { IMG_NAME, STR_CLOS, LST_NXT,
-		       LST_END, CONTOUR_LIST, PRG_BULK } prog_step;
-
 	/* XXX: drop this file/functions or at least put this string in an
 	 * external file.
 	 */
-	const char* prog[] = {"img_name ='", "'", ",", ");", "contour_name= list(",
-			      "stacksize(13000000); \n \
+	const char prog[] = "stacksize(13000000); \n \
                          function D = showcontour() \n \
                          Img = imread(img_name); \n \
-                         n = size(contour_name); \n \
+                         fd = mopen(archive_name, 'rb'); \n \
+                         mseek(16, fd); \n \
+                         h = mget(2, 'i', fd); \n \
+                         width = h(1); \n \
+                         n = h(2); \n \
+                         mseek(32, fd); \n \
+                         t = mget(1, 'i', fd); \n \
+                         mseek(48, fd); \n \
+                         d = mget(1, 'i', fd); \n \
+                         mseek(t, fd); \n \
+                         o = mget(2 * (n + 1), 'i', fd); \n \
+                         o = o(1:2:$); \n \
+                         types = ['c', 's', '', 'i']; \n \
                          for i = 1:n, \n \
-                           A = read(contour_name(i), -1, 2); \n \
-                           [row, col] = size(A); \n \
-                           x = A(1:row, 1:1); \n \
-                           y = A(1:row, 2:2); \n \
+                           mseek(d + 2 * width * o(i), fd); \n \
+                           A = mget(2 * (o(i + 1) - o(i)), types(width), fd); \n \
+                           x = A(1:2:$)'; \n \
+                           y = A(2:2:$)'; \n \
                            xset(\"window\", i); \n \
                            imshow(unfollow(x, y, size(Img))) \n \
                          end; \n \
+                         mclose(fd); \n \
                          D = 1 \n \
-                         endfunction;" };
+                         endfunction;";
 
 	ofstream fout;
 	fout.open("plotter.sci");
 
-	fout << prog[IMG_NAME] << img_file_name << prog[STR_CLOS] << endl;
+	fout << "img_name ='" << img_file_name << "'" << '\n';
+	fout << "archive_name ='" << archive_name << "'" << '\n';
+	fout << prog << '\n';
+}
+
+//Write contours in an archive and the scilab code into a text file
+void print_contour(char *img_file_name, CvSeq *contours, bool mthreshold,
+		   float diam_thres)
+{
 
-	for (int i = 1; i <= n_contour; ++i) {
+	contour_set shapes, selected;
+	string filename = img_file_name;
+	int count = 0, k = 0, length;
+	const CvPoint *points;
+
+	filename += "_contours.cta";
+	if (!flatten_contours(contours, shapes))
+		return;
+
+	selected.offsets = new int[shapes.count + 1];
+	selected.points = new CvPoint[shapes.total > 0 ? shapes.total : 1];
+	if ((!selected.offsets) || (!selected.points))
+		return;
+
+	/* Keep contours above diameter threshold */
+	selected.offsets[0] = 0;
+	for (int i = 0; i < shapes.count; ++i) {
+		points = shapes.contour(i);
+		length = shapes.length(i);
+		if (mthreshold && (diameter(points, length) < diam_thres))
+			continue;
+
+		for (int j = 0; j < length; ++j)
+			selected.points[k++] = points[j];
+		selected.offsets[++count] = k;
+	}
+	selected.count = count;
+	selected.total = k;
 
-		stringstream i2s;
-		i2s << "_contour_" << i << ".txt";
-		filename = img_file_name; filename += i2s.str();
-		buffer += prog[STR_CLOS];
-		buffer += filename;
-		buffer += prog[STR_CLOS];
+	if (!write_archive(filename.c_str(), selected, false)) {
+		cout << "Failed to write " << filename << endl;
+		return;
+	}
+	cout << count << " contours written to " << filename << endl;
 
-		if (i < n_contour)
-			buffer += prog[LST_NXT];
-		else
-			buffer += prog[LST_END];
+	sci_prog(img_file_name, filename);
 
+}
+
+
+bool write_centroid(shape_features *features, int size, const char *filename,
+		    float diam)
+{
+	bool result = true;
+
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < size; ++k)
+			if (features[k].diameter >= diam)
+				fout << features[k].centroid.x << "     "
+				     << features[k].centroid.y << '\n';
+
+	}
+	catch(...) {
+		return false;
 	}
-	fout << prog[CONTOUR_LIST] << buffer << endl;
-	fout << prog[PRG_BULK] << endl;
+	return result;
 }
 
-//Write the scilab code into a text file
-//void print_contour4(string img_file_name, CvSeq *contours) {
-void print_contour(char *img_file_name, CvSeq *contours, bool mthreshold,
-		   float diam_thres)
+bool write_area(shape_features *features, int size, const char *filename,
+		float diam)
 {
+	bool result = true;
 
-	CvSeq* contourPtr = contours;
-	CvSeqReader reader;
-	int n_point = 0;
-	int c_contour = 0;
-	CvPoint p;
-	ofstream f_contour;
-	string filename;
-	float *diameters = NULL;
-	int d_size = 0;
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < size; ++k)
+			if (features[k].diameter >= diam)
+				fout << features[k].area << '\n';
 
-	if (mthreshold) {
-		diameters = calc_diam(contours, &d_size);
+	}
+	catch(...) {
+		return false;
+	}
+	return result;
+}
 
-		for (int i = 0; i < d_size; ++i)
-			if (diameters[i] >= diam_thres) {
 
-				cvStartReadSeq(contourPtr, &reader);
-				n_point = contourPtr->total;
+bool write_energy(shape_features *features, int size, const char *filename,
+		  float diam)
+{
+	bool result = true;
 
-				cout << n_point << endl;
-				++c_contour;
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < size; ++k) {
 
-				stringstream i2s;
-				i2s << "_contour_" << c_contour << ".txt";
-				filename = img_file_name; filename += i2s.str();
-				cout << filename << endl;
-				f_contour.open(filename.c_str());
+			if (features[k].diameter < diam)
+				continue;
 
-				for (int i = 0; i < n_point; ++i) {
-					CV_READ_SEQ_ELEM(p, reader);
-					//CV_REV_READ_SEQ_ELEM(p, reader);
-					f_contour << p.x << " " << p.y << endl;
-				}
+			///FIXME: Need an exception class!
+			if (features[k].energy == energy_error)
+				throw int(10);
 
-				f_contour.close();
-				contourPtr = contourPtr->h_next;
+			fout << features[k].energy << '\n';
+		}
 
-			}
-		delete [] diameters;
+	} catch (...) {
 
-	} else {
+		result = false;
 
-		for (; contourPtr != NULL; contourPtr = contourPtr->h_next) {
-			cvStartReadSeq(contourPtr, &reader);
-			n_point = contourPtr->total;
+	}
 
-			cout << n_point << endl;
-			++c_contour;
+	return result;
+}
 
-			stringstream i2s;
-			i2s << "_contour_" << c_contour << ".txt";
-			filename = img_file_name; filename += i2s.str();
-			cout << filename << endl;
-			f_contour.open(filename.c_str());
 
-			for (int i = 0; i < n_point; ++i) {
-				CV_READ_SEQ_ELEM(p, reader);
-				//CV_REV_READ_SEQ_ELEM(p, reader);
-				f_contour << p.x << " " << p.y << endl;
-			}
+bool write_perimeter(shape_features *features, int size, const char *filename,
+		     float diam)
+{
+	bool result = true;
 
-			f_contour.close();
+	try {
+		ofstream fout(filename);
 
-		}
+		for (int k = 0; k < size; ++k)
+			if (features[k].diameter >= diam)
+				fout << features[k].length << '\n';
 
+	}
+	catch(...) {
 
+		result = false;
 	}
 
-	sci_prog(c_contour, img_file_name);
+	return result;
+}
 
+bool write_diam(shape_features *features, int size, const char *filename,
+		float diam)
+{
+	bool result = true;
+
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < size; ++k)
+			if (features[k].diameter >= diam)
+				fout << features[k].diameter << '\n';
+	}
+	catch(...) {
+		return false;
+	}
+	return result;
 }
 
+
+bool write_dist(shape_features *features, int size, const char *filename,
+		float diam)
+{
+	bool result = true;
+
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < size; ++k)
+			if (features[k].diameter >= diam)
+				fout << features[k].distances.x << "     "
+				     << features[k].distances.y << "     "
+				     << features[k].distances.z << '\n';
+	}
+	catch(...) {
+		return false;
+	}
+	return result;
+
+}
+
+
+bool write_hu(shape_features *features, const contour_set &set,
+	      const char *filename, float diam)
+{
+	bool result = true;
+	shape_moments moments;
+
+	try {
+		ofstream fout(filename);
+		for (int k = 0; k < set.count; ++k)
+			if (features[k].diameter >= diam) {
+				contour_moments(set.contour(k), set.length(k),
+						moments);
+				for (int i = 0; i < 7; ++i)
+					fout << moments.hu[i] << "     ";
+				fout << '\n';
+			}
+	}
+	catch(...) {
+		return false;
+	}
+	return result;
+}
+
+
+bool write_results(shape_features *features, const contour_set &set,
+		   const char *prefix, float diam)
+{
+	string base(prefix);
+	bool result;
+
+	result = write_centroid(features, set.count,
+				(base + file_centroid).c_str(), diam);
+	result &= write_dist(features, set.count, (base + file_ratio).c_str(),
+			     diam);
+	result &= write_area(features, set.count, (base + file_area).c_str(),
+			     diam);
+	result &= write_diam(features, set.count, (base + file_diam).c_str(),
+			     diam);
+	result &= write_perimeter(features, set.count,
+				  (base + file_perimeter).c_str(), diam);
+	result &= write_energy(features, set.count,
+			       (base + file_energy).c_str(), diam);
+	result &= write_hu(features, set, (base + file_hu).c_str(), diam);
+
+	return result;
+}
+
+
+bool write_clusters(const char *filename, const kmeans &model,
+		    const int *ids, const int *labels, int count)
+{
+	float *center = new float[model.dimensions()];
+	bool result;
+
+	try {
+		ofstream fout(filename);
+		for (int c = 0; c < model.clusters(); ++c) {
+			model.center(c, center);
+			fout << "# " << c << ' ' << model.size(c);
+			for (int d = 0; d < model.dimensions(); ++d)
+				fout << ' ' << center[d];
+			fout << '\n';
+		}
+		for (int i = 0; i < count; ++i)
+			fout << ids[2 * i] << ' ' << ids[2 * i + 1] << ' '
+			     << labels[i] << '\n';
+		result = fout.good();
+	}
+	catch(...) {
+		result = false;
+	}
+
+	delete [] center;
+	return result;
+}
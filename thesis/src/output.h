@@ -33,6 +33,9 @@
 
 
 #include "base.h"
+#include "contour.h"
+#include "descriptors.h"
+#include "kmeans.h"
 
 
 /** The function writes out a scilab program script to display contours found
@@ -41,9 +44,11 @@
  * function altogether).
  * Second version of this function dates back to 21-08-2005.
  *
+ * Contours are written in a single contour archive (see archive.h),
+ * named <img_file_name>_contours.cta, instead of a text file per contour.
  *
  * @param img_file_name Original contours image filename (used to append in
- *                      name of output contour files).
+ *                      name of output archive).
  * @param contours Vector with sequence of contours.
  * @param mthreshold Set flag to true if you want to filter contours based
  *                   its diameter.
@@ -52,4 +57,90 @@
 void print_contour(char *img_file_name, CvSeq *contours, bool mthreshold = false, float diam_thres = 6);
 
 
+/** Writes centroid (x, y) of each valid contour in a text file.
+ *
+ * @param features Descriptors of each contour.
+ * @param size Number of contours.
+ * @param filename Output file name.
+ * @param diam Minimal diameter of valid contours.
+ *
+ * @return true in success, false otherwise.
+ */
+bool write_centroid(shape_features *features, int size, const char *filename,
+		    float diam);
+
+/** Writes centroid distances (max/min, max, min) of each valid contour,
+ * see \ref write_centroid for parameters.
+ */
+bool write_dist(shape_features *features, int size, const char *filename,
+		float diam);
+
+/** Writes area of each valid contour, see \ref write_centroid for
+ * parameters.
+ */
+bool write_area(shape_features *features, int size, const char *filename,
+		float diam);
+
+/** Writes diameter of each valid contour, see \ref write_centroid for
+ * parameters.
+ */
+bool write_diam(shape_features *features, int size, const char *filename,
+		float diam);
+
+/** Writes perimeter (polygon length) of each valid contour, see
+ * \ref write_centroid for parameters.
+ */
+bool write_perimeter(shape_features *features, int size, const char *filename,
+		     float diam);
+
+/** Writes bending energy of each valid contour, see \ref write_centroid
+ * for parameters.
+ *
+ * @return false if some valid contour has no energy (\ref energy_error).
+ */
+bool write_energy(shape_features *features, int size, const char *filename,
+		  float diam);
+
+/** Writes Hu invariants (7 columns) of each valid contour.
+ *
+ * @param features Descriptors of each contour.
+ * @param set Contours (moments are calculated from its points).
+ * @param filename Output file name.
+ * @param diam Minimal diameter of valid contours.
+ *
+ * @return true in success, false otherwise.
+ */
+bool write_hu(shape_features *features, const contour_set &set,
+	      const char *filename, float diam);
+
+/** Writes all descriptor files of an image: centroid.txt,
+ * ratio_centroid.txt, area.txt, diameter.txt, perimeter.txt, energy.txt
+ * and hu.txt.
+ *
+ * @param features Descriptors of each contour.
+ * @param set Contours.
+ * @param prefix Prepended to each file name (e.g. "out/img01_"), can be
+ * empty.
+ * @param diam Minimal diameter of valid contours.
+ *
+ * @return true if every file was written, false otherwise.
+ */
+bool write_results(shape_features *features, const contour_set &set,
+		   const char *prefix, float diam);
+
+/** Writes k-means clusters: a comment line per cluster ("# c size
+ * center"), then "image contour cluster" of each contour.
+ *
+ * @param filename Output file name.
+ * @param model Fitted model.
+ * @param ids Image and contour index of each contour (2 ints each).
+ * @param labels Cluster of each contour.
+ * @param count Number of contours.
+ *
+ * @return true in success, false otherwise.
+ */
+bool write_clusters(const char *filename, const kmeans &model,
+		    const int *ids, const int *labels, int count);
+
+
 #endif
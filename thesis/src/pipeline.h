@@ -0,0 +1,155 @@
+/**
+ * @file   pipeline.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Bounded queue, links stages of a pipeline.
+ *
+ * Each stage has its own worker threads, that pop items from stage input
+ * queue and push results to next stage queue. A full queue blocks its
+ * producers, so a fast stage can't pile up items (i.e. decoded images)
+ * in memory while a slow one is behind.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <pthread.h>
+#include <deque>
+
+/** \brief Blocking queue with fixed capacity.
+ *
+ * Example of use:
+ *
+ * bounded_queue<job*> queue(4);
+ * producer: queue.push(item); ... queue.close();
+ * consumer: while (queue.pop(item)) do_it(item);
+ *
+ * After close(), consumers still get remaining items, then pop() returns
+ * false.
+ */
+template <class T>
+class bounded_queue {
+protected:
+	/** Queued items */
+	std::deque<T> items;
+	/** Maximum number of queued items */
+	unsigned int capacity;
+	/** No more items will be pushed */
+	bool closed;
+	/** Protects fields above */
+	pthread_mutex_t lock;
+	/** Signals consumers that there is an item (or queue was closed) */
+	pthread_cond_t not_empty;
+	/** Signals producers that there is room */
+	pthread_cond_t not_full;
+
+private:
+	/// Non copyable.
+	bounded_queue(const bounded_queue &);
+	/// Non copyable.
+	bounded_queue &operator=(const bounded_queue &);
+
+public:
+	/** Creates an empty queue.
+	 *
+	 * @param size Capacity, at least 1.
+	 */
+	bounded_queue(unsigned int size = 4): items(),
+		capacity(size > 0 ? size : 1), closed(false), lock(),
+		not_empty(), not_full()
+	{
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&not_empty, NULL);
+		pthread_cond_init(&not_full, NULL);
+	}
+
+	/** Destructor, queue must not be in use. */
+	~bounded_queue(void)
+	{
+		pthread_cond_destroy(&not_full);
+		pthread_cond_destroy(&not_empty);
+		pthread_mutex_destroy(&lock);
+	}
+
+	/** Adds an item, blocks while queue is full.
+	 *
+	 * @param item The item.
+	 *
+	 * @return true in success, false if queue was closed (item is
+	 * not queued).
+	 */
+	bool push(const T &item)
+	{
+		bool result = false;
+
+		pthread_mutex_lock(&lock);
+		while ((items.size() >= capacity) && (!closed))
+			pthread_cond_wait(&not_full, &lock);
+
+		if (!closed) {
+			items.push_back(item);
+			result = true;
+			pthread_cond_signal(&not_empty);
+		}
+		pthread_mutex_unlock(&lock);
+
+		return result;
+	}
+
+	/** Removes oldest item, blocks while queue is empty and open.
+	 *
+	 * @param item Will hold the item.
+	 *
+	 * @return true if an item was removed, false if queue is closed
+	 * and empty.
+	 */
+	bool pop(T &item)
+	{
+		bool result = false;
+
+		pthread_mutex_lock(&lock);
+		while (items.empty() && (!closed))
+			pthread_cond_wait(&not_empty, &lock);
+
+		if (!items.empty()) {
+			item = items.front();
+			items.pop_front();
+			result = true;
+			pthread_cond_signal(&not_full);
+		}
+		pthread_mutex_unlock(&lock);
+
+		return result;
+	}
+
+	/** Closes queue, wakes up every blocked producer and consumer. */
+	void close(void)
+	{
+		pthread_mutex_lock(&lock);
+		closed = true;
+		pthread_cond_broadcast(&not_empty);
+		pthread_cond_broadcast(&not_full);
+		pthread_mutex_unlock(&lock);
+	}
+};
+
+#endif
@@ -0,0 +1,218 @@
+/** @file
+ *
+ * Work stealing thread pool.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "pool.h"
+
+#include <stdlib.h>
+
+
+/** Parameter for worker thread entry point */
+struct worker_param {
+	/// Pool that owns worker.
+	work_pool *pool;
+	/// Worker id.
+	int id;
+};
+
+
+work_pool::work_pool(int threads): threads(NULL), queues(NULL),
+	queue_count(0), thread_count(0), lock(), start_cond(), done_cond(), job(NULL),
+	job_data(NULL), generation(0), active(0), quit(false)
+{
+	worker_param *param;
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&start_cond, NULL);
+	pthread_cond_init(&done_cond, NULL);
+
+	if (threads <= 1)
+		return;
+
+	queues = new task_queue[threads];
+	queue_count = threads;
+	for (int i = 0; i < threads; ++i)
+		pthread_mutex_init(&queues[i].lock, NULL);
+
+	this->threads = new pthread_t[threads];
+	for (int i = 0; i < threads; ++i) {
+		param = new worker_param;
+		param->pool = this;
+		param->id = i;
+		if (pthread_create(&this->threads[i], NULL, worker, param)) {
+			delete param;
+			break;
+		}
+		++thread_count;
+	}
+}
+
+
+work_pool::~work_pool(void)
+{
+	pthread_mutex_lock(&lock);
+	quit = true;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&lock);
+
+	for (int i = 0; i < thread_count; ++i)
+		pthread_join(threads[i], NULL);
+
+	//Every queue, even of workers that failed to start
+	if (queues) {
+		for (int i = 0; i < queue_count; ++i)
+			pthread_mutex_destroy(&queues[i].lock);
+		delete [] queues;
+	}
+	if (threads)
+		delete [] threads;
+
+	pthread_cond_destroy(&done_cond);
+	pthread_cond_destroy(&start_cond);
+	pthread_mutex_destroy(&lock);
+}
+
+
+void *work_pool::worker(void *param)
+{
+	worker_param *obj = (worker_param *) param;
+	work_pool *pool = obj->pool;
+	int id = obj->id;
+
+	delete obj;
+	pool->work(id);
+
+	return NULL;
+}
+
+
+void work_pool::work(int id)
+{
+	int seen = 0, task;
+
+	while (true) {
+		pthread_mutex_lock(&lock);
+		while ((!quit) && (generation == seen))
+			pthread_cond_wait(&start_cond, &lock);
+		if (quit) {
+			pthread_mutex_unlock(&lock);
+			break;
+		}
+		seen = generation;
+		pthread_mutex_unlock(&lock);
+
+		while (pop(id, task) || steal(id, task))
+			job(task, job_data);
+
+		/* Tasks don't create tasks, so when every worker has
+		 * nothing to pop or steal the batch is done.
+		 */
+		pthread_mutex_lock(&lock);
+		if (--active == 0)
+			pthread_cond_signal(&done_cond);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+
+bool work_pool::pop(int id, int &task)
+{
+	bool result = false;
+	task_queue &queue = queues[id];
+
+	pthread_mutex_lock(&queue.lock);
+	if (!queue.tasks.empty()) {
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		result = true;
+	}
+	pthread_mutex_unlock(&queue.lock);
+
+	return result;
+}
+
+
+bool work_pool::steal(int id, int &task)
+{
+	bool result = false;
+	int victim;
+
+	for (int i = 1; (i < thread_count) && (!result); ++i) {
+		victim = (id + i) % thread_count;
+		task_queue &queue = queues[victim];
+
+		pthread_mutex_lock(&queue.lock);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			result = true;
+		}
+		pthread_mutex_unlock(&queue.lock);
+	}
+
+	return result;
+}
+
+
+void work_pool::run(task_function function, void *data, int count)
+{
+	int chunk, first, last;
+
+	if (count <= 0)
+		return;
+
+	if (thread_count == 0) {
+		for (int i = 0; i < count; ++i)
+			function(i, data);
+		return;
+	}
+
+	/* Each worker starts with a contiguous block of tasks, it
+	 * pops from the back while thieves take from the front.
+	 */
+	chunk = count / thread_count;
+	for (int i = 0; i < thread_count; ++i) {
+		first = i * chunk;
+		last = (i == thread_count - 1) ? count : first + chunk;
+		pthread_mutex_lock(&queues[i].lock);
+		for (int j = first; j < last; ++j)
+			queues[i].tasks.push_back(j);
+		pthread_mutex_unlock(&queues[i].lock);
+	}
+
+	pthread_mutex_lock(&lock);
+	job = function;
+	job_data = data;
+	active = thread_count;
+	++generation;
+	pthread_cond_broadcast(&start_cond);
+	while (active > 0)
+		pthread_cond_wait(&done_cond, &lock);
+	job = NULL;
+	job_data = NULL;
+	pthread_mutex_unlock(&lock);
+}
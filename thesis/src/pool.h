@@ -0,0 +1,154 @@
+/**
+ * @file   pool.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Thread pool module, runs a batch of independent tasks.
+ *
+ * Each worker thread owns a task queue (a deque), it takes tasks from
+ * its back and when empty steals tasks from the front of other worker
+ * queues. Since per contour cost ranges over several orders of
+ * magnitude (a few points versus a whole image border), this balances
+ * load much better than splitting tasks evenly between threads.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <pthread.h>
+#include <deque>
+
+/** Task function type.
+ *
+ * @param index Task index, ranging from 0 to (count - 1).
+ * @param data User data pointer given to \ref work_pool::run.
+ */
+typedef void (*task_function)(int index, void *data);
+
+
+/** \brief A task queue owned by one worker thread. */
+struct task_queue {
+	/// Protects tasks.
+	pthread_mutex_t lock;
+	/// Task indexes.
+	std::deque<int> tasks;
+};
+
+
+/** \brief Work stealing thread pool.
+ *
+ * Example of use:
+ *
+ * work_pool pool(4);
+ * pool.run(do_contour, &contours, contours.count);
+ *
+ * Tasks are independent and there is no result ordering issue:
+ * a task must write its result at its own index of an output vector.
+ */
+class work_pool {
+protected:
+	/** Worker threads */
+	pthread_t *threads;
+	/** One task queue per worker */
+	task_queue *queues;
+	/** Number of allocated queues (workers asked for) */
+	int queue_count;
+	/** Number of worker threads */
+	int thread_count;
+	/** Protects fields bellow */
+	pthread_mutex_t lock;
+	/** Signals workers that a new batch is ready (or to quit) */
+	pthread_cond_t start_cond;
+	/** Signals caller that all workers are idle */
+	pthread_cond_t done_cond;
+	/** Current task function */
+	task_function job;
+	/** Current task user data */
+	void *job_data;
+	/** Batch counter, workers compare it to know about new batches */
+	int generation;
+	/** Number of workers still working on current batch */
+	int active;
+	/** Workers must exit */
+	bool quit;
+
+	/** Takes a task from back of worker own queue.
+	 *
+	 * @param id Worker id.
+	 * @param task Will hold task index.
+	 *
+	 * @return true if there was a task, false otherwise.
+	 */
+	bool pop(int id, int &task);
+
+	/** Steals a task from front of other workers queues.
+	 *
+	 * @param id Thief worker id.
+	 * @param task Will hold task index.
+	 *
+	 * @return true if a task was stolen, false otherwise.
+	 */
+	bool steal(int id, int &task);
+
+	/** Worker main loop.
+	 *
+	 * @param id Worker id.
+	 */
+	void work(int id);
+
+	/** Thread entry point. */
+	static void *worker(void *param);
+
+private:
+	/// Non copyable.
+	work_pool(const work_pool &);
+	/// Non copyable.
+	work_pool &operator=(const work_pool &);
+
+public:
+	/** Creates pool threads.
+	 *
+	 * @param threads Number of worker threads, with 1 or less
+	 * tasks are run by caller thread (no thread is created).
+	 */
+	work_pool(int threads = 1);
+
+	/** Stops and joins worker threads. */
+	~work_pool(void);
+
+	/** Runs a batch of tasks, returns when all of them are done.
+	 *
+	 * @param function Task function.
+	 * @param data User data passed to task function.
+	 * @param count Number of tasks.
+	 */
+	void run(task_function function, void *data, int count);
+
+	/** Number of worker threads.
+	 *
+	 * @return Number of threads (0 when running in caller thread).
+	 */
+	int size(void) {
+		return thread_count;
+	}
+};
+
+#endif
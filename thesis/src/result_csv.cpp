@@ -0,0 +1,130 @@
+/** @file
+ *
+ * Converts a columnar result file to CSV.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* Exports a result file (see results.h) as CSV, one line per contour,
+ * first column is image name.
+ *
+ * Usage: result_csv results.bin [output.csv]
+ */
+
+#include "results.h"
+#include <stdio.h>
+#include <string.h>
+
+
+/** Writes a CSV field, quoted when needed.
+ *
+ * @param fout Output stream.
+ * @param text Field text.
+ */
+static void put_field(FILE *fout, const char *text)
+{
+	if (!strpbrk(text, ",\"\n")) {
+		fputs(text, fout);
+		return;
+	}
+
+	fputc('"', fout);
+	for (; *text; ++text) {
+		if (*text == '"')
+			fputc('"', fout);
+		fputc(*text, fout);
+	}
+	fputc('"', fout);
+}
+
+
+int main(int argc, char *argv[])
+{
+	result_file results;
+	FILE *fout = stdout;
+	const char *name;
+	int image_col, result = -1;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s results.bin [output.csv]\n", argv[0]);
+		return -1;
+	}
+
+	if (!results.open(argv[1])) {
+		fprintf(stderr, "Can't read result file \"%s\"\n", argv[1]);
+		return -1;
+	}
+
+	if ((argc >= 3) && (!(fout = fopen(argv[2], "w")))) {
+		fprintf(stderr, "Can't create \"%s\"\n", argv[2]);
+		return -1;
+	}
+
+	image_col = results.find_column("image_id");
+	if ((image_col >= 0) &&
+	    (results.column(image_col).type != COLUMN_INT32)) {
+		fprintf(stderr, "Column image_id of \"%s\" is not an integer"
+			" column\n", argv[1]);
+		if (fout != stdout)
+			fclose(fout);
+		return -1;
+	}
+
+	fputs("image", fout);
+	for (int j = 0; j < results.columns(); ++j)
+		fprintf(fout, ",%.16s", results.column(j).name);
+	fputc('\n', fout);
+
+	for (int k = 0; k < results.segments(); ++k)
+		for (long long i = 0; i < results.segment_rows(k); ++i) {
+			name = NULL;
+			if (image_col >= 0)
+				name = results.image_name(((const int *)
+					results.data(image_col, k))[i]);
+			put_field(fout, name ? name : "");
+
+			for (int j = 0; j < results.columns(); ++j)
+				switch (results.column(j).type) {
+				case COLUMN_INT32:
+					fprintf(fout, ",%d", ((const int *)
+						results.data(j, k))[i]);
+					break;
+				case COLUMN_FLOAT:
+					fprintf(fout, ",%.9g", ((const float *)
+						results.data(j, k))[i]);
+					break;
+				default:
+					fprintf(fout, ",%.17g", ((const double *)
+						results.data(j, k))[i]);
+				}
+			fputc('\n', fout);
+		}
+
+	if (!ferror(fout))
+		result = 0;
+	if ((fout != stdout) && fclose(fout))
+		result = -1;
+
+	return result;
+}
@@ -0,0 +1,471 @@
+/** @file
+ *
+ * Columnar binary result file.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "results.h"
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+
+/** \brief Name and type of a column. */
+struct column_def {
+	/// Column name.
+	const char *name;
+	/// Value type.
+	column_type type;
+};
+
+/** File schema, indexed by \ref result_columns */
+static const column_def schema[result_column_count] = {
+	{ "image_id", COLUMN_INT32 }, { "contour_id", COLUMN_INT32 },
+	{ "centroid_x", COLUMN_FLOAT }, { "centroid_y", COLUMN_FLOAT },
+	{ "area", COLUMN_FLOAT }, { "diameter", COLUMN_FLOAT },
+	{ "width", COLUMN_FLOAT }, { "solidity", COLUMN_FLOAT },
+	{ "ratio", COLUMN_DOUBLE }, { "dist_max", COLUMN_DOUBLE },
+	{ "dist_min", COLUMN_DOUBLE }, { "points", COLUMN_INT32 },
+	{ "perimeter", COLUMN_FLOAT }, { "energy", COLUMN_DOUBLE },
+	{ "hu1", COLUMN_DOUBLE }, { "hu2", COLUMN_DOUBLE },
+	{ "hu3", COLUMN_DOUBLE }, { "hu4", COLUMN_DOUBLE },
+	{ "hu5", COLUMN_DOUBLE }, { "hu6", COLUMN_DOUBLE },
+	{ "hu7", COLUMN_DOUBLE }
+};
+
+/** Size of write buffer */
+static const int buffer_size = 1 << 20;
+
+
+/** Size of a value.
+ *
+ * @param type Value type.
+ *
+ * @return Size in bytes.
+ */
+static int type_width(int type)
+{
+	return (type == COLUMN_DOUBLE) ? sizeof(double) : 4;
+}
+
+
+/** Rounds a file offset up to 8 bytes. */
+static long long align8(long long offset)
+{
+	return (offset + 7) & ~7LL;
+}
+
+
+result_writer::result_writer(void): names(), rows(0), buffered(0),
+				    header(), fout(NULL), buffer(NULL),
+				    error(false)
+{
+}
+
+
+result_writer::~result_writer(void)
+{
+	close();
+}
+
+
+void result_writer::put(int column, const void *value)
+{
+	const char *bytes = (const char *) value;
+
+	data[column].insert(data[column].end(), bytes,
+			    bytes + type_width(schema[column].type));
+}
+
+
+int result_writer::add_image(const char *name)
+{
+	names.push_back(name);
+	return names.size() - 1;
+}
+
+
+int result_writer::append(int image, const shape_features *features,
+			  const contour_set &set, float diam,
+			  const shape_moments *moments)
+{
+	vector<shape_moments> calculated;
+	int count = 0;
+
+	if (moments)
+		return append(image, features, set.count, diam, moments);
+
+	calculated.resize(set.count);
+	for (int k = 0; k < set.count; ++k)
+		if (features[k].diameter >= diam)
+			contour_moments(set.contour(k), set.length(k),
+					calculated[k]);
+	if (set.count)
+		count = append(image, features, set.count, diam,
+			       &calculated[0]);
+
+	return count;
+}
+
+
+int result_writer::append(int image, const shape_features *features,
+			  int size, float diam, const shape_moments *moments)
+{
+	int count = 0;
+
+	for (int k = 0; k < size; ++k) {
+		const shape_features &f = features[k];
+		const shape_moments *m = &moments[k];
+		if (f.diameter < diam)
+			continue;
+
+		put(COL_IMAGE, &image);
+		put(COL_CONTOUR, &k);
+		put(COL_CENTROID_X, &f.centroid.x);
+		put(COL_CENTROID_Y, &f.centroid.y);
+		put(COL_AREA, &f.area);
+		put(COL_DIAMETER, &f.diameter);
+		put(COL_WIDTH, &f.width);
+		put(COL_SOLIDITY, &f.solidity);
+		put(COL_RATIO, &f.distances.x);
+		put(COL_DIST_MAX, &f.distances.y);
+		put(COL_DIST_MIN, &f.distances.z);
+		put(COL_POINTS, &f.perimeter);
+		put(COL_PERIMETER, &f.length);
+		put(COL_ENERGY, &f.energy);
+		for (int i = 0; i < 7; ++i)
+			put(COL_HU1 + i, &m->hu[i]);
+		++count;
+	}
+
+	rows += count;
+	buffered += count;
+	return count;
+}
+
+
+bool result_writer::open(const char *filename)
+{
+	result_column table[result_column_count];
+	static const char padding[8] = { 0 };
+	long long offset, names_size = 0;
+
+	close();
+	error = false;
+
+	memset(&header, 0, sizeof(header));
+	memset(table, 0, sizeof(table));
+
+	for (int i = 0; i < result_column_count; ++i) {
+		strncpy(table[i].name, schema[i].name,
+			sizeof(table[i].name) - 1);
+		table[i].type = schema[i].type;
+		table[i].width = type_width(schema[i].type);
+	}
+
+	for (unsigned int i = 0; i < names.size(); ++i)
+		names_size += names[i].size() + 1;
+
+	memcpy(header.magic, result_magic, sizeof(header.magic));
+	header.version = result_version;
+	header.columns = result_column_count;
+	header.images = names.size();
+	header.names_offset = align8(sizeof(header) + sizeof(table));
+	header.names_size = names_size;
+
+	if (!(fout = fopen(filename, "wb")))
+		return false;
+
+	buffer = new char[buffer_size];
+	if (buffer)
+		setvbuf(fout, buffer, _IOFBF, buffer_size);
+
+	fwrite(&header, sizeof(header), 1, fout);
+	fwrite(table, sizeof(table), 1, fout);
+	offset = sizeof(header) + sizeof(table);
+	fwrite(padding, align8(offset) - offset, 1, fout);
+
+	for (unsigned int i = 0; i < names.size(); ++i)
+		fwrite(names[i].c_str(), names[i].size() + 1, 1, fout);
+	offset = names_size;
+	fwrite(padding, align8(offset) - offset, 1, fout);
+
+	if (fflush(fout))
+		error = true;
+
+	return !error;
+}
+
+
+bool result_writer::flush(void)
+{
+	static const char padding[8] = { 0 };
+	result_segment segment;
+	long long size;
+
+	if (!fout)
+		return false;
+	if (error)
+		return false;
+	if (!buffered)
+		return true;
+
+	/* Segment first, then header that commits it: a crash in between
+	 * leaves an uncommitted tail that readers ignore.
+	 */
+	memset(&segment, 0, sizeof(segment));
+	segment.rows = buffered;
+	fseek(fout, 0, SEEK_END);
+	fwrite(&segment, sizeof(segment), 1, fout);
+	for (int i = 0; i < result_column_count; ++i) {
+		fwrite(&data[i][0], data[i].size(), 1, fout);
+		size = data[i].size();
+		fwrite(padding, align8(size) - size, 1, fout);
+		data[i].clear();
+	}
+
+	if (fflush(fout))
+		error = true;
+
+	header.segments++;
+	header.rows += buffered;
+	buffered = 0;
+	fseek(fout, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, fout);
+	if (fflush(fout) || ferror(fout))
+		error = true;
+
+	return !error;
+}
+
+
+bool result_writer::close(void)
+{
+	bool result;
+
+	if (!fout)
+		return false;
+
+	flush();
+	result = !error;
+	if (fclose(fout))
+		result = false;
+	fout = NULL;
+	if (buffer)
+		delete [] buffer;
+	buffer = NULL;
+
+	return result;
+}
+
+
+bool result_writer::write(const char *filename)
+{
+	if (!open(filename)) {
+		close();
+		return false;
+	}
+
+	return close();
+}
+
+
+result_file::result_file(void): fd(-1), map(NULL), map_size(0),
+				header(NULL), table(NULL), names(),
+				columns_data(), segment_start()
+{
+}
+
+
+result_file::~result_file(void)
+{
+	close();
+}
+
+
+bool result_file::read_segments(long long offset)
+{
+	const result_segment *segment;
+	long long rows = 0;
+
+	segment_start.push_back(0);
+	for (int k = 0; k < header->segments; ++k) {
+		if (offset + (long long) sizeof(result_segment) >
+		    (long long) map_size)
+			return false;
+		segment = (const result_segment *) (map + offset);
+		if ((segment->rows <= 0) ||
+		    (segment->rows > (long long) map_size))
+			return false;
+
+		offset += sizeof(result_segment);
+		for (int i = 0; i < header->columns; ++i) {
+			columns_data.push_back(map + offset);
+			offset += align8(segment->rows * table[i].width);
+		}
+		if (offset > (long long) map_size)
+			return false;
+		rows += segment->rows;
+		segment_start.push_back(rows);
+	}
+
+	return rows == header->rows;
+}
+
+
+bool result_file::validate(void)
+{
+	const char *name, *end;
+
+	if (map_size < sizeof(result_header))
+		return false;
+
+	header = (const result_header *) map;
+	if (memcmp(header->magic, result_magic, sizeof(result_magic)) ||
+	    (header->version != result_version) || (header->columns < 0) ||
+	    (header->images < 0) || (header->segments < 0) ||
+	    (header->rows < 0) || (header->rows > (long long) map_size))
+		return false;
+
+	if (sizeof(result_header) +
+	    (long long) header->columns * sizeof(result_column) > map_size)
+		return false;
+	table = (const result_column *) (map + sizeof(result_header));
+
+	for (int i = 0; i < header->columns; ++i)
+		if ((table[i].type < COLUMN_INT32) ||
+		    (table[i].type > COLUMN_DOUBLE) ||
+		    (table[i].width != type_width(table[i].type)))
+			return false;
+
+	if ((header->names_offset < 0) || (header->names_size < 0) ||
+	    (header->names_offset + header->names_size >
+	     (long long) map_size))
+		return false;
+
+	name = map + header->names_offset;
+	end = name + header->names_size;
+	for (int i = 0; i < header->images; ++i) {
+		names.push_back(name);
+		while ((name < end) && *name)
+			++name;
+		if (name++ == end)
+			return false;
+	}
+
+	return read_segments(align8(header->names_offset +
+				    header->names_size));
+}
+
+
+bool result_file::open(const char *filename)
+{
+	struct stat info;
+
+	close();
+
+	if ((fd = ::open(filename, O_RDONLY)) < 0)
+		return false;
+
+	if (fstat(fd, &info) || (info.st_size <= 0))
+		goto error;
+
+	map_size = info.st_size;
+	map = (char *) mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		map = NULL;
+		goto error;
+	}
+
+	if (validate())
+		return true;
+
+error:
+	close();
+	return false;
+}
+
+
+void result_file::close(void)
+{
+	if (map)
+		munmap(map, map_size);
+	if (fd >= 0)
+		::close(fd);
+
+	fd = -1;
+	map = NULL;
+	map_size = 0;
+	header = NULL;
+	table = NULL;
+	names.clear();
+	columns_data.clear();
+	segment_start.clear();
+}
+
+
+const char *result_file::image_name(int id) const
+{
+	if ((id < 0) || (id >= (int) names.size()))
+		return NULL;
+
+	return names[id];
+}
+
+
+int result_file::find_column(const char *name) const
+{
+	for (int i = 0; i < columns(); ++i)
+		if (!strncmp(table[i].name, name, sizeof(table[i].name)))
+			return i;
+
+	return -1;
+}
+
+
+double result_file::value(int index, long long row) const
+{
+	const void *column;
+	int k;
+
+	k = upper_bound(segment_start.begin(), segment_start.end(), row) -
+		segment_start.begin() - 1;
+	column = data(index, k);
+	row -= segment_start[k];
+
+	switch (table[index].type) {
+	case COLUMN_INT32:
+		return ((const int *) column)[row];
+	case COLUMN_FLOAT:
+		return ((const float *) column)[row];
+	default:
+		return ((const double *) column)[row];
+	}
+}
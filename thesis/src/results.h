@@ -0,0 +1,423 @@
+/**
+ * @file   results.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Columnar binary file with descriptors of valid contours.
+ *
+ * Replaces the 7 text files (centroid.txt, area.txt, ...), whose rows
+ * were matched only by their order. Every descriptor is a column and
+ * each row has its image and contour ids, so a file can hold results of
+ * many images (see \ref run_batch).
+ *
+ * File layout (native byte order, all sections 8 byte aligned):
+ *
+ * - \ref result_header
+ * - column table, one \ref result_column per column
+ * - image names, null terminated strings indexed by image id
+ * - segments, each one a \ref result_segment followed by its rows: all
+ *   values of first column, then all values of second one, etc
+ *
+ * Rows are written out a segment at a time while images are processed
+ * and header is updated after each segment, so a crash loses only rows
+ * not flushed yet. Columns of each segment are contiguous, a reader
+ * uses them as plain C vectors straight from the mapping, one segment
+ * after the other (see \ref result_file).
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _RESULTS_H_
+#define _RESULTS_H_
+
+#include "contour.h"
+#include "descriptors.h"
+#include "moments.h"
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdio.h>
+
+/** File signature */
+const char result_magic[8] = { 'C', 'N', 'T', 'R', 'E', 'S', 'L', 'T' };
+/** Format version */
+const int result_version = 2;
+
+/** Column value types */
+typedef enum { COLUMN_INT32, COLUMN_FLOAT, COLUMN_DOUBLE } column_type;
+
+/** Columns written by \ref result_writer, in file order */
+typedef enum { COL_IMAGE, COL_CONTOUR, COL_CENTROID_X, COL_CENTROID_Y,
+	       COL_AREA, COL_DIAMETER, COL_WIDTH, COL_SOLIDITY, COL_RATIO,
+	       COL_DIST_MAX, COL_DIST_MIN, COL_POINTS, COL_PERIMETER,
+	       COL_ENERGY, COL_HU1, COL_HU2, COL_HU3, COL_HU4, COL_HU5,
+	       COL_HU6, COL_HU7, result_column_count } result_columns;
+
+
+/** \brief Fixed size file header. */
+struct result_header {
+	/// Signature, see \ref result_magic.
+	char magic[8];
+	/// Format version.
+	int version;
+	/// Number of columns.
+	int columns;
+	/// Number of images (entries in names table).
+	int images;
+	/// Number of segments.
+	int segments;
+	/// Number of rows (valid contours of all images), in all segments.
+	long long rows;
+	/// Offset of image names table from file start.
+	long long names_offset;
+	/// Size of names table in bytes.
+	long long names_size;
+};
+
+
+/** \brief Column table entry (schema). */
+struct result_column {
+	/// Column name (e.g. "diameter"), null terminated.
+	char name[16];
+	/// Value type, see \ref column_type.
+	int type;
+	/// Size of a value in bytes.
+	int width;
+	/// Unused (column data is in segments), zero.
+	long long reserved;
+};
+
+
+/** \brief Segment header, followed by segment column data. */
+struct result_segment {
+	/// Number of rows in segment.
+	long long rows;
+	/// Unused, zero.
+	long long reserved;
+};
+
+
+/** \brief Collects rows in memory, writes them out a segment at a time.
+ *
+ * Each column grows in its own buffer until \ref flush, which writes
+ * buffered rows as a new segment with few large writes (instead of a
+ * flush per text line) and commits it in file header. Images must be
+ * registered before \ref open (names table goes first in file). Not
+ * thread safe, callers must serialize calls.
+ *
+ * Example of use:
+ *
+ * result_writer writer;
+ * id = writer.add_image("24esc.bmp");
+ * writer.open("results.bin");
+ * writer.append(id, features, shapes, diam_thres);
+ * writer.flush();
+ * ...
+ * writer.close();
+ */
+class result_writer {
+protected:
+	/** Buffered data of each column */
+	std::vector<char> data[result_column_count];
+	/** Image names, indexed by image id */
+	std::vector<std::string> names;
+	/** Number of rows */
+	long long rows;
+	/** Number of buffered rows */
+	long long buffered;
+	/** Header of open file */
+	result_header header;
+	/** Open file */
+	FILE *fout;
+	/** Write buffer of open file */
+	char *buffer;
+	/** A write failed, file is not complete */
+	bool error;
+
+	/** Appends a value to a column.
+	 *
+	 * @param column Column index.
+	 * @param value Pointer to value (with column type).
+	 */
+	void put(int column, const void *value);
+
+private:
+	/// Non copyable (it owns the file).
+	result_writer(const result_writer &);
+	/// Non copyable (it owns the file).
+	result_writer &operator=(const result_writer &);
+
+public:
+	/** Creates an empty writer. */
+	result_writer(void);
+
+	/** Destructor, closes file. */
+	~result_writer(void);
+
+	/** Registers an image.
+	 *
+	 * @param name Image file name.
+	 *
+	 * @return Image id (ids are given in sequence, starting at 0).
+	 */
+	int add_image(const char *name);
+
+	/** Appends a row for each valid contour of an image.
+	 *
+	 * @param image Image id, see \ref add_image.
+	 * @param features Descriptors of each contour.
+	 * @param set Contours (Hu invariants are calculated from its
+	 * points, unless given in moments).
+	 * @param diam Minimal diameter of valid contours.
+	 * @param moments Moments of each contour (only Hu invariants of
+	 * valid contours are used), can be NULL.
+	 *
+	 * @return Number of appended rows.
+	 */
+	int append(int image, const shape_features *features,
+		   const contour_set &set, float diam,
+		   const shape_moments *moments = NULL);
+
+	/** Appends a row for each valid contour of an image, without its
+	 * points (e.g. contours kept as chain codes, see chain.h).
+	 *
+	 * @param image Image id, see \ref add_image.
+	 * @param features Descriptors of each contour.
+	 * @param size Number of contours.
+	 * @param diam Minimal diameter of valid contours.
+	 * @param moments Moments of each contour (only Hu invariants of
+	 * valid contours are used).
+	 *
+	 * @return Number of appended rows.
+	 */
+	int append(int image, const shape_features *features, int size,
+		   float diam, const shape_moments *moments);
+
+	/** Creates file, writes header, column table and image names.
+	 *
+	 * @param filename Output file name.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool open(const char *filename);
+
+	/** Writes buffered rows as a new segment and commits it in header.
+	 *
+	 * @return true in success (or if there is nothing to write), false
+	 * if file is not open or a write failed (then rows are lost and
+	 * \ref close fails too).
+	 */
+	bool flush(void);
+
+	/** Flushes buffered rows and closes file.
+	 *
+	 * @return true if every row was written, false otherwise.
+	 */
+	bool close(void);
+
+	/** Writes out the file at once (\ref open, \ref close).
+	 *
+	 * @param filename Output file name.
+	 *
+	 * @return true in success, false otherwise.
+	 */
+	bool write(const char *filename);
+
+	/** Number of buffered rows.
+	 *
+	 * @return Rows appended after last \ref flush.
+	 */
+	long long pending(void) const {
+		return buffered;
+	}
+
+	/** Number of rows.
+	 *
+	 * @return Rows appended so far.
+	 */
+	long long size(void) const {
+		return rows;
+	}
+};
+
+
+/** \brief Memory mapped reader of a result file.
+ *
+ * Example of use:
+ *
+ * result_file results;
+ * results.open("results.bin");
+ * for (int k = 0; k < results.segments(); ++k) {
+ *	const float *diam = (const float *) results.data(COL_DIAMETER, k);
+ *	for (long long i = 0; i < results.segment_rows(k); ++i)
+ *		... diam[i] ...
+ * }
+ *
+ * Nothing is copied out of the mapping, data pointers are valid until
+ * \ref close.
+ */
+class result_file {
+protected:
+	/** File descriptor */
+	int fd;
+	/** Mapped file */
+	char *map;
+	/** Mapped size */
+	size_t map_size;
+	/** Header, at beginning of mapping */
+	const result_header *header;
+	/** Column table */
+	const result_column *table;
+	/** Image names, indexed by image id */
+	std::vector<const char *> names;
+	/** Data of each column of each segment (columns of first segment,
+	 * then of second one, etc) */
+	std::vector<const char *> columns_data;
+	/** First row of each segment, followed by number of rows */
+	std::vector<long long> segment_start;
+
+	/** Finds segments and column data.
+	 *
+	 * @param offset Offset of first segment.
+	 *
+	 * @return true if segments are within file and hold header rows,
+	 * false otherwise.
+	 */
+	bool read_segments(long long offset);
+
+	/** Checks header, schema and section bounds.
+	 *
+	 * @return true if file is well formed, false otherwise.
+	 */
+	bool validate(void);
+
+private:
+	/// Non copyable (it owns the mapping).
+	result_file(const result_file &);
+	/// Non copyable (it owns the mapping).
+	result_file &operator=(const result_file &);
+
+public:
+	/** Creates a closed reader. */
+	result_file(void);
+
+	/** Destructor, unmaps file. */
+	~result_file(void);
+
+	/** Maps a result file.
+	 *
+	 * @param filename File name.
+	 *
+	 * @return true in success, false if file can't be read or is not a
+	 * valid result file.
+	 */
+	bool open(const char *filename);
+
+	/** Unmaps file. */
+	void close(void);
+
+	/** Number of rows. */
+	long long rows(void) const {
+		return header ? header->rows : 0;
+	}
+
+	/** Number of segments. */
+	int segments(void) const {
+		return segment_start.size() ? segment_start.size() - 1 : 0;
+	}
+
+	/** Number of rows of a segment.
+	 *
+	 * @param segment Segment index, ranging from 0 to (segments() - 1).
+	 *
+	 * @return Rows of segment.
+	 */
+	long long segment_rows(int segment) const {
+		return segment_start[segment + 1] - segment_start[segment];
+	}
+
+	/** First row of a segment.
+	 *
+	 * @param segment Segment index.
+	 *
+	 * @return Index of its first row among all rows of file.
+	 */
+	long long segment_first(int segment) const {
+		return segment_start[segment];
+	}
+
+	/** Number of columns. */
+	int columns(void) const {
+		return header ? header->columns : 0;
+	}
+
+	/** Number of images. */
+	int images(void) const {
+		return names.size();
+	}
+
+	/** Name of an image.
+	 *
+	 * @param id Image id.
+	 *
+	 * @return Image file name or NULL if id is out of range.
+	 */
+	const char *image_name(int id) const;
+
+	/** Schema of a column.
+	 *
+	 * @param index Column index, ranging from 0 to (columns() - 1).
+	 *
+	 * @return Column table entry.
+	 */
+	const result_column &column(int index) const {
+		return table[index];
+	}
+
+	/** Finds a column by name.
+	 *
+	 * @param name Column name.
+	 *
+	 * @return Column index or -1 if there is no such column.
+	 */
+	int find_column(const char *name) const;
+
+	/** Column data of a segment, straight from mapping.
+	 *
+	 * @param index Column index.
+	 * @param segment Segment index.
+	 *
+	 * @return Pointer to segment_rows(segment) values of column type.
+	 */
+	const void *data(int index, int segment) const {
+		return columns_data[segment * columns() + index];
+	}
+
+	/** Reads one value of any column type.
+	 *
+	 * @param index Column index.
+	 * @param row Row index, among all rows of file (its segment is
+	 * found by binary search).
+	 *
+	 * @return The value converted to double.
+	 */
+	double value(int index, long long row) const;
+};
+
+#endif
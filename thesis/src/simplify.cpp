@@ -0,0 +1,181 @@
+/** @file
+ *
+ * Polygon simplification (Douglas-Peucker) of contours.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "simplify.h"
+
+
+/** Squared distance of a point to a segment.
+ *
+ * @param p The point.
+ * @param a Segment start.
+ * @param b Segment end.
+ *
+ * @return Squared distance.
+ */
+static double segment_dist(const CvPoint &p, const CvPoint &a,
+			   const CvPoint &b)
+{
+	double dx = b.x - a.x, dy = b.y - a.y;
+	double px = p.x - a.x, py = p.y - a.y;
+	double len = dx * dx + dy * dy, t;
+
+	if (len > 0) {
+		t = (px * dx + py * dy) / len;
+		if (t > 1) {
+			px = p.x - b.x;
+			py = p.y - b.y;
+		} else if (t > 0) {
+			px -= t * dx;
+			py -= t * dy;
+		}
+	}
+
+	return px * px + py * py;
+}
+
+
+int simplify_contour(const CvPoint *contour, int size, double tolerance,
+		     CvPoint *result)
+{
+	char *keep = NULL;
+	int *stack = NULL;
+	int top = 0, first, last, far, count = -1;
+	double limit = tolerance * tolerance, dist, best;
+
+	if ((!contour) || (!result) || (size < 0))
+		goto exit;
+
+	if ((size < 4) || (tolerance <= 0)) {
+		for (int i = 0; i < size; ++i)
+			result[i] = contour[i];
+		count = size;
+		goto exit;
+	}
+
+	keep = new char[size];
+	stack = new int[2 * size];
+	if ((!keep) || (!stack))
+		goto exit;
+
+	for (int i = 0; i < size; ++i)
+		keep[i] = 0;
+
+	/* Split closed contour at first point and farthest one */
+	far = 0;
+	best = 0;
+	for (int i = 1; i < size; ++i) {
+		dist = segment_dist(contour[i], contour[0], contour[0]);
+		if (dist > best) {
+			best = dist;
+			far = i;
+		}
+	}
+	keep[0] = 1;
+	keep[far] = 1;
+
+	/* Range [first, last], where index 'size' is first point again */
+	if (far > 0) {
+		stack[top++] = 0;
+		stack[top++] = far;
+		stack[top++] = far;
+		stack[top++] = size;
+	}
+
+	while (top > 0) {
+		last = stack[--top];
+		first = stack[--top];
+		far = -1;
+		best = limit;
+
+		for (int i = first + 1; i < last; ++i) {
+			dist = segment_dist(contour[i], contour[first],
+					    contour[last % size]);
+			if (dist > best) {
+				best = dist;
+				far = i;
+			}
+		}
+
+		if (far < 0)
+			continue;
+
+		keep[far] = 1;
+		stack[top++] = first;
+		stack[top++] = far;
+		stack[top++] = far;
+		stack[top++] = last;
+	}
+
+	count = 0;
+	for (int i = 0; i < size; ++i)
+		if (keep[i])
+			result[count++] = contour[i];
+
+exit:
+	if (keep)
+		delete [] keep;
+	if (stack)
+		delete [] stack;
+
+	return count;
+}
+
+
+bool simplify_contours(const contour_set &set, double tolerance,
+		       contour_set &result)
+{
+	bool answer = false;
+	int length;
+
+	result.clear();
+	result.points = new CvPoint[set.total];
+	result.offsets = new int[set.count + 1];
+	if ((!result.points) || (!result.offsets))
+		goto exit;
+
+	result.offsets[0] = 0;
+	for (int i = 0; i < set.count; ++i) {
+		length = simplify_contour(set.contour(i), set.length(i),
+					  tolerance,
+					  result.points + result.offsets[i]);
+		if (length < 0)
+			goto exit;
+		result.offsets[i + 1] = result.offsets[i] + length;
+	}
+
+	result.count = set.count;
+	result.total = result.offsets[set.count];
+	answer = true;
+
+exit:
+	if (!answer)
+		result.clear();
+
+	return answer;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file   simplify.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Polygon simplification (Douglas-Peucker) of contours.
+ *
+ * Contours found with CV_CHAIN_APPROX_NONE have every border pixel,
+ * geometric descriptors (hull, centroid distances, polygon length) don't
+ * need that density. A simplified contour keeps only points that are
+ * farther than a tolerance (in pixels) from the polygon of kept points,
+ * so its geometry differs from original at most by tolerance.
+ *
+ * Recursion is replaced by an explicit stack of point ranges, a long
+ * contour can't overflow the call stack.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _SIMPLIFY_H_
+#define _SIMPLIFY_H_
+
+#include "base.h"
+#include "contour.h"
+
+/** Simplifies a closed contour.
+ *
+ * Contour is split at its first point and the point farthest from it,
+ * then each half is simplified by Douglas-Peucker.
+ *
+ * @param contour Vector with contour points.
+ * @param size Number of points.
+ * @param tolerance Maximum distance (in pixels) of a dropped point to
+ * simplified polygon.
+ * @param result Pre-allocated vector (with at least 'size' elements)
+ * that will hold kept points, in same order of contour.
+ *
+ * @return Number of kept points (contours with less than 4 points are
+ * just copied) or -1 in error case.
+ */
+int simplify_contour(const CvPoint *contour, int size, double tolerance,
+		     CvPoint *result);
+
+/** Simplifies each contour of a contour set.
+ *
+ * @param set Contour set.
+ * @param tolerance See \ref simplify_contour.
+ * @param result Contour set that will hold simplified contours, in same
+ * order of original (previous content is released).
+ *
+ * @return true in success, false otherwise.
+ */
+bool simplify_contours(const contour_set &set, double tolerance,
+		       contour_set &result);
+
+#endif
@@ -0,0 +1,238 @@
+/** @file
+ *
+ * Descriptor stage, per contour tasks.
+ *
+ *
+ * Copyright 2007
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com>
+ *
+ * @version
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "stage.h"
+#include "fourier.h"
+#include "hull.h"
+#include "simplify.h"
+
+
+/** Serializes fftw planner calls, process wide: several stages can run
+ * at same time (see \ref run_batch).
+ */
+static pthread_mutex_t fftw_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/** Shared data of descriptor stage tasks */
+struct stage_data {
+	/// Contours.
+	const contour_set *set;
+	/// Output records.
+	shape_features *features;
+	/// Minimal diameter to calculate bending energy.
+	float diam_thres;
+	/// Curvature gaussian parameter.
+	double tau;
+	/// Simplification tolerance (0 means no simplification).
+	double tolerance;
+	/// Protects failed flag.
+	pthread_mutex_t lock;
+	/// Set to true by any task whose curvature failed.
+	bool failed;
+};
+
+
+/** Bending energy of one contour.
+ *
+ * @param contour Vector with contour points.
+ * @param length Number of points.
+ * @param tau Curvature gaussian parameter.
+ * @param mutex Lock for fftw planner.
+ *
+ * @return The energy or \ref energy_error.
+ */
+static double contour_energy(const CvPoint *contour, int length, double tau,
+			     pthread_mutex_t *mutex)
+{
+	mcomplex<double> *signal = NULL;
+	double *curvature = NULL;
+	double result = energy_error;
+
+	signal = new mcomplex<double>[length];
+	if (!signal)
+		goto exit;
+
+	for (int i = 0; i < length; ++i)
+		signal[i](contour[i].x, contour[i].y);
+
+	curvature = contour_curvature(signal, length, tau, false, FBETA,
+				      mutex);
+	if (!curvature)
+		goto exit;
+
+	result = energy(curvature, length);
+
+exit:
+	if (signal)
+		delete [] signal;
+	if (curvature)
+		delete [] curvature;
+
+	return result;
+}
+
+
+/** Task: calculates descriptors of one contour.
+ *
+ * @param index Contour index.
+ * @param param Pointer to \ref stage_data.
+ */
+static void contour_task(int index, void *param)
+{
+	stage_data *data = (stage_data *) param;
+	const CvPoint *contour = data->set->contour(index), *points;
+	int length = data->set->length(index), count;
+	shape_features &record = data->features[index];
+	hull_features geometry;
+	CvPoint *reduced = NULL, *hull = NULL;
+	bool simplify = (data->tolerance > 0);
+	long long width, height;
+	float bound;
+
+	record = shape_features();
+	record.perimeter = length;
+	record.energy = energy_error;
+
+	/* Bounds are rounded like hull_diameter(), so a bound is never
+	 * below exact diameter.
+	 */
+	bound = float(sqrt(double(length) * length / 2));
+	if (bound < data->diam_thres) {
+		record.diameter = bound;
+		record.gate = GATE_POINTS;
+		goto exit;
+	}
+
+	contour_features(contour, length, record, !simplify);
+	width = record.bbox.width - 1;
+	height = record.bbox.height - 1;
+	bound = float(sqrt(double(width * width + height * height)));
+	if (bound < data->diam_thres) {
+		record.diameter = bound;
+		record.gate = GATE_BBOX;
+		goto exit;
+	}
+
+	/* Geometric descriptors on simplified contour */
+	points = contour;
+	count = length;
+	if (simplify) {
+		reduced = new CvPoint[length];
+		count = simplify_contour(contour, length, data->tolerance,
+					 reduced);
+		points = reduced;
+		record.distances = centroid_dist(points, count,
+						 record.centroid);
+		record.length = polygon_length(points, count);
+	}
+
+	hull_geometry(points, count, geometry);
+	record.diameter = geometry.diameter;
+	record.width = geometry.width;
+	record.solidity = geometry.solidity;
+	if (simplify) {
+		/* Simplified points are contour points, so its diameter
+		 * is at most 2 * tolerance below exact one: a bound again.
+		 */
+		bound = float(geometry.diameter + 2 * data->tolerance);
+		if (bound < data->diam_thres) {
+			record.diameter = bound;
+			record.gate = GATE_DIAMETER;
+			goto exit;
+		}
+
+		/* Survivors get exact diameter, from full contour hull */
+		hull = convex_hull(contour, length, &count);
+		if (!hull) {
+			pthread_mutex_lock(&data->lock);
+			data->failed = true;
+			pthread_mutex_unlock(&data->lock);
+			goto exit;
+		}
+		record.diameter = hull_diameter(hull, count);
+	}
+	if (record.diameter < data->diam_thres) {
+		record.gate = GATE_DIAMETER;
+		goto exit;
+	}
+
+	/* Curvature always on full resolution contour */
+	record.energy = contour_energy(contour, length, data->tau,
+				       &fftw_lock);
+	if (record.energy == energy_error) {
+		pthread_mutex_lock(&data->lock);
+		data->failed = true;
+		pthread_mutex_unlock(&data->lock);
+	}
+
+exit:
+	if (reduced)
+		delete [] reduced;
+	if (hull)
+		delete [] hull;
+}
+
+
+bool descriptor_stage(const contour_set &set, shape_features *features,
+		      float diam_thres, work_pool &pool, double tau,
+		      gate_stats *stats, double tolerance)
+{
+	stage_data data;
+
+	data.set = &set;
+	data.features = features;
+	data.diam_thres = diam_thres;
+	data.tau = tau;
+	data.tolerance = tolerance;
+	data.failed = false;
+	pthread_mutex_init(&data.lock, NULL);
+
+	pool.run(contour_task, &data, set.count);
+
+	pthread_mutex_destroy(&data.lock);
+
+	if (stats) {
+		*stats = gate_stats();
+		for (int i = 0; i < set.count; ++i)
+			switch (features[i].gate) {
+			case GATE_POINTS:
+				++stats->points;
+				break;
+			case GATE_BBOX:
+				++stats->bbox;
+				break;
+			case GATE_DIAMETER:
+				++stats->diameter;
+				break;
+			default:
+				++stats->passed;
+			}
+	}
+
+	return !data.failed;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file   stage.h
+ * @author Adenilson Cavalcanti <savagobr@yahoo.com> Copyright 2007
+ * @date   Sometime in 2007
+ *
+ * @brief  Descriptor stage, calculates all descriptors of each contour.
+ *
+ * Contours are independent of each other, so they are processed as
+ * tasks of a \ref work_pool. Each task writes only at its own contour
+ * record, so results have the same order of contour set whatever the
+ * number of threads.
+ *
+ */
+
+/*  Copyright (C) 2007  Adenilson Cavalcanti <cavalcantii@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; by version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _STAGE_H_
+#define _STAGE_H_
+
+#include "contour.h"
+#include "descriptors.h"
+#include "pool.h"
+
+/** \brief Number of contours rejected by each gate. */
+struct gate_stats {
+	/// Rejected by point count bound.
+	int points;
+	/// Rejected by bounding box diagonal.
+	int bbox;
+	/// Rejected by exact diameter.
+	int diameter;
+	/// Contours that passed all gates.
+	int passed;
+
+	/// Default constructor, zero's struct fields.
+	gate_stats(void): points(0), bbox(0), diameter(0), passed(0)
+		{}
+};
+
+
+/** Calculates descriptors of every contour in a contour set.
+ *
+ * Contours below diameter threshold are not written out, so they are
+ * rejected as soon as a cheap upper bound of diameter proves that they
+ * are small:
+ *
+ * - point count: consecutive points are 8-connected (contours found with
+ *   CV_CHAIN_APPROX_NONE) so diameter <= half perimeter <= n * sqrt(2) / 2.
+ *   Rejected contours only get perimeter and diameter (the bound).
+ * - bounding box diagonal, from \ref contour_features pass. Rejected
+ *   contours get point based descriptors and diameter (the bound).
+ * - exact diameter, from convex hull (see \ref hull_geometry). Rejected
+ *   contours get every descriptor but bending energy.
+ *
+ * When a simplification tolerance is given, hull geometry, centroid
+ * distances and polygon length are calculated on contour simplified by
+ * \ref simplify_contour (they differ at most by tolerance from exact
+ * ones). Simplified diameter is up to 2 * tolerance shorter than exact
+ * one, so diameter gate uses it plus 2 * tolerance as a bound and
+ * contours that pass get exact diameter from full contour hull (then
+ * gated again). Bending energy always uses the full contour.
+ *
+ * Contours that pass get bending energy too. Others get
+ * \ref energy_error and record field 'gate' tells which bound rejected
+ * it, their diameter is always below threshold.
+ *
+ * @param set Contour set.
+ * @param features Pre-allocated vector with one record per contour.
+ * @param diam_thres Minimal diameter of valid contours.
+ * @param pool Thread pool that runs per contour tasks.
+ * @param tau Gaussian inverse variance used in curvature.
+ * @param stats Pointer to structure that will hold rejection counts
+ * (can be NULL).
+ * @param tolerance Simplification tolerance in pixels, 0 disables it.
+ *
+ * @return true in success, false if some curvature failed.
+ */
+bool descriptor_stage(const contour_set &set, shape_features *features,
+		      float diam_thres, work_pool &pool, double tau = 10.0,
+		      gate_stats *stats = NULL, double tolerance = 0);
+
+#endif
@@ -19,8 +19,25 @@
 #include "src/vision.h"
 #include "src/fourier.h"
 #include "src/descriptors.h"
+#include "src/hull.h"
+#include "src/moments.h"
+#include "src/simplify.h"
+#include "src/chain.h"
+#include "src/results.h"
+#include "src/archive.h"
+#include "src/database.h"
+#include "src/kdtree.h"
+#include "src/kmeans.h"
+#include "src/pool.h"
+#include "src/stage.h"
+#include "src/quantile.h"
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 using namespace std;
 
 #include <check.h>
@@ -120,6 +137,1051 @@ START_TEST (t_adapt_access)
 }
 END_TEST
 
+START_TEST (t_adapt_materialize)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, i, counter = 0;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	ocv_adaptor<double> handler, reference;
+
+	sequence = find_contour_image(storage, &num_contours);
+	handler.reset(sequence);
+	reference.reset(sequence);
+
+	do {
+		fail_unless(handler.materialize(), "Failed to materialize!");
+		fail_unless((handler.x() != NULL) && (handler.y() != NULL),
+			    "Materialized buffers not available!");
+		fail_unless(((size_t) handler.x()) % buffer_alignment == 0,
+			    "Materialized buffer is not aligned!");
+
+		for (i = 0; i < handler.contour_length(); ++i) {
+			fail_unless(handler.x()[i] == reference[i][0],
+				    "Error when comparing points: real part!");
+			fail_unless(handler[i][1] == reference[i][1],
+				    "Error when comparing points: imag part!");
+		}
+
+		++counter;
+		reference.next();
+	} while (handler.next() == 1);
+
+	fail_unless(counter == num_contours, "Failed to visit all contours!");
+
+	{
+		ocv_adaptor<double> copy(handler);
+		fail_unless(copy.is_materialized(),
+			    "Copy must keep materialized buffers!");
+		fail_unless(copy.x() != handler.x(),
+			    "Copy must not share materialized buffers!");
+		for (i = 0; i < copy.contour_length(); ++i)
+			fail_unless((copy[i][0] == handler[i][0]) &&
+				    (copy[i][1] == handler[i][1]),
+				    "Copied materialized points differ!");
+	}
+
+	handler.reset(sequence);
+	fail_unless(!handler.is_materialized(),
+		    "Buffers must be invalidated when changing contour!");
+
+}
+END_TEST
+
+START_TEST (t_contour_set)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, i, size, set_size;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes;
+	m_point *centroids, *set_centroids;
+	float *areas, *set_areas, *diameters, *set_diameters;
+
+	sequence = find_contour_image(storage, &num_contours);
+	fail_unless(flatten_contours(sequence, shapes),
+		    "Failed to flatten contours!");
+	fail_unless(shapes.count == num_contours,
+		    "Contour set has wrong number of contours!");
+
+	centroids = calc_centroid(sequence, &size);
+	set_centroids = calc_centroid(shapes, &set_size);
+	fail_unless(size == set_size, "Wrong centroid vector size!");
+	for (i = 0; i < size; ++i)
+		fail_unless((centroids[i].x == set_centroids[i].x) &&
+			    (centroids[i].y == set_centroids[i].y),
+			    "Centroids differ!");
+
+	areas = calc_area(sequence, &size);
+	set_areas = calc_area(shapes, &set_size);
+	for (i = 0; i < size; ++i)
+		fail_unless(areas[i] == set_areas[i], "Areas differ!");
+
+	diameters = calc_diam(sequence, &size);
+	set_diameters = calc_diam(shapes, &set_size);
+	for (i = 0; i < size; ++i)
+		fail_unless(diameters[i] == set_diameters[i],
+			    "Diameters differ!");
+
+	delete [] centroids;
+	delete [] set_centroids;
+	delete [] areas;
+	delete [] set_areas;
+	delete [] diameters;
+	delete [] set_diameters;
+}
+END_TEST
+
+START_TEST (t_hull)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, size, count;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	CvPoint shape[] = { {0, 0}, {10, 0}, {10, 5}, {5, 5}, {5, 10},
+			    {0, 10} };
+	hull_features geometry;
+	m_point *coord;
+	float brute, *diameters;
+
+	fail_unless(hull_geometry(shape, 6, geometry),
+		    "Failed to calculate hull geometry!");
+	fail_unless(fabs(geometry.diameter - sqrt(200.0)) < 1e-4,
+		    "Wrong diameter!");
+	fail_unless(fabs(geometry.width - 10) < 1e-4, "Wrong width!");
+	fail_unless(fabs(geometry.rect_area - 100) < 1e-3,
+		    "Wrong bounding rectangle!");
+	fail_unless(fabs(geometry.hull_area - 87.5) < 1e-3,
+		    "Wrong hull area!");
+	fail_unless(fabs(geometry.solidity - 75 / 87.5) < 1e-4,
+		    "Wrong solidity!");
+
+	/* Calipers must agree with all pairs diameter */
+	sequence = find_contour_image(storage, &num_contours);
+	diameters = calc_diam(sequence, &count);
+	for (int i = 0; i < count; ++i, sequence = sequence->h_next) {
+		coord = points(sequence, &size);
+		brute = diameter(coord, &size);
+		fail_unless(fabs(brute - diameters[i]) < 1e-3,
+			    "Hull diameter differs from brute force!");
+		delete [] coord;
+	}
+
+	delete [] diameters;
+}
+END_TEST
+
+START_TEST (t_contour_features)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, size, i;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	CvPoint rectangle[] = { {0, 0}, {4, 0}, {4, 2}, {0, 2} };
+	contour_set shapes;
+	shape_features record;
+	m_point *centroids;
+	float *areas;
+	d3point *distances;
+
+	contour_features(rectangle, 4, record);
+	fail_unless(record.length == 12, "Wrong polygon length!");
+	fail_unless((record.bbox.width == 5) && (record.bbox.height == 3),
+		    "Wrong bounding box!");
+	fail_unless((record.moments.m00 == 8) && (record.moments.m10 == 16) &&
+		    (record.moments.m01 == 8) && (record.moments.m11 == 16),
+		    "Wrong raw moments!");
+	fail_unless((fabs(record.moments.m20 - 128 / 3.0) < 1e-9) &&
+		    (fabs(record.moments.m02 - 32 / 3.0) < 1e-9),
+		    "Wrong second order moments!");
+
+	/* Fused kernel must give same results of separated functions */
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	centroids = calc_centroid(sequence, &size);
+	areas = calc_area(shapes, &size);
+	distances = new d3point[size];
+	ratio_dist(sequence, centroids, size, distances);
+
+	for (i = 0; i < shapes.count; ++i) {
+		contour_features(shapes.contour(i), shapes.length(i), record);
+		fail_unless((record.centroid.x == centroids[i].x) &&
+			    (record.centroid.y == centroids[i].y),
+			    "Centroids differ!");
+		fail_unless(record.area == areas[i], "Areas differ!");
+		fail_unless((record.distances.y == distances[i].y) &&
+			    (record.distances.z == distances[i].z),
+			    "Centroid distances differ!");
+	}
+
+	delete [] centroids;
+	delete [] areas;
+	delete [] distances;
+}
+END_TEST
+
+START_TEST (t_moments)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, size;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	CvPoint triangle[] = { {0, 0}, {6, 0}, {0, 4} };
+	CvPoint turned[3];
+	contour_set shapes;
+	shape_moments moments, other, *batch;
+
+	/* Right triangle: m[p][q] = p! q! a^(p+1) b^(q+1) / (p + q + 2)! */
+	fail_unless(contour_moments(triangle, 3, moments, true),
+		    "Failed to calculate moments!");
+	fail_unless((moments.m[0][0] == 12) && (moments.m[1][0] == 24) &&
+		    (moments.m[0][1] == 16), "Wrong low order moments!");
+	fail_unless((fabs(moments.m[2][1] - 57.6) < 1e-9) &&
+		    (fabs(moments.m[1][2] - 38.4) < 1e-9) &&
+		    (fabs(moments.m[3][0] - 259.2) < 1e-9),
+		    "Wrong third order moments!");
+
+	/* Rotated by 90 degrees, moved and in clockwise order */
+	for (int i = 0; i < 3; ++i) {
+		turned[2 - i].x = 100 - triangle[i].y;
+		turned[2 - i].y = 50 + triangle[i].x;
+	}
+	fail_unless(contour_moments(turned, 3, other, true),
+		    "Failed to calculate moments!");
+	for (int i = 0; i < 7; ++i)
+		fail_unless(fabs(moments.hu[i] - other.hu[i]) <=
+			    1e-9 * fabs(moments.hu[i]), "Hu not invariant!");
+	for (int i = 0; i < zernike_count; ++i)
+		fail_unless(fabs(moments.zernike[i] - other.zernike[i]) < 1e-9,
+			    "Zernike not rotation invariant!");
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	batch = calc_moments(shapes, &size);
+	fail_unless(size == shapes.count, "Wrong moments vector size!");
+	for (int i = 0; i < size; ++i)
+		fail_unless(fabs(batch[i].m[0][0] -
+				 polygon_area(shapes.contour(i),
+					      shapes.length(i))) <=
+			    1e-6 * batch[i].m[0][0] + 1e-3,
+			    "Area differs from polygon area!");
+
+	delete [] batch;
+}
+END_TEST
+
+START_TEST (t_simplify)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, count, i;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	CvPoint border[28], reduced[28];
+	contour_set shapes, simple;
+	hull_features full, approx;
+
+	/* Border pixels of a 8x6 rectangle, only corners must remain */
+	count = 0;
+	for (i = 0; i < 8; ++i)
+		border[count++] = cvPoint(i, 0);
+	for (i = 1; i < 6; ++i)
+		border[count++] = cvPoint(7, i);
+	for (i = 6; i >= 0; --i)
+		border[count++] = cvPoint(i, 5);
+	for (i = 4; i > 0; --i)
+		border[count++] = cvPoint(0, i);
+
+	count = simplify_contour(border, 24, 0.5, reduced);
+	fail_unless(count == 4, "Rectangle must be reduced to 4 corners!");
+	fail_unless(polygon_area(reduced, count) == 35, "Wrong area!");
+	fail_unless(simplify_contour(border, 24, 0, reduced) == 24,
+		    "Null tolerance must keep all points!");
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	fail_unless(simplify_contours(shapes, 1.0, simple),
+		    "Failed to simplify contours!");
+	fail_unless((simple.count == shapes.count) &&
+		    (simple.total <= shapes.total), "Wrong simplified set!");
+
+	/* Dropped points are within tolerance of kept ones */
+	for (i = 0; i < shapes.count; ++i) {
+		hull_geometry(shapes.contour(i), shapes.length(i), full);
+		hull_geometry(simple.contour(i), simple.length(i), approx);
+		fail_unless(full.diameter - approx.diameter <= 2.0 + 1e-4,
+			    "Simplified diameter error above tolerance!");
+	}
+
+}
+END_TEST
+
+START_TEST (t_chain)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, i;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes, decoded;
+	chain_set chains;
+	shape_features from_points, from_codes;
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	fail_unless(pack_chains(shapes, chains), "Failed to pack chains!");
+	fail_unless(chain_set::packed_size(chains.total) * 20 <=
+		    shapes.total * (int) sizeof(CvPoint) + 20,
+		    "Chain codes should be much smaller than points!");
+
+	fail_unless(unpack_chains(chains, decoded), "Failed to unpack!");
+	fail_unless(decoded.total == shapes.total, "Wrong number of points!");
+	for (i = 0; i < shapes.total; ++i)
+		fail_unless((decoded.points[i].x == shapes.points[i].x) &&
+			    (decoded.points[i].y == shapes.points[i].y),
+			    "Decoded points differ!");
+
+	for (i = 0; i < shapes.count; ++i) {
+		contour_features(shapes.contour(i), shapes.length(i),
+				 from_points);
+		chain_features(chains, i, from_codes);
+		fail_unless((from_points.centroid.x == from_codes.centroid.x) &&
+			    (from_points.centroid.y == from_codes.centroid.y),
+			    "Centroids differ!");
+		fail_unless(from_points.area == from_codes.area,
+			    "Areas differ!");
+		fail_unless(from_points.length == from_codes.length,
+			    "Perimeters differ!");
+		fail_unless((from_points.bbox.width == from_codes.bbox.width) &&
+			    (from_points.bbox.height == from_codes.bbox.height),
+			    "Bounding boxes differ!");
+	}
+
+}
+END_TEST
+
+START_TEST (t_results)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, rows, first, second, i, j;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes;
+	shape_features *features = NULL;
+	shape_moments moments;
+	result_writer writer;
+	result_file results;
+	const char filename[] = "results_test.bin";
+	const int *image_id, *contour_id;
+	const float *diam;
+	const double *hu;
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	features = new shape_features[shapes.count];
+	for (i = 0; i < shapes.count; ++i) {
+		contour_features(shapes.contour(i), shapes.length(i),
+				 features[i]);
+		features[i].diameter = hull_diameter(shapes.contour(i),
+						     shapes.length(i));
+	}
+
+	/* Same contours as 2 images */
+	first = writer.add_image("first.bmp");
+	second = writer.add_image("second.bmp");
+	rows = writer.append(first, features, shapes, 7);
+	fail_unless(writer.append(second, features, shapes, 7) == rows,
+		    "Same contours must give same rows!");
+	fail_unless(rows > 0, "There should be valid contours!");
+	fail_unless(writer.write(filename), "Failed to write result file!");
+
+	fail_unless(results.open(filename), "Failed to read result file!");
+	fail_unless((results.rows() == 2 * rows) &&
+		    (results.columns() == result_column_count) &&
+		    (results.images() == 2), "Wrong result file header!");
+	fail_unless(!strcmp(results.image_name(second), "second.bmp"),
+		    "Wrong image name!");
+	fail_unless(results.find_column("hu7") == COL_HU7, "Wrong schema!");
+	fail_unless((results.segments() == 1) &&
+		    (results.segment_rows(0) == results.rows()),
+		    "File written at once should have one segment!");
+
+	image_id = (const int *) results.data(COL_IMAGE, 0);
+	contour_id = (const int *) results.data(COL_CONTOUR, 0);
+	diam = (const float *) results.data(COL_DIAMETER, 0);
+	hu = (const double *) results.data(COL_HU1, 0);
+	for (j = 0; j < results.rows(); ++j) {
+		i = contour_id[j];
+		fail_unless(image_id[j] == (j < rows ? first : second),
+			    "Wrong image id!");
+		fail_unless(diam[j] == features[i].diameter,
+			    "Wrong diameter!");
+		fail_unless(results.value(COL_AREA, j) == features[i].area,
+			    "Wrong area!");
+		contour_moments(shapes.contour(i), shapes.length(i), moments);
+		fail_unless(hu[j] == moments.hu[0], "Wrong Hu invariant!");
+	}
+
+	results.close();
+	remove(filename);
+	delete [] features;
+
+}
+END_TEST
+
+START_TEST (t_results_segments)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, rows, first, second, i, j, k;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes;
+	shape_features *features = NULL;
+	shape_moments *moments = NULL;
+	result_writer writer;
+	result_file results;
+	const char filename[] = "segments_test.bin";
+	const int *image_id, *contour_id;
+	const double *hu;
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	features = new shape_features[shapes.count];
+	moments = new shape_moments[shapes.count];
+	for (i = 0; i < shapes.count; ++i) {
+		contour_features(shapes.contour(i), shapes.length(i),
+				 features[i]);
+		features[i].diameter = hull_diameter(shapes.contour(i),
+						     shapes.length(i));
+		contour_moments(shapes.contour(i), shapes.length(i),
+				moments[i]);
+	}
+
+	/* Each image in its own segment, second one with given moments */
+	first = writer.add_image("first.bmp");
+	second = writer.add_image("second.bmp");
+	fail_unless(writer.open(filename), "Failed to create result file!");
+	rows = writer.append(first, features, shapes, 7);
+	fail_unless(writer.pending() == rows, "Rows must be buffered!");
+	fail_unless(writer.flush() && (writer.pending() == 0),
+		    "Failed to flush rows!");
+
+	/* First segment is readable before file is closed */
+	fail_unless(results.open(filename) && (results.rows() == rows),
+		    "Flushed rows must be in file!");
+	results.close();
+
+	fail_unless(writer.append(second, features, shapes, 7, moments) ==
+		    rows, "Same contours must give same rows!");
+	fail_unless(writer.close(), "Failed to close result file!");
+
+	fail_unless(results.open(filename), "Failed to read result file!");
+	fail_unless((results.rows() == 2 * rows) && (results.images() == 2) &&
+		    (results.segments() == 2), "Wrong result file header!");
+
+	/* Segments are served from mapping, one after the other */
+	for (k = 0; k < results.segments(); ++k) {
+		fail_unless((results.segment_rows(k) == rows) &&
+			    (results.segment_first(k) == k * rows),
+			    "Wrong segment rows!");
+		image_id = (const int *) results.data(COL_IMAGE, k);
+		contour_id = (const int *) results.data(COL_CONTOUR, k);
+		hu = (const double *) results.data(COL_HU7, k);
+		fail_unless((const char *) contour_id -
+			    (const char *) image_id ==
+			    (rows * sizeof(int) + 7) / 8 * 8,
+			    "Segment columns should be contiguous!");
+		for (j = 0; j < results.segment_rows(k); ++j) {
+			i = contour_id[j];
+			fail_unless(image_id[j] == (k ? second : first),
+				    "Wrong image id!");
+			fail_unless(results.value(COL_AREA, k * rows + j) ==
+				    features[i].area, "Wrong area!");
+			fail_unless(hu[j] == moments[i].hu[6],
+				    "Wrong Hu invariant!");
+		}
+	}
+
+	results.close();
+	remove(filename);
+	delete [] features;
+	delete [] moments;
+
+}
+END_TEST
+
+START_TEST (t_archive)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, i, j;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes, loaded;
+	contour_archive archive;
+	const char filename[] = "archive_test.cta";
+	CvPoint *points = NULL;
+	bool delta;
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	points = new CvPoint[shapes.total];
+
+	for (int pass = 0; pass < 2; ++pass) {
+		delta = (pass == 1);
+		fail_unless(write_archive(filename, shapes, delta),
+			    "Failed to write archive!");
+		fail_unless(archive.open(filename), "Failed to read archive!");
+		fail_unless((archive.count() == shapes.count) &&
+			    (archive.total() == shapes.total),
+			    "Wrong archive header!");
+
+		/* Backwards, each contour is fetched on its own */
+		for (i = shapes.count - 1; i >= 0; --i) {
+			fail_unless(archive.length(i) == shapes.length(i),
+				    "Wrong contour length!");
+			archive.contour(i, points);
+			for (j = 0; j < shapes.length(i); ++j)
+				fail_unless((points[j].x ==
+					     shapes.contour(i)[j].x) &&
+					    (points[j].y ==
+					     shapes.contour(i)[j].y),
+					    "Decoded points differ!");
+		}
+
+		fail_unless(archive.load(loaded), "Failed to load archive!");
+		fail_unless((loaded.count == shapes.count) &&
+			    (loaded.points[shapes.total - 1].x ==
+			     shapes.points[shapes.total - 1].x),
+			    "Loaded set differs!");
+		archive.close();
+	}
+
+	remove(filename);
+	delete [] points;
+
+}
+END_TEST
+
+START_TEST (t_database)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, count, i;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes;
+	shape_features *features = NULL;
+	vector<descriptor_record> first, second;
+	vector<const descriptor_record *> found;
+	descriptor_db db;
+	struct stat info;
+	long long next_image = 0;
+	int fd;
+	const char filename[] = "database_test.db";
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	features = new shape_features[shapes.count];
+	for (i = 0; i < shapes.count; ++i) {
+		contour_features(shapes.contour(i), shapes.length(i),
+				 features[i]);
+		features[i].diameter = hull_diameter(shapes.contour(i),
+						     shapes.length(i));
+	}
+
+	/* 2 appends (i.e. 2 batch processes), images 10 + 11 and 20 */
+	remove(filename);
+	count = make_records(10, features, shapes.count, 7, first);
+	make_records(11, features, shapes.count, 7, first);
+	make_records(20, features, shapes.count, 7, second);
+	fail_unless(count > 0, "There should be valid contours!");
+	fail_unless(append_descriptors(filename, &first[0], first.size()) &&
+		    append_descriptors(filename, &second[0], second.size()),
+		    "Failed to append descriptors!");
+
+	fail_unless(db.open(filename), "Failed to open database!");
+	fail_unless((db.segments() == 2) && (db.size() == 3 * count),
+		    "Wrong segment index!");
+	fail_unless((db.segment(0).min_image == 10) &&
+		    (db.segment(0).max_image == 11) &&
+		    (db.segment(1).min_image == 20), "Wrong image ranges!");
+
+	fail_unless(db.find_image(11, found) == count, "Wrong image filter!");
+	for (i = 0; i < count; ++i)
+		fail_unless((found[i]->image == 11) &&
+			    (found[i]->diameter ==
+			     features[found[i]->contour].diameter),
+			    "Wrong record!");
+
+	fail_unless((db.record(2 * count)->image == 20) &&
+		    (db.record(3 * count) == NULL), "Wrong record index!");
+	db.close();
+
+	/* Reserved ids are above appended ones and never given twice */
+	fail_unless((reserve_images(filename, 5) == 21) &&
+		    (reserve_images(filename, 1) == 26),
+		    "Wrong reserved image ids!");
+
+	/* Database written before header had next image id */
+	fail_unless((fd = open(filename, O_RDWR)) >= 0,
+		    "Failed to open database file!");
+	fail_unless(pwrite(fd, &next_image, sizeof(next_image),
+			   offsetof(database_header, next_image)) ==
+		    sizeof(next_image), "Failed to clear next image id!");
+	close(fd);
+	fail_unless(reserve_images(filename, 2) == 21,
+		    "Reserved ids must skip appended ones!");
+
+	/* File mapped before last commit: committed is past mapping */
+	fail_unless(!stat(filename, &info) &&
+		    !truncate(filename, info.st_size -
+			      sizeof(descriptor_record)),
+		    "Failed to truncate database!");
+	fail_unless(db.open(filename), "Failed to open database!");
+	fail_unless((db.segments() == 1) && (db.size() == 2 * count),
+		    "Segments past mapping must be left out!");
+
+	db.close();
+	remove(filename);
+	delete [] features;
+
+}
+END_TEST
+
+START_TEST (t_kdtree)
+{
+	const int count = 2000, dims = 3, k = 5, queries = 50;
+	float *points = new float[count * dims], *query, best[k], exact[k];
+	float *distances = new float[queries * k];
+	int *ids = new int[queries * k], found[k], scan_ids[k], i, j, q, n;
+	const char filename[] = "kdtree_test.kdt";
+	kd_tree tree, scan, loaded;
+	work_pool pool(2);
+
+	/* Ranges differ by 1000x, like area and ratio */
+	srand(7);
+	for (i = 0; i < count; ++i) {
+		points[i * dims] = rand() % 10000;
+		points[i * dims + 1] = (rand() % 1000) / 100.0;
+		points[i * dims + 2] = (rand() % 1000) / 1000.0;
+	}
+
+	fail_unless(tree.build(points, count, dims, &pool, 8),
+		    "Failed to build tree!");
+	fail_unless(scan.build(points, count, dims, NULL, count),
+		    "Failed to build scan tree!");
+	fail_unless(tree.size() == count, "Wrong tree size!");
+
+	/* Queries are the first points, so nearest one is itself */
+	tree.search(points, queries, k, ids, distances, pool);
+	for (q = 0; q < queries; ++q) {
+		query = points + q * dims;
+		n = tree.search(query, k, found, best);
+		fail_unless((n == k) && (found[0] == q) && (best[0] == 0),
+			    "Point should be its own neighbour!");
+
+		/* Tree with a single leaf is a linear scan */
+		scan.search(query, k, scan_ids, exact);
+		for (j = 0; j < k; ++j)
+			fail_unless(fabs(best[j] - exact[j]) < 1e-5,
+				    "Missed a neighbour!");
+
+		for (j = 0; j < k; ++j)
+			fail_unless((ids[q * k + j] == found[j]) &&
+				    (distances[q * k + j] == best[j]),
+				    "Batch differs from single query!");
+	}
+
+	remove(filename);
+	fail_unless(tree.save(filename) && loaded.load(filename),
+		    "Failed to save/load tree!");
+	n = loaded.search(points + 7 * dims, k, found, best);
+	fail_unless((n == k) && (found[0] == 7), "Wrong loaded tree!");
+	remove(filename);
+
+	delete [] points;
+	delete [] distances;
+	delete [] ids;
+
+}
+END_TEST
+
+START_TEST (t_kmeans)
+{
+	const int count = 3000, dims = 2, k = 3;
+	float *points = new float[count * dims], center[dims];
+	int *labels = new int[count], group[k], i, j;
+	kmeans model(k, dims), stream(k, dims);
+	work_pool pool(2);
+
+	/* 3 groups, point i belongs to group i % 3 (both dimensions) */
+	srand(11);
+	for (i = 0; i < count; ++i) {
+		points[i * dims] = 1000 * (i % k) + rand() % 100;
+		points[i * dims + 1] = (i % k) + (rand() % 100) / 1000.0;
+	}
+
+	fail_unless(model.fit(points, count, &pool) > 0, "Failed to fit!");
+	fail_unless(model.assign(points, count, labels, &pool) >= 0,
+		    "Failed to assign!");
+	for (j = 0; j < k; ++j)
+		group[j] = labels[j];
+	fail_unless((group[0] != group[1]) && (group[1] != group[2]) &&
+		    (group[0] != group[2]), "Groups should be split!");
+	for (i = 0; i < count; ++i)
+		fail_unless(labels[i] == group[i % k], "Wrong cluster!");
+	for (j = 0; j < k; ++j) {
+		model.center(group[j], center);
+		fail_unless((model.size(group[j]) == count / k) &&
+			    (fabs(center[0] - (1000 * j + 49.5)) < 5),
+			    "Wrong center!");
+	}
+
+	/* Mini-batches of 500 points */
+	for (i = 0; i < count; i += 500)
+		fail_unless(stream.partial_fit(points + i * dims, 500, &pool),
+			    "Failed mini-batch!");
+	for (i = 0; i < count; ++i)
+		fail_unless(stream.assign(points + i * dims) ==
+			    stream.assign(points + (i % k) * dims),
+			    "Wrong mini-batch cluster!");
+
+	delete [] points;
+	delete [] labels;
+
+}
+END_TEST
+
+/** Counts how many times each task index was run. */
+struct pool_counter {
+	pthread_mutex_t lock;
+	int *runs;
+};
+
+static void count_task(int index, void *data)
+{
+	pool_counter *counter = static_cast<pool_counter *>(data);
+	pthread_mutex_lock(&counter->lock);
+	++counter->runs[index];
+	pthread_mutex_unlock(&counter->lock);
+}
+
+START_TEST (t_pool)
+{
+	const int count = 1000, rounds = 20;
+	const int sizes[] = { 1, 2, 4, 7 };
+	int runs[count], i, j, size;
+	pool_counter counter;
+
+	pthread_mutex_init(&counter.lock, NULL);
+	counter.runs = runs;
+	for (size = 0; size < 4; ++size) {
+		work_pool pool(sizes[size]);
+		for (j = 0; j < rounds; ++j) {
+			/* Different task counts, including none and less
+			 * tasks than workers */
+			int tasks = (j * 97) % (count + 1);
+			if (j == 1)
+				tasks = 0;
+			else if (j == 2)
+				tasks = 3;
+			memset(runs, 0, sizeof(runs));
+			pool.run(count_task, &counter, tasks);
+			for (i = 0; i < count; ++i)
+				fail_unless(runs[i] == (i < tasks ? 1 : 0),
+					    "Task not run exactly once!");
+		}
+	}
+	pthread_mutex_destroy(&counter.lock);
+
+}
+END_TEST
+
+START_TEST (t_stage_threads)
+{
+	CvSeq *sequence = NULL;
+	int num_contours, i;
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	contour_set shapes;
+	shape_features *serial, *parallel;
+	work_pool single(1), multiple(4);
+	const double tolerances[] = { 0, 1.0 };
+
+	sequence = find_contour_image(storage, &num_contours);
+	flatten_contours(sequence, shapes);
+	serial = new shape_features[shapes.count];
+	parallel = new shape_features[shapes.count];
+
+	for (int t = 0; t < 2; ++t) {
+		fail_unless(descriptor_stage(shapes, serial, 10, single, 10.0,
+					     NULL, tolerances[t]),
+			    "Failed serial stage!");
+		fail_unless(descriptor_stage(shapes, parallel, 10, multiple,
+					     10.0, NULL, tolerances[t]),
+			    "Failed parallel stage!");
+		for (i = 0; i < shapes.count; ++i) {
+			shape_features &a = serial[i], &b = parallel[i];
+			fail_unless((a.gate == b.gate) &&
+				    (a.perimeter == b.perimeter) &&
+				    (a.diameter == b.diameter),
+				    "Gates differ between thread counts!");
+			fail_unless((a.centroid.x == b.centroid.x) &&
+				    (a.centroid.y == b.centroid.y) &&
+				    (a.area == b.area) && (a.length == b.length) &&
+				    (a.bbox.x == b.bbox.x) &&
+				    (a.bbox.y == b.bbox.y) &&
+				    (a.bbox.width == b.bbox.width) &&
+				    (a.bbox.height == b.bbox.height),
+				    "Point descriptors differ!");
+			fail_unless((a.width == b.width) &&
+				    (a.solidity == b.solidity) &&
+				    (a.distances.x == b.distances.x) &&
+				    (a.distances.y == b.distances.y) &&
+				    (a.distances.z == b.distances.z),
+				    "Hull descriptors differ!");
+			fail_unless(!memcmp(&a.moments, &b.moments,
+					    sizeof(a.moments)),
+				    "Moments differ!");
+			fail_unless((a.energy == b.energy) ||
+				    ((a.energy != a.energy) &&
+				     (b.energy != b.energy)),
+				    "Energy differs!");
+		}
+	}
+
+	delete [] serial;
+	delete [] parallel;
+	cvReleaseMemStorage(&storage);
+
+}
+END_TEST
+
+/** Builds a contour set of polygons, edges are traced as 8-connected
+ * points (like CV_CHAIN_APPROX_NONE contours).
+ *
+ * @param vertices x and y of every polygon vertex, one polygon after
+ * the other.
+ * @param sizes Number of vertices of each polygon.
+ * @param count Number of polygons.
+ * @param set Contour set, previous content is released.
+ */
+static void trace_polygons(const int *vertices, const int *sizes,
+			   int count, contour_set &set)
+{
+	int i, j, k, steps, total = 0, first = 0;
+	const int *a, *b;
+
+	set.clear();
+	for (i = 0; i < count; ++i) {
+		for (j = 0; j < sizes[i]; ++j) {
+			a = vertices + 2 * (first + j);
+			b = vertices + 2 * (first + (j + 1) % sizes[i]);
+			total += std::max(abs(b[0] - a[0]), abs(b[1] - a[1]));
+		}
+		first += sizes[i];
+	}
+
+	set.points = new CvPoint[total];
+	set.offsets = new int[count + 1];
+	set.count = count;
+	set.total = total;
+	total = first = 0;
+	for (i = 0; i < count; ++i) {
+		set.offsets[i] = total;
+		for (j = 0; j < sizes[i]; ++j) {
+			a = vertices + 2 * (first + j);
+			b = vertices + 2 * (first + (j + 1) % sizes[i]);
+			steps = std::max(abs(b[0] - a[0]), abs(b[1] - a[1]));
+			for (k = 0; k < steps; ++k, ++total) {
+				set.points[total].x = a[0] +
+					(b[0] - a[0]) * k / steps;
+				set.points[total].y = a[1] +
+					(b[1] - a[1]) * k / steps;
+			}
+		}
+		first += sizes[i];
+	}
+	set.offsets[count] = total;
+}
+
+START_TEST (t_stage_simplify)
+{
+	/* Octagon whose simplified (tolerance 2) diameter is 34.89, 1.5
+	 * below exact one.
+	 */
+	const int vertices[] = { 8, 2, 18, 1, 32, 8, 31, 20, 19, 29, 9, 28,
+				 -2, 21, 1, 8 };
+	const int sizes[] = { 8 };
+	const double tolerance = 2.0;
+	contour_set shape;
+	shape_features record;
+	CvPoint *hull;
+	gate_stats stats;
+	float exact;
+	int hull_size;
+	work_pool pool(1);
+
+	trace_polygons(vertices, sizes, 1, shape);
+	hull = convex_hull(shape.points, shape.total, &hull_size);
+	exact = hull_diameter(hull, hull_size);
+	delete [] hull;
+
+	/* Exactly at threshold: must pass, with exact diameter */
+	fail_unless(descriptor_stage(shape, &record, exact, pool, 10.0,
+				     &stats, tolerance), "Failed stage!");
+	fail_unless((record.gate == GATE_PASSED) && (stats.passed == 1),
+		    "Contour at threshold rejected!");
+	fail_unless(record.diameter == exact, "Diameter is not exact!");
+
+	/* Slightly above exact diameter: rejected by exact diameter */
+	fail_unless(descriptor_stage(shape, &record, exact + 0.5, pool,
+				     10.0, &stats, tolerance),
+		    "Failed stage!");
+	fail_unless((record.gate == GATE_DIAMETER) &&
+		    (stats.diameter == 1) && (record.diameter == exact),
+		    "Contour above exact diameter should be rejected!");
+
+	/* Above simplified diameter + 2 * tolerance: rejected by bound */
+	fail_unless(descriptor_stage(shape, &record, exact + 4, pool, 10.0,
+				     &stats, tolerance), "Failed stage!");
+	fail_unless((record.gate == GATE_DIAMETER) &&
+		    (record.diameter < exact + 4) &&
+		    (record.diameter >= exact),
+		    "Bound should reject and stay above exact diameter!");
+
+}
+END_TEST
+
+START_TEST (t_stage_gates)
+{
+	/* Threshold 20: 4x4 square (points gate), 12x12 square (bbox
+	 * gate), diamond with diameter 18 (diameter gate), segment with
+	 * diameter 20 (at threshold) and 30x30 square.
+	 */
+	const int vertices[] = { 0, 0, 4, 0, 4, 4, 0, 4,
+				 0, 0, 12, 0, 12, 12, 0, 12,
+				 9, 0, 18, 9, 9, 18, 0, 9,
+				 0, 0, 20, 0,
+				 0, 0, 30, 0, 30, 30, 0, 30 };
+	const int sizes[] = { 4, 4, 4, 2, 4 };
+	const gate_result expected[] = { GATE_POINTS, GATE_BBOX,
+					 GATE_DIAMETER, GATE_PASSED,
+					 GATE_PASSED };
+	const int count = 5, random_count = 200, max_vertices = 6;
+	int random_vertices[random_count * max_vertices * 2];
+	int random_sizes[random_count];
+	contour_set shapes;
+	shape_features records[random_count];
+	gate_stats stats;
+	CvPoint *hull;
+	float exact, thres;
+	int i, j, hull_size, cheap = 0;
+	work_pool pool(2);
+
+	trace_polygons(vertices, sizes, count, shapes);
+	fail_unless(descriptor_stage(shapes, records, 20, pool, 10.0, &stats),
+		    "Failed stage!");
+	for (i = 0; i < count; ++i)
+		fail_unless(records[i].gate == expected[i], "Wrong gate!");
+	fail_unless((stats.points == 1) && (stats.bbox == 1) &&
+		    (stats.diameter == 1) && (stats.passed == 2),
+		    "Wrong gate counts!");
+	fail_unless(records[3].diameter == 20, "Wrong diameter!");
+
+	/* Random polygons, no contour at or above threshold can be
+	 * rejected and rejected ones keep a bound of exact diameter.
+	 */
+	srand(5);
+	for (i = 0; i < random_count; ++i) {
+		/* Polygons are stored max_vertices apart, extra vertices
+		 * repeat last one (zero length edges add no points).
+		 */
+		int *polygon = random_vertices + 2 * i * max_vertices;
+		int size = 2 + rand() % (max_vertices - 1);
+		for (j = 0; j < max_vertices; ++j) {
+			polygon[2 * j] = (j < size) ? rand() % 40 :
+				polygon[2 * (j - 1)];
+			polygon[2 * j + 1] = (j < size) ? rand() % 40 :
+				polygon[2 * (j - 1) + 1];
+		}
+		random_sizes[i] = max_vertices;
+	}
+	trace_polygons(random_vertices, random_sizes, random_count, shapes);
+
+	for (thres = 5; thres <= 50; thres += 5) {
+		fail_unless(descriptor_stage(shapes, records, thres, pool,
+					     10.0, &stats), "Failed stage!");
+		cheap += stats.points + stats.bbox;
+		for (i = 0; i < shapes.count; ++i) {
+			if (shapes.length(i) < 3)
+				continue;
+			hull = convex_hull(shapes.contour(i), shapes.length(i),
+					   &hull_size);
+			exact = hull_diameter(hull, hull_size);
+			delete [] hull;
+			if (records[i].gate == GATE_PASSED) {
+				fail_unless(records[i].diameter >= thres,
+					    "Passed contour below threshold!");
+				continue;
+			}
+			fail_unless(exact < thres, "Valid contour rejected!");
+			fail_unless(records[i].diameter >= exact,
+				    "Bound below exact diameter!");
+		}
+		fail_unless(stats.points + stats.bbox + stats.diameter +
+			    stats.passed == shapes.count, "Lost contours!");
+	}
+	fail_unless(cheap > 0, "Cheap bounds never used!");
+
+}
+END_TEST
+
+/** Position of a value in a sorted vector, as a quantile. */
+static double sorted_rank(const std::vector<double> &sorted, double x)
+{
+	return double(std::lower_bound(sorted.begin(), sorted.end(), x) -
+		      sorted.begin()) / sorted.size();
+}
+
+START_TEST (t_quantile)
+{
+	const int count = 20000, parts = 4;
+	const double levels[] = { 0.01, 0.25, 0.5, 0.75, 0.9, 0.99 };
+	const double errors[] = { 0.003, 0.01, 0.01, 0.01, 0.01, 0.003 };
+	std::vector<double> values, sorted;
+	tdigest whole, split[parts], merged, empty;
+	double x, q;
+	int i, j;
+
+	/* Empty digest */
+	fail_unless((empty.count() == 0) && (empty.quantile(0.5) == 0),
+		    "Empty digest should estimate 0!");
+
+	/* Exponential distribution, data split in parts like threads */
+	srand(3);
+	for (i = 0; i < count; ++i) {
+		x = -log((rand() + 1.0) / (RAND_MAX + 2.0)) * 100;
+		values.push_back(x);
+		whole.add(x);
+		split[i % parts].add(x);
+	}
+	sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+	merged.merge(empty);
+	for (j = 0; j < parts; ++j)
+		merged.merge(split[j]);
+	merged.merge(empty);
+
+	fail_unless((whole.count() == count) && (merged.count() == count),
+		    "Wrong count!");
+	fail_unless((whole.min() == sorted.front()) &&
+		    (whole.max() == sorted.back()) &&
+		    (merged.min() == sorted.front()) &&
+		    (merged.max() == sorted.back()), "Wrong min/max!");
+	fail_unless((whole.quantile(0) == sorted.front()) &&
+		    (whole.quantile(1) == sorted.back()),
+		    "Extreme quantiles should be min/max!");
+
+	/* Estimates must be close to reference in rank */
+	for (j = 0; j < 6; ++j) {
+		q = sorted_rank(sorted, whole.quantile(levels[j]));
+		fail_unless(fabs(q - levels[j]) < errors[j],
+			    "Quantile far from sorted reference!");
+		q = sorted_rank(sorted, merged.quantile(levels[j]));
+		fail_unless(fabs(q - levels[j]) < errors[j],
+			    "Merged quantile far from sorted reference!");
+	}
+	fail_unless(whole.size() < 200, "Too many centroids!");
+
+}
+END_TEST
+
 START_TEST (t_adapt_curvature)
 {
 
@@ -137,6 +1199,7 @@ START_TEST (t_adapt_curvature)
 	handler.reset(sequence);
 
 	do {
+		fail_unless(handler.materialize(), "Failed to materialize!");
 		curvature = contour_curvature<ocv_adaptor<int>,
 		  mcomplex<double> >(handler, handler.contour_length(), tau);
 		fail_unless(curvature != NULL, "Failed to calculate curvature!");
@@ -173,6 +1236,24 @@ Suite *test_suite(void)
 	tcase_add_test(test_case, t_ocv_adapt);
 	tcase_add_test(test_case, t_adapt_curvature);
 	tcase_add_test(test_case, t_adapt_access);
+	tcase_add_test(test_case, t_adapt_materialize);
+	tcase_add_test(test_case, t_contour_set);
+	tcase_add_test(test_case, t_hull);
+	tcase_add_test(test_case, t_contour_features);
+	tcase_add_test(test_case, t_moments);
+	tcase_add_test(test_case, t_simplify);
+	tcase_add_test(test_case, t_chain);
+	tcase_add_test(test_case, t_results);
+	tcase_add_test(test_case, t_results_segments);
+	tcase_add_test(test_case, t_archive);
+	tcase_add_test(test_case, t_database);
+	tcase_add_test(test_case, t_kdtree);
+	tcase_add_test(test_case, t_kmeans);
+	tcase_add_test(test_case, t_pool);
+	tcase_add_test(test_case, t_stage_threads);
+	tcase_add_test(test_case, t_stage_simplify);
+	tcase_add_test(test_case, t_stage_gates);
+	tcase_add_test(test_case, t_quantile);
 
 	return s;
 }
@@ -9,6 +9,7 @@
  *        goes here.
  */
 #include "src/fourier.h"
+#include "src/matching.h"
 #include "src/mcomplex.h"
 #include "square.h"
 #include "circle.h"
@@ -164,7 +165,6 @@ START_TEST (tshift)
 	fail_unless(res == 0, "failed shift tmp != sv4");
 	delete [] tmp;
 
-	//This one fails
 	length = sizeof(v3)/sizeof(double);
 	tmp = shift(v3, length);
 	fail_unless(tmp != NULL, "failed function call");
@@ -282,6 +282,48 @@ END_TEST
 
 
 
+/* Curvature of an odd length contour: starting the contour one point
+ * later must only rotate curvature by one point (odd lengths go through
+ * the odd branch of shift()).
+ */
+START_TEST (t_curvature_odd)
+{
+	int length = 51;
+	mcomplex<double> *ellipse, *rotated;
+	double *k_ellipse, *k_rotated;
+	double t, diff = 0, peak = 0;
+
+	ellipse = new mcomplex<double> [length];
+	rotated = new mcomplex<double> [length];
+	for (int i = 0; i < length; ++i) {
+		t = 2 * PI * i / length;
+		ellipse[i][0] = 20 * cos(t);
+		ellipse[i][1] = 10 * sin(t);
+	}
+	for (int i = 0; i < length; ++i) {
+		rotated[i][0] = ellipse[(i + 1) % length][0];
+		rotated[i][1] = ellipse[(i + 1) % length][1];
+	}
+
+	k_ellipse = contour_curvature(ellipse, length);
+	k_rotated = contour_curvature(rotated, length);
+	fail_unless(k_ellipse && k_rotated, "Failed to calculate curvature!");
+
+	for (int i = 0; i < length; ++i) {
+		diff = max(diff, fabs(k_rotated[i] -
+				      k_ellipse[(i + 1) % length]));
+		peak = max(peak, fabs(k_ellipse[i]));
+	}
+	fail_unless(diff < 0.01 * peak,
+		    "Odd length contour curvature depends on start point!");
+
+	delete [] ellipse;
+	delete [] rotated;
+	delete [] k_ellipse;
+	delete [] k_rotated;
+}
+END_TEST
+
 /* Curvature test: we search for number of curvature inversions, since
  * we are dealing with a square, it must have 4 inversions.
  * TODO: write test && code to search for number of inversions/spikes.
@@ -386,6 +428,62 @@ START_TEST (t_energy)
 }
 END_TEST
 
+//Test for curvature signature matching
+START_TEST (t_match)
+{
+	mcomplex<double> *g_square, *g_circle;
+	double *k_square, *k_circle, *k_shifted;
+	int length, shift = -1, nearest;
+	double tau = 12.0, dist;
+	signature templates[2], query, mixed[3];
+
+	g_square = create_square(&length);
+	g_circle = create_circle(length);
+	k_square = contour_curvature(g_square, length, tau);
+	k_circle = contour_curvature(g_circle, length, tau);
+	fail_unless((k_square != NULL) && (k_circle != NULL),
+		    "Failed to calculate curvature!");
+
+	// Same square, but contour starting 30 points later
+	k_shifted = new double[length];
+	for (int i = 0; i < length; ++i)
+		k_shifted[i] = k_square[(i + 30) % length];
+
+	fail_unless(make_signature(templates[0], k_circle, length, length) &&
+		    make_signature(templates[1], k_square, length, length) &&
+		    make_signature(query, k_shifted, length, length),
+		    "Failed to create signatures!");
+
+	dist = align_signatures(templates[1], query, &shift);
+	fail_unless(dist < 1e-6, "Aligned signatures should be equal!");
+	fail_unless(shift == 30, "Wrong alignment!");
+	fail_unless(signature_bound(templates[0], query) <=
+		    align_signatures(templates[0], query),
+		    "Energy bound is not a lower bound!");
+
+	nearest = nearest_signature(query, templates, 2, &dist, &shift);
+	fail_unless(nearest == 1, "Shifted square should match square!");
+
+	// A template that failed (no samples, energy_error) is skipped
+	fail_unless(make_signature(mixed[0], k_circle, length, length) &&
+		    make_signature(mixed[2], k_square, length, length),
+		    "Failed to create signatures!");
+	fail_unless(!make_signature(mixed[1], k_square, 0, length),
+		    "Signature of empty curvature should fail!");
+	nearest = nearest_signature(query, mixed, 3, &dist, &shift);
+	fail_unless((nearest == 2) && (dist < 1e-6),
+		    "Failed template must be skipped!");
+	fail_unless(nearest_signature(mixed[1], templates, 2) == -1,
+		    "Failed query can't match!");
+
+	delete [] g_square;
+	delete [] g_circle;
+	delete [] k_square;
+	delete [] k_circle;
+	delete [] k_shifted;
+}
+END_TEST
+
 //Tests for thread safe transform.
 START_TEST (thread_transf)
 {
@@ -527,10 +625,12 @@ Suite *test_suite(void)
 	tcase_add_test(test_case, t_gaussian);
 	tcase_add_test(test_case, diff);
 	tcase_add_test(test_case, t_curvature);
+	tcase_add_test(test_case, t_curvature_odd);
 	tcase_add_test(test_case, tshift);
 	tcase_add_test(test_case, tunshift);
 	tcase_add_test(test_case, diff_filter);
 	tcase_add_test(test_case, t_energy);
+	tcase_add_test(test_case, t_match);
 	return s;
 }
 